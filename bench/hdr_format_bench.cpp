@@ -0,0 +1,99 @@
+// Precision and size of the HDR storage formats (texture/hdr_format.h) against fp32.
+// Build with the "bench hdr formats" task (-O2), run
+//   ./hdr_format_bench [prefilter.ktx] [brdfLUT.ktx]
+// Every texel is packed and unpacked again on the CPU, exactly what the loaders upload.
+// Relative error is taken where the fp32 value is above 1e-3 (darker texels are
+// reported by the absolute error).
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#include "cubemap/ibl_baker.h"
+#include "texture/hdr_format.h"
+#include <gli/gli.hpp>
+#include <gli/load.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+struct FormatError {
+    size_t bytes = 0;
+    double maxRelative = 0.0;
+    double meanRelative = 0.0;
+    double maxAbsolute = 0.0;
+    double packMs = 0.0;
+};
+
+static FormatError Measure(const std::vector<float>& texels, int channels, GLenum internalFormat) {
+    FormatError error;
+    const size_t count = texels.size() / channels;
+    auto start = std::chrono::high_resolution_clock::now();
+    const std::vector<unsigned char> packed = PackHDRPixels(texels.data(), channels, count, internalFormat);
+    error.packMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    error.bytes = packed.size();
+
+    HDRFormatInfo info;
+    GetHDRFormatInfo(internalFormat, info);
+    const std::vector<float> unpacked = UnpackHDRPixels(packed.data(), count, internalFormat);
+    size_t relativeCount = 0;
+    for (size_t i = 0; i < count; ++i) {
+        for (int c = 0; c < channels; ++c) {
+            const double reference = texels[i * channels + c];
+            const double value = c < info.channels ? unpacked[i * info.channels + c] : 0.0;
+            const double absolute = std::fabs(value - reference);
+            error.maxAbsolute = std::max(error.maxAbsolute, absolute);
+            if (std::fabs(reference) > 1e-3) {
+                const double relative = absolute / std::fabs(reference);
+                error.maxRelative = std::max(error.maxRelative, relative);
+                error.meanRelative += relative;
+                ++relativeCount;
+            }
+        }
+    }
+    error.meanRelative /= std::max<size_t>(1, relativeCount);
+    return error;
+}
+
+static void Report(const char* map, GLenum internalFormat, const FormatError& error, size_t baseBytes) {
+    printf("%-10s %-11s %9.1f KB  x%.2f  rel max %.2e mean %.2e  abs max %.2e  pack %.2f ms\n",
+           map, GetHDRFormatName(internalFormat), error.bytes / 1024.0,
+           static_cast<double>(baseBytes) / error.bytes, error.maxRelative, error.meanRelative,
+           error.maxAbsolute, error.packMs);
+}
+
+int main(int argc, char** argv) {
+    const std::string prefilterPath = argc > 1 ? argv[1] : "debug/prefilter.ktx";
+    const std::string lutPath = argc > 2 ? argv[2] : "debug/brdfLUT.ktx";
+
+    // Prefilter cube, every level and face
+    CubeImage prefilter;
+    if (prefilter.LoadKTX(prefilterPath)) {
+        std::vector<float> texels;
+        for (const auto& level : prefilter.levels) {
+            for (const auto& face : level) {
+                texels.insert(texels.end(), face.begin(), face.end());
+            }
+        }
+        const FormatError base = Measure(texels, 3, GL_RGB32F);
+        for (GLenum format : { GL_RGB32F, GL_RGB16F, GL_R11F_G11F_B10F }) {
+            Report("prefilter", format, Measure(texels, 3, format), base.bytes);
+        }
+    } else {
+        fprintf(stderr, "could not load %s\n", prefilterPath.c_str());
+    }
+
+    // BRDF LUT, RG32F as baked
+    gli::texture lut = gli::load(lutPath);
+    if (!lut.empty() && lut.format() == gli::FORMAT_RG32_SFLOAT_PACK32) {
+        const float* data = static_cast<const float*>(lut.data(0, 0, 0));
+        const std::vector<float> texels(data, data + static_cast<size_t>(lut.extent(0).x) * lut.extent(0).y * 2);
+        const FormatError base = Measure(texels, 2, GL_RG32F);
+        for (GLenum format : { GL_RG32F, GL_RG16F }) {
+            Report("brdfLUT", format, Measure(texels, 2, format), base.bytes);
+        }
+    } else {
+        fprintf(stderr, "could not load RG32F LUT %s\n", lutPath.c_str());
+    }
+    return 0;
+}
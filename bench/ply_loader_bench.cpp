@@ -0,0 +1,60 @@
+// Benchmark: native PLY reader against the Assimp import it replaces.
+// Build with the "bench ply loader" task (-O2), run ./ply_loader_bench [file.ply] [repeat]
+#include "model_loader/ply_reader.h"
+#include <chrono>
+#include <cstdio>
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+template<typename F>
+static double TimeMs(F&& f) {
+    auto start = std::chrono::high_resolution_clock::now();
+    f();
+    auto end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+static void Report(const char* name, double ms, size_t vertices, size_t indices, double baseMs) {
+    printf("%-10s %9.2f ms  vertices %9zu  triangles %9zu  x%.2f\n",
+           name, ms, vertices, indices / 3, baseMs / ms);
+}
+
+int main(int argc, char** argv) {
+    const std::string path = argc > 1 ? argv[1] : "assets/models/dragon_vrip.ply";
+    const int repeat = argc > 2 ? std::max(1, atoi(argv[2])) : 5;
+
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+
+    // Best of N, the first run also warms the page cache for both readers
+    double assimpMs = 1e30, nativeMs = 1e30;
+    size_t assimpVertices = 0, assimpIndices = 0;
+    bool ok = true;
+    for (int r = 0; r < repeat && ok; ++r) {
+        assimpMs = std::min(assimpMs, TimeMs([&] { ok = ReadPLYAssimp(path, vertices, indices); }));
+        assimpVertices = vertices.size();
+        assimpIndices = indices.size();
+    }
+    if (!ok) {
+        fprintf(stderr, "Assimp failed to read %s\n", path.c_str());
+        return 1;
+    }
+
+    PLYReadInfo info;
+    for (int r = 0; r < repeat && ok; ++r) {
+        nativeMs = std::min(nativeMs, TimeMs([&] { ok = ReadPLY(path, vertices, indices, true, &info); }));
+    }
+    if (!ok) {
+        fprintf(stderr, "native reader failed to read %s\n", path.c_str());
+        return 1;
+    }
+
+    printf("%s (%s, normals %s, uvs %s), best of %d\n", path.c_str(), info.format,
+           info.hadNormals ? "yes" : "computed", info.hadTexCoords ? "yes" : "no", repeat);
+    Report("assimp", assimpMs, assimpVertices, assimpIndices, assimpMs);
+    Report("native", nativeMs, vertices.size(), indices.size(), assimpMs);
+    // Assimp's JoinIdenticalVertices/ImproveCacheLocality may reorder or merge, so counts can differ slightly
+    return 0;
+}
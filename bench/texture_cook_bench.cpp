@@ -0,0 +1,131 @@
+// Cost and quality of the BCn texture cooker (texture/texture_cooker.h).
+// Build with the "bench texture cooker" task (-O2), run
+//   ./texture_cook_bench [color.jpg normal.jpg roughness.jpg ao.jpg]
+// Every map is cooked like material.cpp does, then level 0 is decoded again on the CPU
+// and compared with the source texels (only the channels the usage keeps).
+// "raw" is what the uncompressed path (LoadLDRToTexture) puts in VRAM with its mips.
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#include "texture/texture_cooker.h"
+#include <gli/gli.hpp>
+#include <gli/load.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Reference decoders, texels are written into a 4x4 RGBA8 block
+static void Decode565(uint16_t c, int out[3]) {
+    const int r = (c >> 11) & 31, g = (c >> 5) & 63, b = c & 31;
+    out[0] = (r << 3) | (r >> 2);
+    out[1] = (g << 2) | (g >> 4);
+    out[2] = (b << 3) | (b >> 2);
+}
+
+static void DecodeBC1(const unsigned char* block, unsigned char* rgba) {
+    const uint16_t c0 = block[0] | block[1] << 8, c1 = block[2] | block[3] << 8;
+    int palette[4][3];
+    Decode565(c0, palette[0]);
+    Decode565(c1, palette[1]);
+    for (int c = 0; c < 3; ++c) {
+        if (c0 > c1) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        } else {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+    const uint32_t indices = block[4] | block[5] << 8 | block[6] << 16 | static_cast<uint32_t>(block[7]) << 24;
+    for (int i = 0; i < 16; ++i) {
+        for (int c = 0; c < 3; ++c) rgba[i * 4 + c] = palette[(indices >> (2 * i)) & 3][c];
+    }
+}
+
+static void DecodeBC4(const unsigned char* block, unsigned char* rgba, int channel) {
+    const int r0 = block[0], r1 = block[1];
+    int palette[8] = { r0, r1 };
+    if (r0 > r1) {
+        for (int i = 1; i < 7; ++i) palette[i + 1] = ((7 - i) * r0 + i * r1) / 7;
+    } else {
+        for (int i = 1; i < 5; ++i) palette[i + 1] = ((5 - i) * r0 + i * r1) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+    uint64_t indices = 0;
+    for (int k = 0; k < 6; ++k) indices |= static_cast<uint64_t>(block[2 + k]) << (8 * k);
+    for (int i = 0; i < 16; ++i) rgba[i * 4 + channel] = palette[(indices >> (3 * i)) & 7];
+}
+
+static double Psnr(const gli::texture& texture, TextureUsage usage, const unsigned char* source, int width, int height) {
+    const unsigned char* data = static_cast<const unsigned char*>(texture.data(0, 0, 0));
+    const size_t blockSize = gli::block_size(texture.format());
+    const int blocksX = (width + 3) / 4;
+    const int channels = usage == TextureUsage::Mask ? 1 : usage == TextureUsage::Normal ? 2 : 3;
+    double squaredError = 0.0;
+    size_t count = 0;
+    for (int by = 0; by < (height + 3) / 4; ++by) {
+        for (int bx = 0; bx < blocksX; ++bx) {
+            const unsigned char* block = data + (static_cast<size_t>(by) * blocksX + bx) * blockSize;
+            unsigned char rgba[64] = {};
+            if (usage == TextureUsage::Mask) {
+                DecodeBC4(block, rgba, 0);
+            } else if (usage == TextureUsage::Normal) {
+                DecodeBC4(block, rgba, 0);
+                DecodeBC4(block + 8, rgba, 1);
+            } else {
+                DecodeBC1(blockSize == 16 ? block + 8 : block, rgba);
+            }
+            for (int y = 0; y < 4; ++y) {
+                for (int x = 0; x < 4; ++x) {
+                    const int px = bx * 4 + x, py = by * 4 + y;
+                    if (px >= width || py >= height) continue;
+                    for (int c = 0; c < channels; ++c) {
+                        const double e = static_cast<double>(rgba[(y * 4 + x) * 4 + c]) - source[(static_cast<size_t>(py) * width + px) * 4 + c];
+                        squaredError += e * e;
+                        ++count;
+                    }
+                }
+            }
+        }
+    }
+    if (squaredError == 0.0) return INFINITY;
+    return 10.0 * std::log10(255.0 * 255.0 / (squaredError / count));
+}
+
+int main(int argc, char** argv) {
+    const std::string defaults[] = { "assets/material/color.jpg", "assets/material/normal.jpg",
+                                     "assets/material/roughness.jpg", "assets/material/ao.jpg" };
+    const TextureUsage usages[] = { TextureUsage::Color, TextureUsage::Normal, TextureUsage::Mask, TextureUsage::Mask };
+
+    for (int i = 0; i < 4; ++i) {
+        const std::string source = argc > i + 1 ? argv[i + 1] : defaults[i];
+        const std::string cooked = "texture_cook_bench_" + std::to_string(i) + ".ktx";
+
+        TextureCookStats stats;
+        if (!TextureCooker::CookFile(source, usages[i], false, cooked, &stats)) {
+            fprintf(stderr, "could not cook %s\n", source.c_str());
+            continue;
+        }
+
+        // Warm load: what Texture2D::LoadCookedKTX reads instead of decoding the image
+        auto start = std::chrono::high_resolution_clock::now();
+        gli::texture texture = gli::load(cooked);
+        const double loadMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+        int width = 0, height = 0, channels = 0;
+        unsigned char* pixels = stbi_load(source.c_str(), &width, &height, &channels, 4);
+        const double psnr = pixels ? Psnr(texture, usages[i], pixels, width, height) : 0.0;
+        stbi_image_free(pixels);
+
+        printf("%-7s %4dx%-4d %2d levels  raw %6.1f MB  cooked %5.1f MB  x%.1f  PSNR %5.1f dB\n",
+               TextureCooker::GetUsageName(usages[i]), stats.width, stats.height, stats.levels,
+               stats.uncompressedBytes / 1048576.0, stats.cookedBytes / 1048576.0,
+               static_cast<double>(stats.uncompressedBytes) / stats.cookedBytes, psnr);
+        printf("        cold: decode %.0f ms  mips %.0f ms  encode %.0f ms  write %.0f ms   warm: load %.1f ms\n",
+               stats.decodeMs, stats.mipMs, stats.encodeMs, stats.writeMs, loadMs);
+    }
+    return 0;
+}
@@ -8,21 +8,33 @@ class AABB {
     public:
         AABB(const std::shared_ptr<Mesh>& mesh);
         AABB();
+        // Box from explicit bounds, UpdateBox transforms it like a mesh box
+        AABB(const glm::vec3& min, const glm::vec3& max);
         ~AABB() = default;
-        // Move the abbbox to the world space and recalculate the min and max
+        // Move the abbbox to the world space and recalculate the min and max.
+        // Transforms the local center/extent directly (Arvo), no allocation
         void UpdateBox(const glm::mat4& model);
+        // Branch-free slab test (RayBoxTest) of the forward ray, t >= 0: a box behind
+        // the origin misses and an origin inside the box hits with tminOut = 0. The exit
+        // distance is widened by a few ulps so rays grazing an edge are not lost.
         bool IntersectRay(const Ray& ray, float& tminOut);
         bool IsValid() const;
         // Setter/getter
         const glm::vec3& GetMin() const { return min; }
         const glm::vec3& GetMax() const { return max; }
-        const std::vector<glm::vec3>& GetVertices() const { return boxVertex; }
+        // Corner and line index data for debug drawing, built on first request
+        const std::vector<glm::vec3>& GetVertices() const;
+        const std::vector<unsigned int>& GetIndices() const;
     private:
         glm::vec3 min;
         glm::vec3 max;
-        std::vector<glm::vec3> boxVertex;
-        std::vector<glm::vec3> originalVertex;
-        std::vector<unsigned int> boxIndices;
+        // Box in mesh space, kept as center/half extent for UpdateBox
+        glm::vec3 localCenter = glm::vec3(0.0f);
+        glm::vec3 localExtent = glm::vec3(0.0f);
+        bool hasLocalBox = false;
+        mutable std::vector<glm::vec3> boxVertex;
+        mutable std::vector<unsigned int> boxIndices;
+        mutable bool verticesDirty = true;
         void CalMinMax(const std::vector<glm::vec3>& vertices);
-        void GenerateBoxVertices();
+        void GenerateBoxVertices() const;
 };
\ No newline at end of file
@@ -0,0 +1,104 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include <limits>
+#include "geometry.h"
+#include "bounding_box/frustum.h"
+#include "bounding_box/ray_packet.h"
+
+class SceneNode;
+
+// 32 bytes. Leaf when count > 0 (items [first, first + count)),
+// otherwise an inner node whose children are first and first + 1.
+struct BVHNode {
+    glm::vec3 min;
+    uint32_t first;
+    glm::vec3 max;
+    uint32_t count;
+};
+static_assert(sizeof(BVHNode) == 32, "BVHNode must stay 32 bytes");
+
+// Depth is capped so traversal stacks have a fixed size
+static constexpr uint32_t BVH_MAX_DEPTH = 48;
+static constexpr int BVH_STACK_SIZE = BVH_MAX_DEPTH + 2;   // traversal pushes at most one extra node per level
+
+// Top-down binned SAH build over item boxes, shared by the scene and mesh trees.
+// Children are allocated next to each other, always after their parent, so a
+// reverse pass over nodes visits children first. order receives the item index
+// for every leaf slot, leaves reference ranges of order.
+void BuildBinnedSAH(const std::vector<glm::vec3>& mins, const std::vector<glm::vec3>& maxs,
+                    uint32_t maxLeafSize, std::vector<BVHNode>& nodes, std::vector<uint32_t>& order);
+// SAH cost of a tree relative to its root: inner areas plus leaf area * item count
+float ComputeSAHCost(const std::vector<BVHNode>& nodes);
+// Both children of an inner node (children[0] and children[1]) in one 4-wide slab test,
+// bit 0 / 1 of the result is set when the first / second child is hit
+uint32_t IntersectChildren(const PacketRay& ray, const BVHNode* children, float tMax, float tEntry[4]);
+
+enum class PickMode {
+    Box,        // closest world box
+    Triangle    // closest triangle of the node's mesh (MeshBVH in mesh space)
+};
+
+// Closest hit of a ray query
+struct BVHHit {
+    SceneNode* node = nullptr;
+    float t = std::numeric_limits<float>::max();  // distance along the ray
+    int32_t triangle = -1;                        // triangle index in the mesh, -1 for box hits
+    float u = 0.0f, v = 0.0f;                     // barycentrics of triangle vertex 1 and 2
+};
+
+// Counters of the query side, reset by the caller
+struct BVHStats {
+    uint64_t builds = 0;
+    uint64_t refits = 0;
+    uint64_t nodesVisited = 0;   // BVH nodes touched by queries
+    uint64_t itemsTested = 0;    // leaf boxes tested by queries
+    uint64_t meshesTested = 0;   // triangle BVH descents of PickMode::Triangle
+};
+
+// ======================SceneBVH==========================
+// Bounding volume hierarchy over the world AABBs of scene nodes.
+// Built top-down with binned SAH, refitted bottom-up when boxes move
+// and rebuilt once refitting has degraded the tree too much.
+// Items are raw node pointers, the owner (Scene) rebuilds the tree
+// before querying whenever the node set may have changed.
+class SceneBVH {
+    public:
+        SceneBVH() {};
+
+        // Build over the given nodes, nodes without a valid world box are ignored
+        void Build(const std::vector<SceneNode*>& nodes);
+        // Re-read the item boxes and recompute node bounds, returns false if a rebuild is advised
+        bool Refit();
+        void Clear();
+
+        // Closest node hit by the ray, by world box or by mesh triangle
+        bool Raycast(const Ray& ray, BVHHit& hit, PickMode mode = PickMode::Box) const;
+        // Append nodes whose world box is inside or intersecting the frustum
+        void QueryFrustum(const Frustum& frustum, std::vector<SceneNode*>& out) const;
+        // Append nodes whose world box overlaps [min, max]
+        void QueryOverlap(const glm::vec3& min, const glm::vec3& max, std::vector<SceneNode*>& out) const;
+
+        bool IsEmpty() const { return this->nodes.empty(); };
+        size_t GetItemCount() const { return this->items.size(); };
+        const BVHStats& GetStats() const { return this->stats; };
+        void ResetStats() { this->stats = BVHStats{}; };
+
+    private:
+        static constexpr uint32_t MAX_LEAF_SIZE = 4;
+
+        std::vector<BVHNode> nodes;
+        // Items in leaf order
+        std::vector<SceneNode*> items;
+        std::vector<glm::vec3> itemMins;
+        std::vector<glm::vec3> itemMaxs;
+        float buildCost = 0.0f;             // SAH cost right after build, refit compares against it
+        mutable BVHStats stats;
+
+        std::vector<uint32_t> order;        // build scratch
+
+        void AppendSubtree(uint32_t nodeIndex, std::vector<SceneNode*>& out) const;
+        // Precise test of one item, ray given in world space
+        bool IntersectItem(uint32_t item, const Ray& ray, float tMax, BVHHit& hit) const;
+};
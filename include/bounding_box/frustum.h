@@ -0,0 +1,24 @@
+#pragma once
+#include <glm/glm.hpp>
+
+// View frustum as 6 planes (left, right, bottom, top, near, far) extracted from a
+// view-projection matrix. Planes are stored as structure of arrays so the box test
+// runs the same multiply-add over all planes and can be vectorized by the compiler.
+class Frustum {
+    public:
+        enum class Result { Outside = 0, Intersect = 1, Inside = 2 };
+
+        Frustum() {};
+        explicit Frustum(const glm::mat4& viewProj) { this->Update(viewProj); };
+        // Extract and normalize planes (Gribb/Hartmann), plane normals point inside
+        void Update(const glm::mat4& viewProj);
+        // Classify a world-space box given by min and max point
+        Result TestAABB(const glm::vec3& min, const glm::vec3& max) const;
+        bool IsVisible(const glm::vec3& min, const glm::vec3& max) const { return this->TestAABB(min, max) != Result::Outside; };
+    private:
+        static constexpr int PLANE_COUNT = 6;
+        alignas(16) float nx[PLANE_COUNT + 2] = {};  // padded to a multiple of 4
+        alignas(16) float ny[PLANE_COUNT + 2] = {};
+        alignas(16) float nz[PLANE_COUNT + 2] = {};
+        alignas(16) float d[PLANE_COUNT + 2] = {};
+};
@@ -0,0 +1,48 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include <limits>
+#include "bounding_box/bvh.h"
+
+struct Vertex;
+
+// Closest triangle hit in mesh space
+struct MeshHit {
+    float t = std::numeric_limits<float>::max();  // ray parameter, in units of the given direction
+    uint32_t triangle = 0;                        // index of the triangle in the mesh index buffer / 3
+    float u = 0.0f, v = 0.0f;                     // barycentrics of vertex 1 and 2, vertex 0 is 1 - u - v
+};
+
+// ======================MeshBVH==========================
+// Triangle BVH of one mesh in mesh space, built with the same binned SAH as
+// the scene tree. Triangle positions are copied in leaf order so a leaf reads
+// one contiguous block. Owned by Mesh and built on the first query, so every
+// SceneNode instancing the mesh shares it.
+class MeshBVH {
+    public:
+        MeshBVH() {};
+
+        void Build(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices);
+        void Build(const Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount);
+        // From bare positions (meshes that only keep positions in CPU memory)
+        void Build(const glm::vec3* positions, size_t vertexCount, const unsigned int* indices, size_t indexCount);
+
+        // Closest hit with t in (0, hit.t), hit.t is the initial search distance.
+        // direction does not need to be normalized.
+        bool Intersect(const glm::vec3& origin, const glm::vec3& direction, MeshHit& hit) const;
+
+        bool IsEmpty() const { return this->nodes.empty(); };
+        size_t GetTriangleCount() const { return this->triangleIds.size(); };
+        size_t GetMemoryBytes() const;
+
+    private:
+        static constexpr uint32_t MAX_LEAF_SIZE = 4;
+
+        std::vector<BVHNode> nodes;
+        std::vector<glm::vec3> positions;     // 3 per triangle, in leaf order
+        std::vector<uint32_t> triangleIds;    // original triangle index, in leaf order
+
+        template<typename PositionOf>
+        void BuildFrom(PositionOf positionOf, size_t vertexCount, const unsigned int* indices, size_t indexCount);
+};
@@ -0,0 +1,70 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+
+// ======================Ray packets==========================
+// Branch-free slab tests of one ray against several boxes and of several rays
+// against one box. Boxes and rays are stored as structure of arrays so every
+// lane runs the same min/max sequence. Backends: AVX2 (8 wide, when compiled
+// with -mavx2), SSE, NEON (Apple Silicon) and a scalar fallback.
+//
+// Inverse directions are precomputed, a zero component gives +-inf and the slab
+// becomes [-inf, inf] or empty. A ray lying exactly on a slab plane gives NaN,
+// min/max are ordered so NaN never tightens the interval, which matches the
+// inclusive test of AABB::IntersectRay.
+
+#if defined(__AVX2__)
+#define RAY_PACKET_AVX2 1
+#endif
+#if defined(__SSE2__) || defined(_M_X64)
+#define RAY_PACKET_SSE 1
+#elif defined(__ARM_NEON)
+#define RAY_PACKET_NEON 1
+#endif
+
+// Ray with the inverse direction precomputed once
+struct PacketRay {
+    glm::vec3 origin;
+    glm::vec3 invDir;
+    PacketRay(const glm::vec3& origin, const glm::vec3& direction)
+        : origin(origin), invDir(1.0f / direction) {}
+};
+
+// Scalar slab test against a precomputed inverse direction, used for single
+// ray traversal. tEntry is clamped to 0 for origins inside the box
+bool RayBoxTest(const glm::vec3& origin, const glm::vec3& invDir,
+                const glm::vec3& min, const glm::vec3& max, float tMax, float& tEntry);
+
+// 4 boxes, unused lanes should be left empty (min > max)
+struct alignas(16) AABB4 {
+    float minX[4], minY[4], minZ[4];
+    float maxX[4], maxY[4], maxZ[4];
+    void Set(int lane, const glm::vec3& min, const glm::vec3& max);
+    void Clear();
+};
+
+// 8 boxes for the AVX2 path, split into two AABB4 on other backends
+struct alignas(32) AABB8 {
+    float minX[8], minY[8], minZ[8];
+    float maxX[8], maxY[8], maxZ[8];
+    void Set(int lane, const glm::vec3& min, const glm::vec3& max);
+    void Clear();
+};
+
+// 4 rays against one box, unused lanes should have tMax < 0
+struct alignas(16) RayPacket4 {
+    float originX[4], originY[4], originZ[4];
+    float invDirX[4], invDirY[4], invDirZ[4];
+    float tMax[4];
+    void Set(int lane, const PacketRay& ray, float tMax);
+};
+
+// One ray against 4 / 8 boxes. Returns a bit mask of hit lanes, tEntry receives the
+// entry distance (clamped to 0) of every lane. Hits must have entry <= tMax.
+uint32_t IntersectRayAABB4(const PacketRay& ray, const AABB4& boxes, float tMax, float tEntry[4]);
+uint32_t IntersectRayAABB8(const PacketRay& ray, const AABB8& boxes, float tMax, float tEntry[8]);
+// 4 rays against one box, same conventions
+uint32_t IntersectRay4AABB(const RayPacket4& rays, const glm::vec3& min, const glm::vec3& max, float tEntry[4]);
+
+// Name of the compiled backend, for logs and the benchmark
+const char* GetRayPacketBackend();
@@ -15,11 +15,51 @@ constexpr unsigned ROUGHNESS_TEXTURE_UNIT  = 2;
 constexpr unsigned METALNESS_TEXTURE_UNIT  = 3;
 constexpr unsigned AO_TEXTURE_UNIT         = 4;
 constexpr unsigned EMISSIVE_TEXTURE_UNIT   = 5;
-constexpr unsigned IRRADIANCE_TEXTURE_UNIT = 6;
+// unit 6 held the irradiance cubemap, irradiance is SH9 uniforms now (Environment)
 constexpr unsigned PREFILTER_TEXTURE_UNIT  = 7;
 constexpr unsigned BRDFLUT_TEXTURE_UNIT    = 8;
 constexpr unsigned SKYBOX_TEXTURE_UNIT     = 9;
 
+// uniform buffer binding points
+constexpr unsigned MATERIAL_BLOCK_BINDING  = 0;
+
+// Print per-frame render statistics every N frames (0 to disable)
+constexpr unsigned STATS_PRINT_INTERVAL    = 300;
+
+// Streaming model load: per-frame upload budget of the render thread
+constexpr double   STREAM_BUDGET_MS        = 4.0;
+constexpr unsigned STREAM_BUDGET_BYTES     = 32u * 1024u * 1024u;
+
+// Directory of the pre-baked mesh caches (MeshCache), relative to the working directory
+constexpr const char* MESH_CACHE_DIR       = "cache/meshes";
+
+// Material textures are cooked to BCn KTX files (texture/texture_cooker.h) on first
+// load and uploaded compressed from then on. Texture2D::SetCookTextures changes it at runtime.
+constexpr bool     COOK_TEXTURES           = true;
+constexpr const char* TEXTURE_CACHE_DIR    = "cache/textures";
+
+// Mesh optimization (mesh_optimizer.h): FIFO size of the simulated post-transform
+// cache for ACMR/ATVR, and how much ACMR the overdraw clustering may give up
+constexpr unsigned MESH_OPT_CACHE_SIZE     = 16;
+constexpr float    MESH_OPT_OVERDRAW_SLACK = 1.05f;
+
+// Upload meshes with the 20 byte CompactVertex layout (vertex_format.h) instead of
+// the 56 byte float Vertex. Mesh::SetCompactVertices changes it at runtime.
+constexpr bool     COMPACT_VERTICES        = true;
+// Generic attribute locations of the per-draw position dequantization (pbr_tex.vert)
+constexpr unsigned DEQUANT_SCALE_LOCATION  = 7;
+constexpr unsigned DEQUANT_OFFSET_LOCATION = 8;
+
+// CPU IBL baker (cubemap/ibl_baker.h), map sizes match what main.cpp loads
+constexpr unsigned IBL_ENV_SIZE            = 512;
+constexpr unsigned IBL_IRRADIANCE_SIZE     = 32;
+constexpr unsigned IBL_PREFILTER_SIZE      = 128;
+constexpr unsigned IBL_PREFILTER_SAMPLES   = 1024;
+constexpr unsigned IBL_BRDF_LUT_SIZE       = 512;
+constexpr unsigned IBL_BRDF_LUT_SAMPLES    = 1024;
+// Irradiance convolves the environment mip no larger than this
+constexpr unsigned IBL_IRRADIANCE_SOURCE_SIZE = 32;
+
 // Camera parameters for sampling of skybox/cubemap
 constexpr glm::vec3 CAMERA_POS = glm::vec3(0.0f, 0.0f, 0.0f);
 
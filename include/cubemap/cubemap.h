@@ -6,19 +6,28 @@
 #include <iostream>
 
 
+struct CubeImage;
+
 // For HDR cubemap
-// internal format: GL_RGB32F;
+// internal format: GL_RGB32F by default, GL_RGB16F / GL_R11F_G11F_B10F store the same
+// data in half / a third of the memory (texture/hdr_format.h)
 class Cubemap {
     public:
         Cubemap();
-        Cubemap(unsigned int size, int mipLevels); // Create empty cubemap
-        void LoadKTXToCubemap(const std::string& path); // Load ktx file into cubemap texture
-        void LoadEquiToCubemap(const std::string& path); // Load and convert hdr equirectangular image to cubemap.
+        Cubemap(unsigned int size, int mipLevels, GLenum internalFormat = GL_RGB32F); // Create empty cubemap
+        // Load ktx file into cubemap texture, float data in another HDR format is
+        // converted to the cubemap's internal format on the CPU
+        void LoadKTXToCubemap(const std::string& path);
+        // Load and convert hdr equirectangular image to cubemap. The conversion runs on the CPU
+        // (IBLBaker::EquirectToCube) and is cached as a KTX next to the HDR, later loads map
+        // that file and upload straight from it. A default constructed cubemap takes width / 4.
+        void LoadEquiToCubemap(const std::string& path);
         void SetCubemapTex(GLuint tex) { this->cubemap = tex; };
         void Bind(GLuint unit);
         void Unbind();
         GLuint GetTexture() const { return this->cubemap; };
         int GetMipLevels() const { return this->mipLevels; };
+        GLenum GetInternalFormat() const { return this->internalFormat; };
     protected:
         GLuint cubemap = 0;
         GLenum internalFormat;
@@ -28,6 +37,14 @@ class Cubemap {
         int mipLevels;
         int totalMipLevels;
         void InitializeCubemap();
+        // <dir>/<name>.cube<size>[m].<format>.ktx next to the HDR, m when it holds the mip chain
+        std::string GetEquiCachePath(const std::string& path) const;
+        // Upload an uncompressed KTX cubemap from a file mapping, false if it does not match
+        // this cubemap (size, levels, internal format)
+        bool LoadMappedKTX(const std::string& path);
+        // Float image packed to the internal format on the CPU
+        void UploadCubeImage(const CubeImage& image);
+        void SetSamplerParameters(bool mipmapped);
 
 };
 
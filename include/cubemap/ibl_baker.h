@@ -0,0 +1,115 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <array>
+#include <string>
+#include <vector>
+#include "config.h"
+#include "texture/hdr_format.h"
+
+// ======================IBL Baker==========================
+// CPU replacement of the GPU precompute passes: takes an equirectangular HDR and
+// bakes the irradiance map, the GGX prefiltered specular map and the BRDF LUT into
+// KTX files that Cubemap::LoadKTXToCubemap / Texture2D::LoadKTXToTexture read.
+// No GL context is needed, so environments can be re-baked in batch on build machines
+// (tools/ibl_bake.cpp).
+//  - irradiance: exact cosine convolution over a small mip of the environment,
+//    4 source texels per SIMD step
+//  - prefilter: GGX importance sampling (Hammersley, N = V = R) with the sample
+//    mip chosen from its pdf, samples are precomputed once per roughness level
+//  - BRDF LUT: split sum scale/bias, 4 GGX samples per SIMD step
+// Work is split into face rows (LUT rows) and run on ThreadPool.
+// Values follow the shaders: irradiance is (1/pi) * integral of L cos, prefilter
+// level l has roughness l / (levels - 1), the LUT is indexed by (NdotV, roughness).
+
+// Float RGB image loaded from an equirectangular HDR, row 0 is the top (v = 0)
+struct EquirectImage {
+    int width = 0;
+    int height = 0;
+    std::vector<float> rgb;
+
+    bool Load(const std::string& path);
+    // Bilinear lookup with the mapping of shader/equi.frag
+    glm::vec3 Sample(const glm::vec3& direction) const;
+    // Bilinear lookup at texel coordinates (texel centers at integers)
+    glm::vec3 SampleTexel(float fx, float fy) const;
+};
+
+// Float RGB cubemap with a mip chain, faces in GL order (+X, -X, +Y, -Y, +Z, -Z)
+// and rows in glTexImage2D order
+struct CubeImage {
+    int size = 0;
+    std::vector<std::array<std::vector<float>, 6>> levels;
+
+    // Allocate levelCount levels (0: the full chain down to 1x1)
+    void Allocate(int size, int levelCount);
+    int GetLevelCount() const { return static_cast<int>(this->levels.size()); };
+    int GetLevelSize(int level) const { return std::max(1, this->size >> level); };
+    // Unit direction through the center of texel (x, y) of a face of size faceSize
+    static glm::vec3 TexelDirection(int face, int x, int y, int faceSize);
+    // Solid angle a texel of a face of size faceSize covers
+    static float TexelSolidAngle(int x, int y, int faceSize);
+    // Bilinear inside the face (no filtering across edges), trilinear between levels
+    glm::vec3 Sample(const glm::vec3& direction, float lod = 0.0f) const;
+    // Box filter level 0 down into the remaining levels
+    void GenerateMipmaps();
+    // Float RGB(A) KTX cubemap in any HDR storage format, e.g. one written by IBLBaker::SaveCubeKTX
+    bool LoadKTX(const std::string& path);
+};
+
+struct IBLBakeSettings {
+    unsigned envSize = IBL_ENV_SIZE;                    // environment cube the other maps sample
+    unsigned irradianceSize = IBL_IRRADIANCE_SIZE;
+    unsigned prefilterSize = IBL_PREFILTER_SIZE;        // level count is log2(size) + 1
+    unsigned prefilterSamples = IBL_PREFILTER_SAMPLES;
+    unsigned brdfLUTSize = IBL_BRDF_LUT_SIZE;
+    unsigned brdfLUTSamples = IBL_BRDF_LUT_SAMPLES;
+    // Storage formats of the written KTX files (texture/hdr_format.h)
+    GLenum irradianceFormat = GL_RGB16F;
+    GLenum prefilterFormat = PREFILTER_FORMAT;
+    GLenum brdfLUTFormat = BRDF_LUT_FORMAT;
+};
+
+struct IBLBakeStats {
+    double loadMs = 0.0;
+    double cubeMs = 0.0;
+    double irradianceMs = 0.0;
+    double prefilterMs = 0.0;
+    double brdfLUTMs = 0.0;
+    double writeMs = 0.0;
+};
+
+class IBLBaker {
+    public:
+        explicit IBLBaker(const IBLBakeSettings& settings = IBLBakeSettings());
+
+        // Load an equirectangular HDR into the environment cube (with mips)
+        bool LoadEquirect(const std::string& path);
+        const CubeImage& GetEnvironment() const { return this->environment; };
+
+        // Passes over the loaded environment (the LUT does not depend on it)
+        CubeImage BakeIrradiance();
+        CubeImage BakePrefilter();
+        std::vector<float> BakeBRDFLUT();   // RG pairs, brdfLUTSize squared
+
+        // Cubemap / 2D KTX packed to internalFormat on the CPU: any RGB(A) HDR format for
+        // cubes, RG32F or RG16F for the LUT. The files under debug/ are RGB32F / RG32F.
+        static bool SaveCubeKTX(const CubeImage& cube, const std::string& path, GLenum internalFormat = GL_RGB32F);
+        static bool SaveBRDFLUTKTX(const std::vector<float>& lut, unsigned size, const std::string& path,
+                                   GLenum internalFormat = GL_RG32F);
+
+        // Whole pipeline: outDir/irradiance.ktx and outDir/prefilter.ktx, plus
+        // outDir/brdfLUT.ktx when writeBRDFLUT is set
+        bool Bake(const std::string& hdrPath, const std::string& outDir, bool writeBRDFLUT);
+
+        const IBLBakeStats& GetStats() const { return this->stats; };
+        void PrintStats() const;
+
+        // Equirect to cube level 0, parallel over face rows, SIMD texel coordinates
+        static void EquirectToCube(const EquirectImage& equirect, CubeImage& cube);
+
+    private:
+        IBLBakeSettings settings;
+        CubeImage environment;
+        IBLBakeStats stats;
+};
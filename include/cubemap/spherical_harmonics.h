@@ -0,0 +1,29 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <array>
+#include "cubemap/ibl_baker.h"
+
+// ======================SH9==========================
+// Third order real spherical harmonics (9 RGB coefficients) of a function on the
+// sphere. Irradiance is smooth enough that SH9 keeps it within a few percent
+// (Ramamoorthi & Hanrahan 2001), so the shader evaluates 9 coefficients instead
+// of sampling an irradiance cubemap.
+struct SH9 {
+    std::array<glm::vec3, 9> coefficients{};
+
+    // Basis functions at a unit direction, in coefficient order
+    static std::array<float, 9> Basis(const glm::vec3& n);
+    glm::vec3 Evaluate(const glm::vec3& n) const;
+
+    // Radiance to irradiance / pi (the scale of the irradiance cubemap): bands are
+    // scaled by the clamped cosine convolution pi, 2pi/3, pi/4, then divided by pi
+    SH9 ConvolveCosine() const;
+
+    // Projection weighted by solid angle, face rows (image rows) are summed on
+    // ThreadPool and the partial sums reduced in a fixed order
+    static SH9 Project(const CubeImage& cube, int level = 0);
+    static SH9 Project(const EquirectImage& equirect);
+
+    // Per color channel coefficient matrices for the shader (column major, basis i at [i / 3][i % 3])
+    glm::mat3 GetChannelMatrix(int channel) const;
+};
@@ -1,10 +1,11 @@
 #pragma once
 #include "cubemap/cubemap.h"
+#include "cubemap/spherical_harmonics.h"
 #include "texture/texture.h"
 #include "shader.h"
 #include <iostream>
 
-// PBR - irradiance map, prefilter map and BRDF LUT
+// PBR - irradiance (as SH9), prefilter map and BRDF LUT
 class Environment {
     public:
         Environment(const std::shared_ptr<Cubemap>& irradiance, 
@@ -12,15 +13,19 @@ class Environment {
                     const std::shared_ptr<Texture2D>& brdflut);
         Environment();
         ~Environment();
+        // Irradiance cubemap KTX, projected to SH9 on the CPU (nothing is uploaded)
         void LoadIrradianceMap(const std::string& irradiancePath, unsigned int size);
+        // Irradiance of an environment: equirectangular HDR or radiance cubemap KTX
+        bool ComputeIrradianceSH(const std::string& environmentPath);
+        void SetIrradianceSH(const SH9& sh) { this->irradianceSH = sh; };
+        const SH9& GetIrradianceSH() const { return this->irradianceSH; };
         void LoadPrefilterMap(const std::string& prefilterPath, unsigned int size, unsigned int mipLevels);
         void LoadBRDFLut(const std::string& brdflutPath, unsigned int size);
         void UploadToShader(const std::shared_ptr<Shader>& shader);
-        GLuint GetIrradiance() const { return this->irradiance->GetTexture(); };
         GLuint GetPrefilter() const { return this->prefilter->GetTexture(); };
         GLuint GetBRDFLUT() const { return this->brdflut->GetTexture(); };
     private:
-        std::shared_ptr<Cubemap> irradiance = nullptr;    // Irradiance map
+        SH9 irradianceSH;                                 // Irradiance / pi
         std::shared_ptr<Cubemap> prefilter = nullptr;     // Prefilter map
         std::shared_ptr<Texture2D> brdflut = nullptr;     // BRDF LUT
 };
\ No newline at end of file
@@ -1,7 +1,10 @@
 #pragma once
 #include <vector>
+#include <memory>
+#include <utility>
 #include "stb_image.h"
 #include "shader.h"
+#include "mesh_optimizer.h"
 
 // ========================Gemoetry==========================
 // Provide concise data strcture for storing baisc object for
@@ -45,6 +48,27 @@ struct Vertex {
     glm::vec3 bitangent;
 };
 
+class MeshBVH;
+struct CompactVertex;
+
+// GPU arrays of a mesh baked ahead of the upload (MeshCache), handed to GL as they
+// are instead of being packed again from the Vertex array
+struct MeshGPUArrays {
+    const CompactVertex* compactVertices = nullptr;     // vertexCount entries
+    const uint16_t* narrowIndices = nullptr;            // indexCount entries, nullptr when an index needs 32 bits
+    glm::vec3 dequantScale = glm::vec3(1.0f);
+    glm::vec3 dequantOffset = glm::vec3(0.0f);
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+};
+
+// What a Mesh keeps in CPU memory once its GL buffers are uploaded
+enum class MeshResidency {
+    Keep,           // full Vertex and index arrays
+    PositionsOnly,  // positions and indices: bounds and triangle picking still work
+    Drop,           // nothing but the bounds, triangle picking falls back to the box
+};
+
 class Mesh {
     public:
         Mesh();
@@ -57,21 +81,86 @@ class Mesh {
         void SetVAO(const unsigned int VAO) { this->VAO = VAO; };
         void SetEBO(const unsigned int EBO) { this->EBO = EBO; };
 
+        // CPU arrays, empty when the mesh was uploaded from external memory or its
+        // residency released them
         const std::vector<struct Vertex>& GetVertices() const { return this->vertices; };
         const std::vector<unsigned int>& GetIndices() const { return this->indices; };
-        void SetVertices(std::vector<struct Vertex> vertices) { this->vertices = vertices; };
-        void SetIndices(std::vector<unsigned int> indices) { this->indices = indices; };
+        void SetVertices(std::vector<struct Vertex> vertices) { this->vertices = std::move(vertices); this->optimized = false; this->ReleaseExternal(); };
+        void SetIndices(std::vector<unsigned int> indices) { this->indices = std::move(indices); this->optimized = false; this->ReleaseExternal(); };
+
+        // Vertex/index data the mesh draws: the CPU arrays or the external memory
+        const Vertex* GetVertexData() const { return this->externalVertices ? this->externalVertices : this->vertices.data(); };
+        size_t GetVertexCount() const { return this->externalVertices ? this->externalVertexCount : this->vertices.size(); };
+        const unsigned int* GetIndexData() const { return this->externalIndices ? this->externalIndices : this->indices.data(); };
+        size_t GetIndexCount() const { return this->externalIndices ? this->externalIndexCount : this->indices.size(); };
+
+        // Triangle BVH for ray queries, built from vertices (or kept positions) and indices
+        // on first use and shared by every node drawing this mesh
+        const MeshBVH& GetBVH() const;
+        // False when the triangles are gone (MeshResidency::Drop before the BVH was built)
+        bool CanPickTriangles() const;
+
+        // Mesh space bounds, computed at upload so they outlive the CPU arrays
+        bool HasBounds() const { return this->hasBounds; };
+        const glm::vec3& GetBoundsMin() const { return this->boundsMin; };
+        const glm::vec3& GetBoundsMax() const { return this->boundsMax; };
+
+        // Residency policy, applied after every upload. Setting it on an uploaded mesh
+        // applies it right away (released data does not come back).
+        void SetResidency(MeshResidency residency);
+        MeshResidency GetResidency() const { return this->residency; };
+        // Policy of meshes created from now on (default PositionsOnly)
+        static void SetDefaultResidency(MeshResidency residency) { Mesh::defaultResidency = residency; };
+        static MeshResidency GetDefaultResidency() { return Mesh::defaultResidency; };
+
+        // Memory by category: heap arrays (vertices, positions, indices), mapped
+        // MeshCache data this mesh references, and its triangle BVH
+        size_t GetCPUVertexBytes() const { return this->vertices.capacity() * sizeof(Vertex); };
+        size_t GetCPUPositionBytes() const { return this->positions.capacity() * sizeof(glm::vec3); };
+        size_t GetCPUIndexBytes() const { return this->indices.capacity() * sizeof(unsigned int); };
+        size_t GetMappedBytes() const {
+            return (this->externalVertices ? this->externalVertexCount * sizeof(Vertex) : 0) +
+                   (this->externalIndices ? this->externalIndexCount * sizeof(unsigned int) : 0);
+        };
+        size_t GetBVHBytes() const;
         
         void Init();
         virtual void Draw();
-        // Initialize VBO VAO and EBO buffers based on vertices and indices data 
+        // Initialize VBO VAO and EBO buffers based on vertices and indices data,
+        // optimizing their order first (once) unless disabled
         void SetupBuffers();
+        // Upload straight from memory owned elsewhere (a mapped MeshCache file) without
+        // copying it into the CPU arrays. owner keeps that memory alive for bounds and picking,
+        // gpuArrays (same owner) replaces packing the vertices and narrowing the indices.
+        void SetupBuffersExternal(std::shared_ptr<const void> owner,
+                                  const Vertex* vertices, size_t vertexCount,
+                                  const unsigned int* indices, size_t indexCount,
+                                  const MeshGPUArrays* gpuArrays = nullptr);
 
         // API for model loader to bypass tangent/bitangent calculation
         void LoadFromModel(std::vector<Vertex> vertices, std::vector<unsigned int> indices);
+
+        // Vertex cache / overdraw / vertex fetch reordering of the CPU arrays (mesh_optimizer.h)
+        const MeshOptimizeStats& Optimize();
+        // The arrays were already optimized elsewhere (e.g. on a loader worker thread)
+        void MarkOptimized(const MeshOptimizeStats& stats) { this->optimizeStats = stats; this->optimized = true; };
+        bool IsOptimized() const { return this->optimized; };
+        const MeshOptimizeStats& GetOptimizeStats() const { return this->optimizeStats; };
+        // Whether SetupBuffers optimizes meshes that are not optimized yet (default on)
+        static void SetOptimizeOnUpload(bool enabled) { Mesh::optimizeOnUpload = enabled; };
+        static bool GetOptimizeOnUpload() { return Mesh::optimizeOnUpload; };
+
+        // GPU vertex layout of meshes uploaded from now on: CompactVertex or Vertex
+        static void SetCompactVertices(bool enabled) { Mesh::compactVertices = enabled; };
+        static bool GetCompactVertices() { return Mesh::compactVertices; };
+        bool IsCompact() const { return this->compact; };
+        // Vertex and index bytes in the GL buffers
+        size_t GetGPUBytes() const { return this->gpuBytes; };
+        // GL_UNSIGNED_SHORT when every index fits in 16 bits, else GL_UNSIGNED_INT
+        unsigned int GetIndexType() const { return this->indexType; };
         
     protected:
-        bool initialized;
+        bool initialized = false;   // Init ran, the arrays may be released since
 
         std::vector<struct Vertex> vertices{};
         std::vector<unsigned int> indices{};
@@ -80,6 +169,39 @@ class Mesh {
         unsigned int VAO = 0;
         unsigned int EBO = 0;
 
+        mutable std::shared_ptr<MeshBVH> bvh;
+
+        bool optimized = false;
+        MeshOptimizeStats optimizeStats;
+        static bool optimizeOnUpload;
+
+        // GPU layout of this mesh, position = stored * dequantScale + dequantOffset
+        bool compact = false;
+        glm::vec3 dequantScale = glm::vec3(1.0f);
+        glm::vec3 dequantOffset = glm::vec3(0.0f);
+        size_t gpuBytes = 0;
+        size_t drawIndexCount = 0;
+        unsigned int indexType = GL_UNSIGNED_INT;
+        static bool compactVertices;
+
+        MeshResidency residency = Mesh::defaultResidency;
+        std::vector<glm::vec3> positions{};     // MeshResidency::PositionsOnly
+        bool hasBounds = false;
+        glm::vec3 boundsMin = glm::vec3(0.0f);
+        glm::vec3 boundsMax = glm::vec3(0.0f);
+        static MeshResidency defaultResidency;
+
+        std::shared_ptr<const void> externalOwner;
+        const Vertex* externalVertices = nullptr;
+        const unsigned int* externalIndices = nullptr;
+        size_t externalVertexCount = 0;
+        size_t externalIndexCount = 0;
+
+        void ReleaseExternal();
+        void ApplyResidency();
+        void UploadBuffers(const Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount,
+                           const MeshGPUArrays* gpuArrays = nullptr);
+
         virtual void GenerateVertices() {};
         virtual void GenerateIndices() {};
 };
@@ -0,0 +1,32 @@
+#pragma once
+#include <string>
+#include <cstddef>
+
+// ======================MappedFile==========================
+// Read-only mapping of a whole file (POSIX mmap). Pages are read from disk on
+// first touch, so parsers can walk the bytes in place without a read buffer.
+class MappedFile {
+    public:
+        MappedFile() {};
+        ~MappedFile();
+        MappedFile(MappedFile&& other) noexcept;
+        MappedFile& operator=(MappedFile&& other) noexcept;
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        // False when the file cannot be opened or mapped (an empty file maps to nothing)
+        bool Open(const std::string& path);
+        void Close();
+
+        // Hints for the kernel: read ahead aggressively / the whole file is needed soon
+        void AdviseSequential() const;
+        void AdviseWillNeed() const;
+
+        bool IsOpen() const { return this->data != nullptr; };
+        const unsigned char* GetData() const { return this->data; };
+        size_t GetSize() const { return this->size; };
+
+    private:
+        const unsigned char* data = nullptr;
+        size_t size = 0;
+};
@@ -4,32 +4,87 @@
 #include <glm/glm.hpp>
 #include "texture/texture.h"
 #include "shader.h"
+#include <vector>
+#include <cstddef>
+
+// std140 layout of the "MaterialBlock" uniform block in pbr_tex.frag
+// bools are 4 bytes in std140, so they are stored as int
+struct MaterialBlock {
+    glm::vec3 baseColor;        float baseAlpha;
+    glm::vec3 emissive;         float roughness;
+    float metalness;            float ao;
+    float alphaCutoff;          float normalScale;
+    int alphaMode;              int doubleSided;
+    int useVertexTangent;       int useAlbedoMap;
+    int useRoughnessMap;        int useMetalnessMap;
+    int useNormalMap;           int useAOMap;
+    int useRoughnessMetalMap;   int useEmissiveMap;
+};
+static_assert(offsetof(MaterialBlock, baseAlpha)   == 12, "MaterialBlock must match std140");
+static_assert(offsetof(MaterialBlock, emissive)    == 16, "MaterialBlock must match std140");
+static_assert(offsetof(MaterialBlock, metalness)   == 32, "MaterialBlock must match std140");
+static_assert(offsetof(MaterialBlock, alphaMode)   == 48, "MaterialBlock must match std140");
+static_assert(sizeof(MaterialBlock) == 88, "MaterialBlock must match std140");
+
+// Counters of the shared material buffer, reset once per frame by the caller
+struct MaterialBlockStats {
+    uint64_t blockUploads = 0;   // glBufferSubData of a changed material
+    uint64_t rangeBinds = 0;     // glBindBufferRange issued
+    uint64_t bindsSkipped = 0;   // draws that reused the bound material range
+};
+
+// One uniform buffer shared by all PBRMaterials, each material owns a slot
+// aligned to GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT. A draw only rebinds the
+// range of its slot instead of pushing every uniform.
+class MaterialBlockBuffer {
+    public:
+        static MaterialBlockBuffer& Get();
+        int Allocate();
+        void Release(int slot);
+        void Update(int slot, const MaterialBlock& block);
+        void Bind(int slot);
+        GLuint GetBuffer() const { return this->ubo; };
+        const MaterialBlockStats& GetStats() const { return this->stats; };
+        void ResetStats() { this->stats = MaterialBlockStats{}; };
+    private:
+        MaterialBlockBuffer() {};
+        GLuint ubo = 0;
+        GLsizeiptr stride = 0;               // aligned size of one slot
+        int capacity = 0;                    // slots allocated on GPU
+        int slotCount = 0;                   // slots handed out
+        int boundSlot = -1;                  // slot currently bound to MATERIAL_BLOCK_BINDING
+        std::vector<int> freeSlots;
+        std::vector<unsigned char> shadow;   // CPU copy, used to refill the buffer when it grows
+        MaterialBlockStats stats;
+        void Grow(int minCapacity);
+};
 
 
 class PBRMaterial {
     public:
         enum class AlphaMode { Opaque = 0, Mask = 1, Blend = 2}; // Alpha mode
         PBRMaterial();
+        ~PBRMaterial();
         // -------Texture Setter--------
-        void SetAlbedoMap(const std::shared_ptr<Texture2D>& texture) { this->albedoMap = texture; };
-        void SetRoughnessMap(const std::shared_ptr<Texture2D>& texture) { this->roughnessMap = texture; };
-        void SetMetalnessMap(const std::shared_ptr<Texture2D>& texture) { this->metalnessMap = texture; };
-        void SetNormalMap(const std::shared_ptr<Texture2D>& texture) { this->normalMap = texture; };
-        void SetAOMap(const std::shared_ptr<Texture2D>& texture) { this->aoMap = texture; }; 
-        void SetRoughnessMetalMap(const std::shared_ptr<Texture2D>& texture) { this->roughnessMetalMap = texture; };
-        void SetEmissiveMap(const std::shared_ptr<Texture2D>& texture) { this->emissiveMap = texture; };
-        void SetRoughness(float roughness) { this->roughness = roughness; };
-        void SetMetalness(float metalness) { this->metalness = metalness; };
-        void SetBaseColor(glm::vec3 baseColor) { this->baseColor = baseColor; };
-        void SetAO(float aoFactor) { this->aoFactor = aoFactor; };
-        void SetEmissive(glm::vec3 emissiveFactor) { this->emissiveFactor = emissiveFactor; };
-        void SetUseVertexTangent(bool enable) { this->useVertexTangent = enable; };
-        void SetNormalScale(float scale) { this->normalScale = scale; };
+        void SetAlbedoMap(const std::shared_ptr<Texture2D>& texture) { this->albedoMap = texture; this->blockDirty = true; };
+        void SetRoughnessMap(const std::shared_ptr<Texture2D>& texture) { this->roughnessMap = texture; this->blockDirty = true; };
+        void SetMetalnessMap(const std::shared_ptr<Texture2D>& texture) { this->metalnessMap = texture; this->blockDirty = true; };
+        void SetNormalMap(const std::shared_ptr<Texture2D>& texture) { this->normalMap = texture; this->blockDirty = true; };
+        void SetAOMap(const std::shared_ptr<Texture2D>& texture) { this->aoMap = texture; this->blockDirty = true; }; 
+        void SetRoughnessMetalMap(const std::shared_ptr<Texture2D>& texture) { this->roughnessMetalMap = texture; this->blockDirty = true; };
+        void SetEmissiveMap(const std::shared_ptr<Texture2D>& texture) { this->emissiveMap = texture; this->blockDirty = true; };
+        void SetRoughness(float roughness) { this->roughness = roughness; this->blockDirty = true; };
+        void SetMetalness(float metalness) { this->metalness = metalness; this->blockDirty = true; };
+        void SetBaseColor(glm::vec3 baseColor) { this->baseColor = baseColor; this->blockDirty = true; };
+        void SetAO(float aoFactor) { this->aoFactor = aoFactor; this->blockDirty = true; };
+        void SetEmissive(glm::vec3 emissiveFactor) { this->emissiveFactor = emissiveFactor; this->blockDirty = true; };
+        void SetUseVertexTangent(bool enable) { this->useVertexTangent = enable; this->blockDirty = true; };
+        void SetNormalScale(float scale) { this->normalScale = scale; this->blockDirty = true; };
         // -----Transparent Setter------
-        void SetAlphaMode(AlphaMode m) { alphaMode = m; }
-        void SetAlphaCutoff(float c)   { alphaCutoff = c; }
-        void SetDoubleSided(bool b)    { doubleSided = b; }
-        void SetBaseAlpha(float a)     { baseAlpha = a; }
+        void SetAlphaMode(AlphaMode m) { alphaMode = m; blockDirty = true; }
+        void SetAlphaCutoff(float c)   { alphaCutoff = c; blockDirty = true; }
+        void SetDoubleSided(bool b)    { doubleSided = b; blockDirty = true; }
+        void SetBaseAlpha(float a)     { baseAlpha = a; blockDirty = true; }
         // ------Texture Loader--------
         void LoadAlbedoMap(const std::string& path);
         void LoadRoughnessMap(const std::string& path);
@@ -55,6 +110,12 @@ class PBRMaterial {
         std::shared_ptr<Texture2D> GetEmissiveMap() const { return this->emissiveMap; };
         // Upload all the texture/parameters to shader
         void UploadToShader(const std::shared_ptr<Shader>& shader) const;
+        // Same as UploadToShader, but the shader must already be in use
+        void UploadToBoundShader(const std::shared_ptr<Shader>& shader) const;
+        // Hash of the bound texture objects, materials sharing textures share the hash
+        uint64_t GetTextureSetHash() const;
+        // Pack parameters into the std140 material block
+        MaterialBlock BuildMaterialBlock() const;
 
         bool IsDoubleSided() const{ return doubleSided; }
     private:
@@ -82,4 +143,8 @@ class PBRMaterial {
         // Normal
         bool useVertexTangent = true;   // default: use vertex tangents if mesh has them
         float normalScale = 1.0f;       // default: glTF normalTexture.scale (1.0 if missing)
+
+        // Slot in the shared MaterialBlockBuffer, written lazily on first upload or after a change
+        mutable int blockSlot = -1;
+        mutable bool blockDirty = true;
 };
\ No newline at end of file
@@ -0,0 +1,57 @@
+#pragma once
+#include <cstddef>
+#include <iosfwd>
+#include <vector>
+#include "config.h"
+
+struct Vertex;
+
+// ======================Mesh Optimizer==========================
+// Reorders an indexed triangle list for the GPU without changing what it draws:
+//  1. vertex cache: Forsyth's linear-speed vertex cache optimization, triangles
+//     reusing recently transformed vertices are emitted first
+//  2. overdraw: the cache ordered list is cut into clusters where the cache
+//     restarts anyway, and the clusters are drawn outside-in so front facing
+//     surfaces tend to be rasterized first
+//  3. vertex fetch: vertices are renumbered in first-use order (unused ones are
+//     dropped) so the vertex buffer is read mostly sequentially
+// ACMR is simulated post-transform cache misses per triangle (3.0 is the worst,
+// about 0.5 is the limit for large regular meshes), ATVR is misses per vertex
+// (1.0 is ideal). Both use a FIFO cache of MESH_OPT_CACHE_SIZE entries.
+struct MeshOptimizeStats {
+    size_t meshes = 0;
+    size_t triangles = 0;
+    size_t vertices = 0;            // referenced vertices
+    size_t transformsBefore = 0;    // simulated vertex shader invocations
+    size_t transformsAfter = 0;
+    size_t clusters = 0;            // overdraw clusters
+    double ms = 0.0;
+
+    float GetACMRBefore() const { return this->triangles ? (float)this->transformsBefore / this->triangles : 0.0f; };
+    float GetACMRAfter() const { return this->triangles ? (float)this->transformsAfter / this->triangles : 0.0f; };
+    float GetATVRBefore() const { return this->vertices ? (float)this->transformsBefore / this->vertices : 0.0f; };
+    float GetATVRAfter() const { return this->vertices ? (float)this->transformsAfter / this->vertices : 0.0f; };
+
+    // Sum of several meshes (the ratios become triangle/vertex weighted averages)
+    void Add(const MeshOptimizeStats& other);
+    void Print(std::ostream& out, const char* tag) const;
+};
+
+// Simulated cache misses of a triangle list
+size_t AnalyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount,
+                          unsigned int cacheSize = MESH_OPT_CACHE_SIZE);
+
+// Forsyth vertex cache order of indices written to dst (dst must not alias indices)
+void OptimizeVertexCache(unsigned int* dst, const unsigned int* indices, size_t indexCount, size_t vertexCount);
+
+// Cluster sort of a cache optimized list, written to dst (dst must not alias indices).
+// Clusters are only cut where the ACMR stays within slack of the input. Returns the cluster count.
+size_t OptimizeOverdraw(unsigned int* dst, const unsigned int* indices, size_t indexCount,
+                        const Vertex* vertices, size_t vertexCount, float slack = MESH_OPT_OVERDRAW_SLACK);
+
+// Renumber vertices in first-use order and drop unreferenced ones. Returns the new vertex count.
+size_t OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
+
+// All three passes in order. Inputs with bad indices or a non triangle count are left untouched,
+// and the new triangle order is only kept when it does not transform more vertices than the old one.
+MeshOptimizeStats OptimizeMesh(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices);
@@ -0,0 +1,122 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "model_loader/glb_loader.h"
+
+// ======================GlbAsyncLoad==========================
+// Streaming glTF load. Parsing, image decoding and vertex processing run on the
+// ThreadPool, the render thread calls Update once per frame to upload what the
+// workers finished within a time and byte budget. Image jobs also cook the
+// textures that have no fresh KTX yet, so the uploads never encode. The node hierarchy is attached
+// under the parent right after the parse, each node gets its mesh and material
+// once the mesh and all of the material's images are ready.
+// Workers are fed at most maxInFlight jobs ahead of the uploads, so decoded data
+// waiting for the GL thread stays bounded and no worker ever blocks on the queue.
+// Tasks only hold a raw pointer, the handle is always released by its owner on the
+// render thread: dropping it mid-stream cancels the queued tasks and waits for them,
+// so the meshes and textures it owns are never destroyed without the GL context.
+class GlbAsyncLoad {
+    public:
+        enum class State { Parsing, Streaming, Done, Failed };
+
+        // maxInFlight 0: twice the pool's thread count
+        static std::shared_ptr<GlbAsyncLoad> Start(const std::string& path,
+                                                   const std::shared_ptr<SceneNode>& parent,
+                                                   uint32_t maxInFlight = 0);
+
+        // Render (GL context) thread, once per frame. Uploads finished items until one of
+        // the budgets is used up, at least one item per call. Returns true while loading.
+        bool Update(double budgetMs, uint64_t budgetBytes);
+
+        ~GlbAsyncLoad();
+        GlbAsyncLoad(const GlbAsyncLoad&) = delete;
+        GlbAsyncLoad& operator=(const GlbAsyncLoad&) = delete;
+
+        State GetState() const { return this->state; };
+        float GetProgress() const; // attached draws / all draws, 0 while parsing
+        const GlbLoadStats& GetStats() const { return this->loader.stats; };
+
+    private:
+        GlbAsyncLoad(const std::string& path, const std::shared_ptr<SceneNode>& parent, uint32_t maxInFlight);
+
+        // Either an image to decode or a primitive to build
+        struct Job {
+            int image = -1;
+            int mesh = -1, primitive = -1;
+        };
+        struct Result {
+            Job job;
+            bool ok = false;
+            bool cached = false;                    // mesh is in the MeshCache file, nothing decoded
+            std::vector<Vertex> vertices;
+            std::vector<unsigned int> indices;
+            MeshOptimizeStats optimize;
+            uint32_t texturesCooked = 0;            // image jobs cook after the decode
+            double ms = 0.0;
+            double cookMs = 0.0;
+        };
+        struct PendingDraw {
+            GlbLoader::DeferredDraw draw;
+            std::vector<int> images;
+        };
+
+        void OnParsed();
+        void SubmitTask(std::function<void()> task); // counted, see WaitForTasks
+        void WaitForTasks();
+        void SubmitJobs();
+        void RunJob(const Job& job);                // worker thread
+        void HandleResult(Result& result);
+        void AttachReadyDraws();
+        bool IsDrawReady(const PendingDraw& pending) const;
+        bool OverBudget() const;
+        void Finish();
+
+        GlbLoader loader;                           // caches, stats and decode helpers
+        tinygltf::Model model;
+        std::string path;
+        std::shared_ptr<SceneNode> parent;
+        State state = State::Parsing;
+        std::chrono::steady_clock::time_point startTime;
+
+        // Written by the parse task before it sets parseDone
+        std::atomic<bool> parseDone{false};
+        bool parsed = false;
+        double parseMs = 0.0;
+        std::vector<std::string> meshDependencies;
+
+        // Set by OnParsed before any job is submitted, read only by the workers
+        std::vector<std::vector<TextureUsage>> imageCookUsages;
+
+        // Render thread only
+        std::vector<Job> jobs;
+        size_t nextJob = 0;
+        uint32_t maxInFlight = 0;
+        uint32_t inFlight = 0;                      // submitted and not yet handled
+        std::vector<char> imageReady;
+        std::vector<PendingDraw> pendingDraws;
+        size_t drawCount = 0;
+
+        // Per Update budget
+        std::chrono::steady_clock::time_point budgetStart;
+        double budgetMs = 0.0;
+        uint64_t budgetBytesEnd = 0;
+        bool handledAny = false;
+
+        std::mutex resultMutex;
+        std::deque<Result> results;                 // finished jobs, workers push, render thread pops
+
+        // Tasks on the pool that still reference this load, the destructor waits for zero
+        std::atomic<bool> cancelled{false};         // set by the destructor, queued tasks return at once
+        std::mutex taskMutex;
+        std::condition_variable taskDone;
+        uint32_t tasksPending = 0;
+};
@@ -2,6 +2,8 @@
 #include <memory>
 #include <string>
 #include <vector>
+#include <unordered_map>
+#include <cstdint>
 #include <glm/glm.hpp>
 
 #include <tiny_gltf.h>
@@ -9,6 +11,34 @@
 #include "geometry.h"      // Mesh, Vertex
 #include "material.h"      // PBRMaterial
 #include "texture/texture.h" // Texture2D (CreateFromPixels or LoadLDRToTexture)
+#include "model_loader/mesh_cache.h"
+
+// Resource reuse of the last LoadFile call. Shared glTF meshes, materials and
+// images map to one GPU object, "saved" is what uploading them again would cost.
+struct GlbLoadStats {
+    uint32_t meshesLoaded = 0, meshesReused = 0;
+    uint32_t meshesFromCache = 0;   // of meshesLoaded, mapped from the MeshCache file
+    uint32_t materialsLoaded = 0, materialsReused = 0;
+    uint32_t texturesLoaded = 0, texturesReused = 0;
+    uint64_t vramBytesSaved = 0;    // vertex/index bytes and texture bytes incl. mips
+    double msSaved = 0.0;           // decode + upload time the reused resources took once
+
+    // Load time breakdown. Decode phases run on the worker pool in parallel decode
+    // mode (wall time), uploads always run on the context thread.
+    uint32_t decodeThreads = 0;     // 0 when everything ran on the calling thread
+    uint32_t imagesDecoded = 0;
+    uint32_t texturesCooked = 0;    // KTX files written by the decode tasks
+    double parseMs = 0.0;           // tinygltf JSON/GLB parse (includes image decode when serial)
+    double imageDecodeMs = 0.0;
+    double textureCookMs = 0.0;     // BCn encoding after the decode, same threads
+    double meshDecodeMs = 0.0;
+    double meshUploadMs = 0.0;      // SetupBuffers
+    double textureUploadMs = 0.0;   // CreateFromPixels incl. mip generation
+    uint64_t bytesUploaded = 0;     // vertex/index and texture bytes handed to GL
+    MeshOptimizeStats meshOptimize; // meshes decoded this load (cached meshes were optimized when baked)
+};
+
+class GlbAsyncLoad;
 
 class GlbLoader {
 public:
@@ -16,24 +46,124 @@ public:
     // Returns true on success.
     bool LoadFile(const std::string& path, const std::shared_ptr<SceneNode>& parent);
 
+    // Start a streaming load and return right away. Nodes appear under parent as their
+    // meshes and textures are uploaded by GlbAsyncLoad::Update on the render thread.
+    static std::shared_ptr<GlbAsyncLoad> LoadFileAsync(const std::string& path,
+                                                       const std::shared_ptr<SceneNode>& parent);
+
     // Get directory part of a path
     static std::string DirOf(const std::string& p);
 
+    const GlbLoadStats& GetStats() const { return this->stats; }
+
+    // Decode images and every primitive's vertex/index arrays on the worker pool before
+    // building nodes, only GL uploads run on the calling (GL context) thread. On by default.
+    void SetParallelDecode(bool enabled) { this->parallelDecode = enabled; }
+
+    // Keep decoded meshes in a MeshCache file and map them from there on the next load. On by default.
+    void SetMeshCacheEnabled(bool enabled) { this->useMeshCache = enabled; }
+
 private:
+    friend class GlbAsyncLoad;
+
+    // Per-load caches, live for one LoadFile call
+    struct CachedMesh {
+        std::shared_ptr<Mesh> mesh;
+        uint64_t bytes = 0;
+        double ms = 0.0;
+        bool used = false;          // preloaded entries count as loaded on their first use
+    };
+    struct CachedMaterial {
+        std::shared_ptr<PBRMaterial> material;
+        double ms = 0.0;
+    };
+    struct CachedTexture {
+        std::shared_ptr<Texture2D> texture;
+        uint64_t bytes = 0;
+        double ms = 0.0;
+    };
+    std::unordered_map<uint64_t, CachedMesh> meshCache;          // (mesh index, primitive index)
+    std::unordered_map<uint64_t, CachedMaterial> materialCache;  // (material index, uses vertex tangents)
+    std::unordered_map<uint64_t, CachedTexture> textureCache;    // (image index, TextureUsage)
+    GlbLoadStats stats;
+    bool parallelDecode = true;
+    bool useMeshCache = true;
+    std::shared_ptr<MeshCache> diskCache;                         // valid mesh cache of the current file
+
+    // Streaming mode: BuildNodeRecursive creates empty nodes and records them here
+    struct DeferredDraw {
+        std::shared_ptr<SceneNode> node;
+        int mesh = -1, primitive = -1;
+    };
+    bool deferMeshes = false;
+    std::vector<DeferredDraw> deferredDraws;
+
+    // Parse into model, on any thread. deferImages leaves images encoded for DecodeImage.
+    static bool ParseFile(const std::string& path, tinygltf::Model& model, bool deferImages);
+    static std::vector<int> GetSceneRoots(const tinygltf::Model& model);
+    static std::vector<std::string> GetBufferFiles(const tinygltf::Model& model, const std::string& gltfPath);
+    void ClearCaches();
+    void PrintStats() const;
+
+    static uint64_t CacheKey(int a, int b);
+    std::shared_ptr<Mesh> LoadMeshFromDisk(uint64_t key);
+    std::vector<MeshCache::Source> GetDecodedMeshes() const;
+    // Release the CPU arrays the mesh cache bake needed (Mesh::GetDefaultResidency)
+    void ApplyMeshResidency();
+    std::shared_ptr<Mesh> GetOrLoadMesh(const tinygltf::Model& model, int meshIndex, int primitiveIndex);
+    std::shared_ptr<PBRMaterial> GetOrLoadMaterial(const tinygltf::Model& model, int materialIndex,
+                                                   bool hasTangent, const std::string& gltfPath);
+    std::shared_ptr<Texture2D> GetOrLoadTexture(const tinygltf::Model& model, int texIndex, TextureUsage usage,
+                                                const std::string& gltfPath);
+    // Name of an image in the cooked texture cache: its own file for external images,
+    // the glTF file and the image index for embedded ones
+    static void GetImageSource(const tinygltf::Model& model, int imageIndex, const std::string& gltfPath,
+                               std::string& sourcePath, std::string& subKey);
+    // Images every material usage of which has a fresh cooked texture, their pixels are
+    // never read so decoding them is skipped. toCook receives per image the usages
+    // that can be cooked but have no fresh file yet. Context thread (queries GL formats).
+    static std::vector<char> GetCookedImages(const tinygltf::Model& model, const std::string& gltfPath,
+                                             std::vector<std::vector<TextureUsage>>* toCook = nullptr);
+    // Cook a decoded image for the given usages on the calling thread, meant for the
+    // decode task so GetOrLoadTexture only uploads the KTX. Returns the files written.
+    static uint32_t CookImage(const tinygltf::Model& model, int imageIndex, const std::string& gltfPath,
+                              const std::vector<TextureUsage>& usages);
+
     // Recursively build a SceneNode from a glTF node index
     std::shared_ptr<SceneNode> BuildNodeRecursive(const tinygltf::Model& model,
                                                   int nodeIndex,
                                                   const std::string& gltfPath);
 
+    // Decode the images ParseFile left encoded, on the worker pool
+    void DecodeImagesParallel(tinygltf::Model& model, const std::string& gltfPath);
+    static bool DecodeImage(tinygltf::Image& img);
+
+    // Decode and upload all triangle primitives reachable from the given roots into meshCache
+    void PreloadMeshesParallel(const tinygltf::Model& model, const std::vector<int>& roots);
+
     // Build a Mesh from a single primitive (triangles/strip/fan supported; others skipped)
     std::shared_ptr<Mesh> LoadMesh(const tinygltf::Model& model,
                                    const tinygltf::Primitive& primitive);
 
+    // CPU part of LoadMesh, touches no GL and no loader state so it can run on any thread.
+    // Returns false when the primitive has no usable POSITION. With optimizeStats the
+    // arrays are also run through OptimizeMesh here instead of in SetupBuffers.
+    bool DecodePrimitive(const tinygltf::Model& model, const tinygltf::Primitive& primitive,
+                         std::vector<Vertex>& vertices, std::vector<unsigned int>& indices,
+                         MeshOptimizeStats* optimizeStats = nullptr);
+
+    // GL part of LoadMesh, context thread only. optimized: what DecodePrimitive reported.
+    void UploadMesh(const std::shared_ptr<Mesh>& mesh, std::vector<Vertex>& vertices,
+                    std::vector<unsigned int>& indices, const MeshOptimizeStats* optimized = nullptr);
+
     // Build a PBRMaterial (loads textures; sRGB/Linear respected)
     std::shared_ptr<PBRMaterial> LoadMaterial(const tinygltf::Model& model,
                                               int materialIndex,
                                               const std::string& gltfPath);
 
+    // Image indices a material's textures read (for streaming, which waits on them)
+    static void GetMaterialImages(const tinygltf::Model& model, int materialIndex, std::vector<int>& out);
+
     // Access raw element pointer of an accessor at element index (handles offsets/stride)
     const unsigned char* AccessorElemPtr(const tinygltf::Model& model,
                                          const tinygltf::Accessor& acc,
@@ -0,0 +1,70 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "geometry.h"
+#include "mapped_file.h"
+
+// ======================MeshCache==========================
+// Pre-baked, ready to upload meshes of one source model: interleaved Vertex
+// arrays and uint32 index arrays exactly as Mesh::SetupBuffers sends them, plus
+// the CompactVertex array with its dequantization, the uint16 index array when
+// every index fits and the bounds, so an upload packs and narrows nothing.
+// Stored as MESH_CACHE_DIR/<hash of path and variant>.meshcache and stamped with the
+// size and mtime of the source and the files it depends on (glTF buffers).
+// Open maps the file read-only and Upload hands the mapped arrays to
+// glBufferData directly, the mesh keeps the mapping alive for its bounds and
+// picking BVH. Meshes are addressed by a caller chosen 64-bit key.
+class MeshCache : public std::enable_shared_from_this<MeshCache> {
+    public:
+        // Bump when the layout, the Vertex struct or the mesh optimization changes
+        // (2: arrays are stored in OptimizeMesh order, 3: CompactVertex arrays and bounds,
+        // 4: uint16 index arrays)
+        static constexpr uint32_t VERSION = 4;
+
+        struct Source {
+            uint64_t key = 0;
+            const Vertex* vertices = nullptr;
+            size_t vertexCount = 0;
+            const unsigned int* indices = nullptr;
+            size_t indexCount = 0;
+        };
+
+        // Map the cache of sourcePath. nullptr when there is none or it is stale.
+        // variant names load options that change the arrays (e.g. flipped UVs), each
+        // variant has its own file so the options never evict each other.
+        static std::shared_ptr<MeshCache> Open(const std::string& sourcePath,
+                                               const std::vector<std::string>& dependencies = {},
+                                               const std::string& variant = "");
+        // Write (or replace) the cache of sourcePath and variant
+        static bool Write(const std::string& sourcePath, const std::vector<std::string>& dependencies,
+                          const std::vector<Source>& meshes, const std::string& variant = "");
+
+        bool Contains(uint64_t key) const;
+        // Upload the cached arrays of key into mesh, false when key is not cached
+        bool Upload(uint64_t key, Mesh& mesh) const;
+
+        size_t GetMeshCount() const { return this->entryCount; };
+        size_t GetMappedBytes() const { return this->size; };
+
+        MeshCache(const MeshCache&) = delete;
+        MeshCache& operator=(const MeshCache&) = delete;
+
+    private:
+        MeshCache() {};
+
+        struct Header;
+        struct Entry;
+
+        MappedFile file;
+        const unsigned char* data = nullptr;    // file contents
+        size_t size = 0;
+        const Entry* entries = nullptr;         // sorted by key
+        size_t entryCount = 0;
+
+        const Entry* Find(uint64_t key) const;
+        static std::string GetCachePath(const std::string& sourcePath, const std::string& variant);
+        static bool GetStamp(const std::string& sourcePath, const std::vector<std::string>& dependencies,
+                             uint64_t& stamp);
+};
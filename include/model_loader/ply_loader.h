@@ -1,7 +1,6 @@
 #pragma once
 #include <string>
 #include "geometry.h"
-#include <assimp/scene.h>
 
-// Load ply model into mesh object
+// Load ply model into mesh object: mesh cache, then the native reader, then Assimp
 bool LoadPLYToMesh(const std::string& path, Mesh& mesh, bool flipUVs = true);
\ No newline at end of file
@@ -0,0 +1,28 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "geometry.h"   // Vertex
+
+// What a PLY read produced, for logging and benchmarks
+struct PLYReadInfo {
+    uint64_t vertices = 0;
+    uint64_t triangles = 0;
+    uint64_t facesDropped = 0;      // faces with fewer than 3 or out of range indices
+    bool hadNormals = false;
+    bool hadTexCoords = false;
+    const char* format = "";        // "ascii", "binary_little_endian", "binary_big_endian"
+};
+
+// Native PLY reader: ASCII, binary little and big endian. The file is memory
+// mapped and the vertex and face elements are parsed in place into Vertex and
+// index arrays; faces with more than three corners are fan triangulated. Normals
+// are only computed when the file has none, tangents only when it has texture
+// coordinates (the same rule Assimp's CalcTangentSpace follows).
+bool ReadPLY(const std::string& path, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices,
+             bool flipUVs = true, PLYReadInfo* info = nullptr);
+
+// Assimp import (all meshes of the scene merged), kept for formats the native
+// reader rejects and as the benchmark baseline
+bool ReadPLYAssimp(const std::string& path, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices,
+                   bool flipUVs = true);
@@ -4,16 +4,27 @@
 #include "geometry.h"
 #include "material.h"
 #include "bounding_box/aabb.h"
+#include "bounding_box/frustum.h"
+#include "bounding_box/bvh.h"
 #include "shader.h"
+#include "transform_store.h"
 #include <vector>
 #include <memory>
+#include <array>
+#include <unordered_map>
+#include <cstdint>
+#include <limits>
 
-// SceneNode class, which is derived from std::enable_shared_from_this to allow creating shared_ptr of itself
-class SceneNode : public std::enable_shared_from_this<SceneNode> {
+// SceneNode is a thin handle: its transforms, parent link and bounds live in the
+// flat TransformStore, the node owns mesh, material, TRS values and its children.
+class SceneNode {
 public:
     // Constructor that initializes the mesh and material
     SceneNode(const std::shared_ptr<Mesh>& mesh, const std::shared_ptr<PBRMaterial>& material);
-    SceneNode(): mesh(nullptr), material(nullptr), localAABB(nullptr), worldAABB(nullptr) {};
+    SceneNode();
+    ~SceneNode();
+    SceneNode(const SceneNode&) = delete;
+    SceneNode& operator=(const SceneNode&) = delete;
 
     // transform getter and setter
     void SetPosition(const glm::vec3& p);
@@ -31,12 +42,17 @@ public:
     std::shared_ptr<PBRMaterial> GetMaterial() const { return this->material; };
     
     // Getter functions for local and world transformation matrices
-    glm::mat4 GetLocalTransform() const { return this->localTransform; }
-    glm::mat4 GetWorldTransform() const { return this->worldTransform; }
+    // (world is refreshed by Scene::UpdateTransforms or UpdateWorldTransform)
+    glm::mat4 GetLocalTransform() const { return TransformStore::Get().GetLocal(this->transform); }
+    glm::mat4 GetWorldTransform() const { return TransformStore::Get().GetWorld(this->transform); }
+    // nullptr when the node has no mesh
+    const AABB* GetWorldAABB() const { return this->mesh ? &this->worldAABB : nullptr; }
+    TransformStore::Handle GetTransformHandle() const { return this->transform; }
+    SceneNode* GetParent() const { return TransformStore::Get().GetParentNode(this->transform); }
 
     // Function to add a child node
     void AddChild(const std::shared_ptr<SceneNode>& child);
-    std::vector<std::shared_ptr<SceneNode>> GetChildren() { return this->children; };
+    const std::vector<std::shared_ptr<SceneNode>>& GetChildren() const { return this->children; };
 
     // Update the local and world transformation matrices
     void UpdateLocalTransform();
@@ -44,44 +60,113 @@ public:
 
     // Function to upload material to the shader
     void UploadToShader(const std::shared_ptr<Shader>& shader);
+    // Upload only the model matrix, shader must already be in use
+    void UploadTransform(const std::shared_ptr<Shader>& shader);
     
     // Recursive function to draw this node and its children
     void Draw(const std::shared_ptr<Shader>& shader); 
 
 private:
+    friend class TransformStore;                  // reads mesh and updates worldAABB in its linear pass
+
+    TransformStore::Handle transform;             // Entry in the flat transform store
     std::shared_ptr<Mesh> mesh;                   // Mesh object
     std::shared_ptr<PBRMaterial> material;        // Material object
-    glm::mat4 localTransform;                     // Local transformation matrix
-    glm::mat4 worldTransform;                     // World transformation matrix
     glm::vec3 position;                           // Position of the node
     glm::vec3 rotation;                           // Rotation in pitch/yaw/roll
     glm::vec3 scale;                              // Scale of the node
-    std::shared_ptr<SceneNode> parent;            // Parent node
     std::vector<std::shared_ptr<SceneNode>> children;  // Child nodes
-    std::shared_ptr<AABB> worldAABB = nullptr;
-    std::shared_ptr<AABB> localAABB = nullptr;
+    AABB worldAABB;                               // Mesh box, keeps the local box for UpdateBox
+};
+
+// Per-frame render statistics. stateChangesUnsorted is measured on the queue in
+// collection order, before the sort, with the same redundant-state filter.
+struct RenderStats {
+    uint64_t draws = 0;
+    uint64_t blendChanges = 0;
+    uint64_t depthWriteChanges = 0;
+    uint64_t cullChanges = 0;
+    uint64_t shaderBinds = 0;
+    uint64_t materialBinds = 0;
+    uint64_t nodesVisible = 0;      // mesh nodes that passed frustum culling
+    uint64_t nodesCulled = 0;       // mesh nodes rejected, including whole culled subtrees
+    uint64_t subtreesCulled = 0;    // hierarchical early-outs
+    uint64_t stateChangesUnsorted = 0;
+    uint64_t StateChanges() const { return blendChanges + depthWriteChanges + cullChanges + shaderBinds + materialBinds; }
+};
+
+// CPU/GPU memory of the scene by category, meshes shared by several nodes count once
+struct SceneMemoryStats {
+    uint64_t nodes = 0;
+    uint64_t meshes = 0;
+    uint64_t nodeBytes = 0;         // SceneNode objects (transforms live in TransformStore)
+    uint64_t vertexBytes = 0;       // CPU Vertex arrays (MeshResidency::Keep)
+    uint64_t positionBytes = 0;     // CPU positions (MeshResidency::PositionsOnly)
+    uint64_t indexBytes = 0;        // CPU index arrays
+    uint64_t mappedBytes = 0;       // MeshCache file data referenced by meshes
+    uint64_t meshBVHBytes = 0;      // triangle BVHs built for picking
+    uint64_t gpuBytes = 0;          // vertex and index buffers
+    uint64_t CPUBytes() const { return nodeBytes + vertexBytes + positionBytes + indexBytes + meshBVHBytes; }
+};
+
+// One draw in the render queue, ordered by a 64-bit key
+// opaque/masked : pass(2) | cull(1) | shader(8) | material(12) | texture set(12) | mesh(13) | depth(16, front-to-back)
+// transparent   : pass(2) | depth(24, back-to-front) | cull(1) | shader(8) | material(12) | texture set(12) | mesh(5)
+struct DrawItem {
+    uint64_t key;
+    float depth;        // squared camera distance, quantized into the key
+    SceneNode* node;
 };
 
 class Scene {
     public:
+        enum class RenderPass : uint64_t { Opaque = 0, Masked = 1, Transparent = 2 };
+
         Scene() {};
 
         // Add root node into root vector
         void AddNode(const std::shared_ptr<SceneNode>& node);
 
-        // Draw a node with GL state derived from blending/depthWrite and material doubleSided
-        void DrawNodeWithState(const std::shared_ptr<SceneNode>& node,
-                                const std::shared_ptr<Shader>& shader,
-                                bool blending, bool depthWrite);
-        // Render all the root scene node
-        void Render(const std::shared_ptr<Shader>& shader, glm::vec3 camPos);
+        // Propagate pending transform edits, call once per frame before Render
+        void UpdateTransforms();
+        // Render all the root scene node, nodes outside the view frustum of viewProj are skipped
+        void Render(const std::shared_ptr<Shader>& shader, glm::vec3 camPos, const glm::mat4& viewProj);
+        const RenderStats& GetRenderStats() const { return this->renderStats; };
+
+        // Spatial queries over the world boxes of mesh nodes, answered by a BVH that
+        // is built on first use and refitted or rebuilt when the scene changed since
+        bool Pick(const Ray& ray, BVHHit& hit, PickMode mode = PickMode::Box);
+        void QueryFrustum(const glm::mat4& viewProj, std::vector<SceneNode*>& out);
+        void QueryOverlap(const glm::vec3& min, const glm::vec3& max, std::vector<SceneNode*>& out);
+        const BVHStats& GetBVHStats() const { return this->bvh.GetStats(); };
+        // Walk the scene and sum its memory by category
+        SceneMemoryStats GetMemoryStats() const;
     private:
         std::vector<std::shared_ptr<SceneNode>> rootNodes;
 
-        // Aplha queue
-        std::vector<std::shared_ptr<SceneNode>> queueOpaque;
-        std::vector<std::shared_ptr<SceneNode>> queueMasked;
-        std::vector<std::shared_ptr<SceneNode>> queueTransparent;  
-        void SortTransparent(const glm::vec3& camPos); // Sort transparent queue
-        void CollectQueue(const std::shared_ptr<SceneNode>& node); // collect and sort opaque, masked and transparent object
+        // Render queue, rebuilt every frame (storage is reused)
+        std::vector<DrawItem> drawItems;
+        std::vector<DrawItem> sortScratch;
+        // Dense per-frame ids for sort key fields
+        std::unordered_map<const void*, uint32_t> materialIds;
+        std::unordered_map<const void*, uint32_t> meshIds;
+        std::unordered_map<uint64_t, uint32_t> textureSetIds;
+        RenderStats renderStats;
+        Frustum frustum;
+
+        SceneBVH bvh;
+        bool bvhBuilt = false;
+        uint64_t bvhStructureVersion = 0;   // TransformStore versions the BVH was last synced with
+        uint64_t bvhBoundsVersion = 0;
+        std::vector<SceneNode*> bvhNodes;   // build input, storage is reused
+
+        // collect visible drawable nodes of a subtree into drawItems
+        void CollectQueue(SceneNode* node, const glm::vec3& camPos);
+        void BuildSortKeys(const std::shared_ptr<Shader>& shader);
+        void SortDrawItems(); // LSD radix sort on the 64-bit key
+        uint64_t CountStateChanges() const; // what SubmitDrawItems would change in the current order
+        void SubmitDrawItems(const std::shared_ptr<Shader>& shader);
+        uint32_t GetDenseId(std::unordered_map<const void*, uint32_t>& ids, const void* ptr);
+        uint32_t GetTextureSetId(const PBRMaterial& material);
+        void SyncBVH();
 };
\ No newline at end of file
@@ -5,6 +5,24 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <iostream>
 #include <unordered_set>
+#include <unordered_map>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+
+// Handle of an active uniform, resolved once via Shader::GetUniformId.
+// Setting a uniform through the handle needs no string hashing and no driver lookup.
+struct UniformId {
+    int index = -1;
+    bool IsValid() const { return index >= 0; }
+};
+
+// Per-shader counters, reset once per frame by the caller
+struct UniformStats {
+    uint64_t uniformSets = 0;            // glUniform* calls actually issued
+    uint64_t lookupsAvoided = 0;         // glGetUniformLocation calls replaced by the reflected table
+    uint64_t redundantSetsSkipped = 0;   // sets skipped because the value did not change
+};
 
 class Shader {
     public:
@@ -12,31 +30,84 @@ class Shader {
         Shader(const std::string& vertexPath, const std::string& fragmentPath);
         ~Shader();
         void Use() const;
-        GLuint GetProgramID() { return this->shaderProgram; };
+        GLuint GetProgramID() const { return this->shaderProgram; };
+
+        // Resolve a uniform name into a handle (invalid handle if uniform is not active)
+        UniformId GetUniformId(const std::string& name) const;
+        // Attach a uniform block to a buffer binding point, false if the block is not active
+        bool BindUniformBlock(const std::string& blockName, GLuint binding) const;
+
         template<typename T>
         void SetUniform(const std::string& name, const T& value) const;
+        template<typename T>
+        void SetUniform(UniformId id, const T& value) const;
+
+        const UniformStats& GetUniformStats() const { return this->uniformStats; };
+        void ResetUniformStats() { this->uniformStats = UniformStats{}; };
             
     private:
+        // Reflected active uniform with a shadow copy of the last uploaded value
+        struct UniformSlot {
+            GLint location = -1;
+            bool valid = false;                  // false until the first upload
+            unsigned char value[sizeof(glm::mat4)];
+        };
+
         std::string vertexPath;
         std::string fragmentPath;
         GLuint shaderProgram;
+        std::unordered_map<std::string, int> uniformTable;  // name -> index into uniformSlots
+        mutable std::vector<UniformSlot> uniformSlots;
+        mutable UniformStats uniformStats;
+
         GLuint LoadShader(const std::string& path, GLenum shaderType);
         std::string ProcessIncludes(const std::string& shaderCode, const std::string& shaderDir);
         // Use to load shader file that use include to include other file
         std::string LoadShaderWithIncludes(const std::string& path, std::unordered_set<std::string>& included);
+        // Query all active uniforms once after linking and fill uniformTable
+        void ReflectUniforms();
+
+        template<typename T>
+        static void UploadUniform(GLint location, const T& value);
 };
 
 template<typename T>
 void Shader::SetUniform(const std::string& name, const T& value) const {
-    // Get the location of the uniform variable in the shader program
-    GLint location = glGetUniformLocation(this->shaderProgram, name.c_str());
+    // Resolve the location from the reflected table instead of asking the driver
+    auto it = this->uniformTable.find(name);
 
-    // If location == -1, the uniform does not exist or was optimized out
-    if (location == -1) {
+    // If not found, the uniform does not exist or was optimized out
+    if (it == this->uniformTable.end()) {
         std::cerr << "WARNING: uniform '" << name << "' not found in shader.\n";
         return;
     }
+    this->uniformStats.lookupsAvoided++;
+    this->SetUniform(UniformId{it->second}, value);
+}
+
+template<typename T>
+void Shader::SetUniform(UniformId id, const T& value) const {
+    if (!id.IsValid() || id.index >= static_cast<int>(this->uniformSlots.size())) {
+        return;
+    }
+
+    UniformSlot& slot = this->uniformSlots[id.index];
+    static_assert(sizeof(T) <= sizeof(slot.value), "Uniform value too large for shadow copy");
 
+    // Skip the driver call if the program already holds this value
+    if (slot.valid && std::memcmp(slot.value, &value, sizeof(T)) == 0) {
+        this->uniformStats.redundantSetsSkipped++;
+        return;
+    }
+    std::memcpy(slot.value, &value, sizeof(T));
+    slot.valid = true;
+
+    this->uniformStats.uniformSets++;
+    UploadUniform(slot.location, value);
+}
+
+template<typename T>
+void Shader::UploadUniform(GLint location, const T& value) {
     // Check the type T at compile-time and dispatch the correct OpenGL function
     // Set integer uniform
     if constexpr (std::is_same<T, int>::value) {
@@ -70,4 +141,4 @@ void Shader::SetUniform(const std::string& name, const T& value) const {
     } else {
         static_assert(!sizeof(T), "Unsupported uniform type");
     }
-}
\ No newline at end of file
+}
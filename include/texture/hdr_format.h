@@ -0,0 +1,35 @@
+#pragma once
+#include <glad/glad.h>
+#include <cstddef>
+#include <vector>
+
+// ======================HDR storage formats==========================
+// Float HDR data (cubemaps, BRDF LUT) can be stored as 32-bit float, half float
+// (GL_RGB16F / GL_RG16F, 10-bit mantissa) or packed float (GL_R11F_G11F_B10F,
+// 4 bytes per texel, 6/6/5-bit mantissas, no sign). Conversion runs on the CPU
+// so uploads and KTX files already hold the storage format.
+
+// Default storage of the environment maps (Environment, main.cpp)
+constexpr GLenum ENV_CUBEMAP_FORMAT  = GL_RGB16F;           // skybox, seen directly
+constexpr GLenum PREFILTER_FORMAT    = GL_R11F_G11F_B10F;   // specular IBL
+constexpr GLenum BRDF_LUT_FORMAT     = GL_RG16F;
+
+struct HDRFormatInfo {
+    GLenum internalFormat = 0;
+    GLenum format = 0;          // external format / type of glTexImage2D
+    GLenum type = 0;
+    int channels = 0;
+    size_t bytesPerPixel = 0;
+};
+
+// False for formats that are not float HDR storage
+bool GetHDRFormatInfo(GLenum internalFormat, HDRFormatInfo& info);
+
+// Short lower case name ("rgb16f", "r11g11b10f"...), used in file names and logs
+const char* GetHDRFormatName(GLenum internalFormat);
+
+// Pack count pixels of srcChannels floats each into internalFormat. Missing
+// channels are zero, extra ones dropped, negative values clamp to 0 for R11F_G11F_B10F.
+std::vector<unsigned char> PackHDRPixels(const float* src, int srcChannels, size_t count, GLenum internalFormat);
+// Back to floats with the format's channel count
+std::vector<float> UnpackHDRPixels(const void* src, size_t count, GLenum internalFormat);
@@ -4,6 +4,7 @@
 #include <vector>
 #include <iostream>
 #include "geometry.h"
+#include "texture/texture_cooker.h"
 
 
 class Texture2D {
@@ -19,14 +20,33 @@ class Texture2D {
 
         // Load functions
         void LoadHDRToTexture(const std::string& path, bool flipY = false);
-        void LoadKTXToTexture(const std::string& path);
+        // storageFormat: HDR format (texture/hdr_format.h) float data is converted to on
+        // the CPU before upload, 0 keeps the file's format. Block compressed files upload
+        // every level with glCompressedTexImage2D.
+        bool LoadKTXToTexture(const std::string& path, GLenum storageFormat = 0);
         void LoadLDRToTexture(const std::string& path,  bool isSRGB, bool flipY = false);
+        // Material texture through the cooked texture cache (texture/texture_cooker.h):
+        // cooked to a BCn KTX on first use, uploaded compressed with its CPU built mips.
+        // Falls back to LoadLDRToTexture when cooking is off or the format is unsupported.
+        void LoadCookedTexture(const std::string& path, TextureUsage usage, bool flipY = false);
 
         // Load texture directly pixels
         void CreateFromPixels(const unsigned char* pixels, int w, int h, int comp, bool isSRGB);
+        // Same through the cooked texture cache, sourcePath and subKey name the pixels in
+        // the cache (e.g. a glTF file and the image index)
+        void CreateFromPixelsCooked(const unsigned char* pixels, int w, int h, int comp, TextureUsage usage,
+                                    const std::string& sourcePath, const std::string& subKey);
+
+        // Whether material textures go through the cooked texture cache (default COOK_TEXTURES)
+        static void SetCookTextures(bool enabled) { Texture2D::cookTextures = enabled; };
+        static bool GetCookTextures() { return Texture2D::cookTextures; };
+        // BC1/BC3 need EXT_texture_compression_s3tc, BC4/BC5 (RGTC) are core since GL 3.0
+        static bool SupportsCookedFormat(TextureUsage usage);
 
         // Texture getter and setter
         GLuint GetTexture() const { return this->texture2d; };
+        // Bytes of the uploaded levels (estimated for uncompressed textures with GL made mips)
+        size_t GetGPUBytes() const { return this->gpuBytes; };
         void SetTexture(GLuint id) { this->texture2d = id; };
         void ShowTexture2D(GLFWwindow* sharedContext); // Display 2d texture for debuggin purpose
     private:
@@ -36,5 +56,9 @@ class Texture2D {
         GLenum format;          // GL_RGB
         GLenum type;            // GL_FLOAT
         GLuint texture2d;
+        size_t gpuBytes = 0;
+        static bool cookTextures;
         void CreateStorage();
+        // Upload a cooked KTX and switch to the material sampler state (repeat, trilinear)
+        bool LoadCookedKTX(const std::string& cachePath);
 };
\ No newline at end of file
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// ======================TextureCooker==========================
+// First-run cooking of material textures into GPU-ready KTX files that
+// Texture2D::LoadKTXToTexture uploads with glCompressedTexImage2D. The mip chain
+// is built on the CPU with an area filter (sRGB colors averaged in linear space,
+// normals renormalized per level) and every level is block compressed by what
+// its channels hold:
+//  - Color:  BC1, BC3 when the alpha channel is used, sRGB   (albedo, emissive)
+//  - Data:   BC1, linear                                     (glTF roughness/metal)
+//  - Mask:   BC4 of the red channel                          (roughness, metalness, AO)
+//  - Normal: BC5 of XY, pbr_tex.frag rebuilds Z               (tangent space normals)
+// Cooked files live in TEXTURE_CACHE_DIR and are cooked again once the source is newer.
+// Blocks are encoded in parallel on ThreadPool, or serially inside a pool task.
+
+enum class TextureUsage {
+    Color,
+    Data,
+    Mask,
+    Normal,
+};
+
+struct TextureCookStats {
+    int width = 0;
+    int height = 0;
+    int levels = 0;
+    size_t uncompressedBytes = 0;   // 8-bit texels of the whole chain, as the uncompressed path uploads
+    size_t cookedBytes = 0;         // compressed blocks of the whole chain
+    double decodeMs = 0.0;
+    double mipMs = 0.0;
+    double encodeMs = 0.0;
+    double writeMs = 0.0;
+};
+
+class TextureCooker {
+    public:
+        // Bump when the encoders or the mip filter change, older cooked files are not used
+        static constexpr uint32_t VERSION = 1;
+
+        // TEXTURE_CACHE_DIR/<name>-<hash>.ktx, the hash covers the source path, subKey
+        // (e.g. the image index inside a glTF file), usage and flip
+        static std::string GetCachePath(const std::string& sourcePath, const std::string& subKey,
+                                        TextureUsage usage, bool flipY);
+        // The cooked file exists and is not older than its source
+        static bool IsFresh(const std::string& cachePath, const std::string& sourcePath);
+
+        // Cook 8-bit texels (1 to 4 channels, rows in upload order) into ktxPath.
+        // Pool tasks pass parallel = false to encode on their own thread.
+        static bool Cook(const unsigned char* pixels, int width, int height, int channels,
+                         TextureUsage usage, const std::string& ktxPath, TextureCookStats* stats = nullptr,
+                         bool parallel = true);
+        // Decode an image file with stb_image and cook it
+        static bool CookFile(const std::string& imagePath, TextureUsage usage, bool flipY,
+                             const std::string& ktxPath, TextureCookStats* stats = nullptr);
+
+        // Block encoders, input is one 4x4 block of RGBA8 texels in row order
+        static void EncodeBC1(const unsigned char* rgba, unsigned char* out);    // 8 bytes
+        static void EncodeBC3(const unsigned char* rgba, unsigned char* out);    // 16 bytes
+        static void EncodeBC4(const unsigned char* rgba, int channel, unsigned char* out); // 8 bytes
+        static void EncodeBC5(const unsigned char* rgba, unsigned char* out);    // 16 bytes
+
+        static const char* GetUsageName(TextureUsage usage);
+};
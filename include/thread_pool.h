@@ -0,0 +1,42 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <atomic>
+#include <cstddef>
+
+// ======================ThreadPool==========================
+// Process wide worker pool for CPU work (asset decoding, baking).
+// Workers never touch GL, results are handed back to the context thread.
+// ParallelFor lets the calling thread take part and returns when every
+// index has run, Submit queues a single task and returns its future.
+class ThreadPool {
+    public:
+        static ThreadPool& Get();
+
+        // Run fn(i) for i in [0, count), indices are handed out dynamically.
+        // Not to be called from inside a pool task (the caller would wait on its own workers)
+        void ParallelFor(size_t count, const std::function<void(size_t)>& fn);
+        std::future<void> Submit(std::function<void()> task);
+
+        // Worker threads plus the calling thread
+        unsigned GetThreadCount() const { return static_cast<unsigned>(this->workers.size()) + 1; };
+
+        ~ThreadPool();
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+    private:
+        ThreadPool();
+        void WorkerLoop();
+
+        std::vector<std::thread> workers;
+        std::deque<std::function<void()>> tasks;
+        std::mutex mutex;
+        std::condition_variable wake;
+        bool stopping = false;
+};
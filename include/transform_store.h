@@ -0,0 +1,95 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+
+class SceneNode;
+
+// Counters of the lazy update, reset once per frame by the caller
+struct TransformStats {
+    uint64_t matricesRecomputed = 0;   // world matrices written
+    uint64_t dirtySubtrees = 0;        // subtrees updated by UpdateDirty
+};
+
+// ======================TransformStore==========================
+// Flat storage of the scene hierarchy. Entries are kept in depth-first
+// pre-order, so parents always come before their children and every
+// subtree is one contiguous range [index, index + subtreeSize).
+// World matrices are updated by a single linear pass over a range.
+// Edits only mark entries dirty, UpdateDirty recomputes dirty subtrees.
+// SceneNode only keeps a stable handle into this store.
+class TransformStore {
+    public:
+        using Handle = uint32_t;
+        static constexpr Handle INVALID_HANDLE = 0xFFFFFFFFu;
+        static constexpr int32_t NO_PARENT = -1;
+
+        static TransformStore& Get();
+
+        Handle Create(SceneNode* owner);
+        void Release(Handle handle);
+        // Attach a root entry (and its subtree) under parent
+        bool SetParent(Handle child, Handle parent);
+        SceneNode* GetParentNode(Handle handle) const;
+
+        void SetLocal(Handle handle, const glm::mat4& local);
+        // Mark an entry so that its subtree is recomputed by the next UpdateDirty
+        void MarkDirty(Handle handle);
+        const glm::mat4& GetLocal(Handle handle) const { return this->locals[this->handleToIndex[handle]]; };
+        const glm::mat4& GetWorld(Handle handle) const { return this->worlds[this->handleToIndex[handle]]; };
+
+        // Recompute world matrices, world boxes and subtree bounds of the subtree of handle now
+        void UpdateSubtree(Handle handle);
+        // Recompute every dirty subtree, clean ranges are skipped
+        void UpdateDirty();
+        bool HasDirty() const { return this->hasDirty; };
+        const TransformStats& GetStats() const { return this->stats; };
+        void ResetStats() { this->stats = TransformStats{}; };
+        // Change counters for structures built on top of the store (scene BVH):
+        // structure changes on create/release/reparent/mesh swap, bounds on every update
+        uint64_t GetStructureVersion() const { return this->structureVersion; };
+        uint64_t GetBoundsVersion() const { return this->boundsVersion; };
+        void MarkStructureChanged() { this->structureVersion++; };
+
+        // Index based access, used for linear traversal in DFS order
+        uint32_t IndexOf(Handle handle) const { return this->handleToIndex[handle]; };
+        uint32_t SubtreeSizeAt(uint32_t index) const { return this->subtreeSizes[index]; };
+        SceneNode* OwnerAt(uint32_t index) const { return this->owners[index]; };
+        const glm::mat4& WorldAt(uint32_t index) const { return this->worlds[index]; };
+        const glm::vec3& SubtreeMinAt(uint32_t index) const { return this->subtreeMins[index]; };
+        const glm::vec3& SubtreeMaxAt(uint32_t index) const { return this->subtreeMaxs[index]; };
+        bool HasSubtreeBoundsAt(uint32_t index) const { return this->subtreeMins[index].x <= this->subtreeMaxs[index].x; };
+        uint32_t SubtreeMeshCountAt(uint32_t index) const { return this->meshCounts[index]; };
+        uint32_t Size() const { return static_cast<uint32_t>(this->locals.size()); };
+
+    private:
+        TransformStore() {};
+
+        // handle -> index indirection, handles stay valid when entries move
+        std::vector<uint32_t> handleToIndex;
+        std::vector<Handle> freeHandles;
+        uint32_t deadCount = 0;
+        bool hasDirty = false;
+        TransformStats stats;
+        uint64_t structureVersion = 0;
+        uint64_t boundsVersion = 0;
+
+        // Per entry, in DFS pre-order
+        std::vector<Handle> indexToHandle;          // INVALID_HANDLE for released entries
+        std::vector<int32_t> parents;               // parent index or NO_PARENT
+        std::vector<uint32_t> subtreeSizes;         // entry count of subtree including itself
+        std::vector<glm::mat4> locals;
+        std::vector<glm::mat4> worlds;
+        std::vector<SceneNode*> owners;
+        std::vector<glm::vec3> boxMins, boxMaxs;    // own world box
+        std::vector<glm::vec3> subtreeMins, subtreeMaxs;
+        std::vector<uint32_t> meshCounts;           // mesh nodes in subtree
+        std::vector<uint8_t> dirtyFlags;            // local changed since last update
+
+        void UpdateRange(uint32_t begin, uint32_t end);
+        void RefreshBoundsAt(uint32_t index);       // recombine from own box and direct children
+        void RefreshAncestors(uint32_t index);
+        void Reorder();                              // rebuild DFS order, drop released entries
+        template<typename T>
+        static void Permute(std::vector<T>& values, const std::vector<uint32_t>& order);
+};
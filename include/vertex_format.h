@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+struct Vertex;
+
+// ======================Compact vertex==========================
+// 20 byte GPU layout of Vertex (56 bytes as floats):
+//  - position: int16 per axis inside the mesh AABB, the shader scales it back with
+//    the per-mesh dequantization (Mesh::Draw). w holds the bitangent sign (+-1).
+//  - normal, tangent: octahedral encoding, 2 x int16 each
+//  - texCoord: 2 x half float
+// The integers are read unnormalized (GL_SHORT, normalized = GL_FALSE) and scaled
+// in the shader, which avoids the GL 3.x / 4.2 difference in snorm conversion.
+struct CompactVertex {
+    int16_t position[4];
+    int16_t normal[2];
+    int16_t tangent[2];
+    uint16_t texCoord[2];
+};
+static_assert(sizeof(CompactVertex) == 20, "CompactVertex must stay 20 bytes");
+
+// Largest quantized magnitude of positions and octahedral vectors
+constexpr float COMPACT_SNORM_MAX = 32767.0f;
+
+// Pack count vertices. position = stored.xyz * dequantScale + dequantOffset.
+void PackCompactVertices(const Vertex* vertices, size_t count, std::vector<CompactVertex>& out,
+                         glm::vec3& dequantScale, glm::vec3& dequantOffset);
+
+// Unit vector <-> octahedral coordinates in [-1, 1]^2
+glm::vec2 OctEncode(const glm::vec3& n);
+glm::vec3 OctDecode(const glm::vec2& e);
@@ -10,36 +10,36 @@ out vec4 FragColor;
 
 uniform vec3 camPos;
 
-// Env lookup
-uniform samplerCube irradianceMap;
+// Env lookup. Irradiance / PI as SH9, one matrix per color channel with
+// coefficient i at [i / 3][i % 3] (SH9::GetChannelMatrix)
+uniform mat3 irradianceSHR;
+uniform mat3 irradianceSHG;
+uniform mat3 irradianceSHB;
 uniform samplerCube prefilterMap;
 uniform sampler2D brdflut;
 
-// If use single value or texture
-uniform bool useAlbedoMap;
-uniform bool useRoughnessMap;
-uniform bool useMetalnessMap;
-uniform bool useNormalMap;
-uniform bool useAOMap;
-uniform bool useRoughnessMetalMap;
-uniform bool useEmissiveMap;
-
-// Alpha control 
-uniform bool doubleSided;
-uniform float alphaCutoff;
-uniform int alphaMode;
-uniform float baseAlpha;
-
-// Material fallback values (used when corresponding texture is absent)
-uniform vec3 baseColor;
-uniform float roughness;
-uniform float metalness;
-uniform float ao;
-uniform vec3 emissive;
-
-// Normal mapping options
-uniform bool  useVertexTangent; // true = use vertex tangents; false = build TBN from derivatives
-uniform float normalScale; // = glTF normalTexture.scale）
+// Material parameters, one std140 block per material in a shared uniform buffer
+// (layout must match MaterialBlock in material.h)
+layout(std140) uniform MaterialBlock {
+    vec3  baseColor;        // Material fallback values (used when corresponding texture is absent)
+    float baseAlpha;
+    vec3  emissive;
+    float roughness;
+    float metalness;
+    float ao;
+    float alphaCutoff;      // Alpha control
+    float normalScale;      // = glTF normalTexture.scale
+    int   alphaMode;
+    bool  doubleSided;
+    bool  useVertexTangent; // true = use vertex tangents; false = build TBN from derivatives
+    bool  useAlbedoMap;     // If use single value or texture
+    bool  useRoughnessMap;
+    bool  useMetalnessMap;
+    bool  useNormalMap;
+    bool  useAOMap;
+    bool  useRoughnessMetalMap;
+    bool  useEmissiveMap;
+};
 
 // Material Texture
 uniform sampler2D albedoMap;
@@ -53,6 +53,19 @@ uniform sampler2D emissiveMap;
 const float PI = 3.14159265359;
 const float MAX_REFLECTION_LOD = 7.0;
 
+// Irradiance / PI from SH9, same basis order as SH9::Basis
+vec3 IrradianceSH(vec3 n)
+{
+    vec3 b0 = vec3(0.282095, 0.488603 * n.y, 0.488603 * n.z);
+    vec3 b1 = vec3(0.488603 * n.x, 1.092548 * n.x * n.y, 1.092548 * n.y * n.z);
+    vec3 b2 = vec3(0.315392 * (3.0 * n.z * n.z - 1.0), 1.092548 * n.x * n.z, 0.546274 * (n.x * n.x - n.y * n.y));
+    vec3 e = vec3(dot(irradianceSHR[0], b0) + dot(irradianceSHR[1], b1) + dot(irradianceSHR[2], b2),
+                  dot(irradianceSHG[0], b0) + dot(irradianceSHG[1], b1) + dot(irradianceSHG[2], b2),
+                  dot(irradianceSHB[0], b0) + dot(irradianceSHB[1], b1) + dot(irradianceSHB[2], b2));
+    // Ringing of a bright sun can dip below zero
+    return max(e, vec3(0.0));
+}
+
 // Christian Schüler - "Followup: Normal Mapping Without Precomputed Tangents", 2013
 mat3 cotangent_frame(vec3 N, vec3 p, vec2 uv)
 {
@@ -78,7 +91,9 @@ vec3 getNormalFromMap()
 {
     vec3 N_ws = normalize(Normal);
 
-    vec3 n_ts = texture(normalMap, TexCoords).xyz * 2.0 - 1.0; // Sample tangent-space normal and remap from [0,1] to [-1,1]
+    // Only XY are sampled, cooked normal maps are BC5 (two channels), Z is rebuilt from them
+    vec2 n_xy = texture(normalMap, TexCoords).xy * 2.0 - 1.0; // Remap from [0,1] to [-1,1]
+    vec3 n_ts = vec3(n_xy, sqrt(max(1.0 - dot(n_xy, n_xy), 0.0)));
     n_ts.xy *= normalScale; 
 
     if (useVertexTangent) {
@@ -185,7 +200,7 @@ void main()
     kD *= 1.0 - metalnessFinal;
 
     // IBL - diffuse  
-    vec3 irradiance = texture(irradianceMap, N).rgb;
+    vec3 irradiance = IrradianceSH(N);
     vec3 diffuse = irradiance * baseColorFinal;
 
     // IBL - Specular
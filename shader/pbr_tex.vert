@@ -1,10 +1,17 @@
 #version 330 core
 
-layout(location=0) in vec3 aPos;
+// Float layout (Vertex): 0-4. Compact layout (CompactVertex): 0, 2, 5, 6 with
+// integer position/octahedral data and the bitangent rebuilt from N, T and aPos.w.
+layout(location=0) in vec4 aPos;        // compact: int16 xyz in the mesh AABB, w bitangent sign
 layout(location=1) in vec3 aNormal;
 layout(location=2) in vec2 aUV;
 layout(location=3) in vec3 aTangent;    // 来自 VAO
 layout(location=4) in vec3 aBitangent;  // 来自 VAO
+layout(location=5) in vec2 aNormalOct;  // compact only
+layout(location=6) in vec2 aTangentOct; // compact only
+// Set per draw by Mesh::Draw: xyz position scale, w 1 for the compact layout; offset
+layout(location=7) in vec4 aDequantScale;
+layout(location=8) in vec3 aDequantOffset;
 
 out vec3 WorldPos;
 out vec2 TexCoords;
@@ -16,20 +23,40 @@ uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
 
+const float SNORM_MAX = 32767.0;
+
+vec3 OctDecode(vec2 e)
+{
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+    return normalize(n);
+}
+
 void main()
 {
+    // Object space attributes of either layout
+    vec3 position  = aPos.xyz * aDequantScale.xyz + aDequantOffset;
+    vec3 normal    = aNormal;
+    vec3 tangent   = aTangent;
+    vec3 bitangent = aBitangent;
+    if (aDequantScale.w > 0.5) {
+        normal    = OctDecode(aNormalOct / SNORM_MAX);
+        tangent   = OctDecode(aTangentOct / SNORM_MAX);
+        bitangent = cross(normal, tangent) * aPos.w;
+    }
+
     // Transform to world space
-    vec3 N = normalize(mat3(model) * aNormal);
-    vec3 T = normalize(mat3(model) * aTangent);
+    vec3 N = normalize(mat3(model) * normal);
+    vec3 T = normalize(mat3(model) * tangent);
     // Gram-Schmidt orthogonalization to keep T orthogonal to N
     T = normalize(T - N * dot(N, T));
-    vec3 B = normalize(mat3(model) * aBitangent);
+    vec3 B = normalize(mat3(model) * bitangent);
 
     Normal      = N;
     TangentWS   = T;
     BitangentWS = B;
     TexCoords   = aUV;
-    WorldPos    = vec3(model * vec4(aPos, 1.0));
+    WorldPos    = vec3(model * vec4(position, 1.0));
 
     gl_Position = projection * view * vec4(WorldPos, 1.0);
 }
@@ -1,5 +1,6 @@
 #include "bounding_box/aabb.h"
 #include "config.h"
+#include "bounding_box/ray_packet.h"
 #include <iostream>
 
 
@@ -7,22 +8,25 @@
 AABB::AABB(const std::shared_ptr<Mesh>& mesh) {
     this->min = glm::vec3(std::numeric_limits<float>::max());
     this->max = glm::vec3(std::numeric_limits<float>::lowest());
-    this->boxIndices = {
-        0, 1, 1, 3, 3, 2, 2, 0,  // bottom box
-        4, 5, 5, 7, 7, 6, 6, 4,  // top box
-        0, 4, 1, 5, 2, 6, 3, 7   // vertical connections
-    };
 
-    // Get min and max point from object mesh data
-    const auto& vertices = mesh->GetVertices();  
-    for (const auto& vertex : vertices) {
-        this->max = glm::max(vertex.position, this->max);
-        this->min = glm::min(vertex.position, this->min);
+    // Bounds the mesh computed at upload (its vertex arrays may be released by now)
+    if (mesh && mesh->HasBounds()) {
+        this->min = mesh->GetBoundsMin();
+        this->max = mesh->GetBoundsMax();
+    } else if (mesh) {
+        const Vertex* vertices = mesh->GetVertexData();
+        for (size_t i = 0, count = mesh->GetVertexCount(); i < count; ++i) {
+            this->max = glm::max(vertices[i].position, this->max);
+            this->min = glm::min(vertices[i].position, this->min);
+        }
+    }
+    // Save the local box as center and half extent for model matrix transformation
+    this->hasLocalBox = this->IsValid();
+    if (this->hasLocalBox) {
+        this->localCenter = (this->min + this->max) * 0.5f;
+        this->localExtent = (this->max - this->min) * 0.5f;
     }
-    // Generate aabbox's vertices data using min and max points
-    this->GenerateBoxVertices();
-    // Save the orignal vertex for model matrix transformation
-    this->originalVertex = this->boxVertex;
+    this->verticesDirty = true;
 }
 
 AABB::AABB() {
@@ -30,6 +34,16 @@ AABB::AABB() {
     max = glm::vec3(std::numeric_limits<float>::lowest());
 }
 
+AABB::AABB(const glm::vec3& min, const glm::vec3& max) {
+    this->min = min;
+    this->max = max;
+    this->hasLocalBox = this->IsValid();
+    if (this->hasLocalBox) {
+        this->localCenter = (min + max) * 0.5f;
+        this->localExtent = (max - min) * 0.5f;
+    }
+}
+
 bool AABB::IsValid() const {
     return (min.x <= max.x && min.y <= max.y && min.z <= max.z);
 }
@@ -40,27 +54,36 @@ void AABB::CalMinMax(const std::vector<glm::vec3>& vertices) {
         this->min = glm::min(this->min, vertex);
         this->max = glm::max(this->max, vertex);
     }
+    this->verticesDirty = true;
 }
 
-// When object is moved or rotated, using this function to update the box data
+// When object is moved or rotated, using this function to update the box data.
+// Arvo's method: the new center is the transformed local center, and each world
+// half extent is the local extent projected onto that axis through |M|. Same box
+// as transforming all 8 corners and taking min/max, without the temporaries.
 void AABB::UpdateBox(const glm::mat4& model) {
-    std::vector<glm::vec3> newVertex(this->originalVertex.size());
-
-    for (size_t i = 0; i < this->originalVertex.size(); ++i) {
-        newVertex[i] = glm::vec3(model * glm::vec4(this->originalVertex[i], 1.0f));
+    if (!this->hasLocalBox) {
+        this->min = glm::vec3(std::numeric_limits<float>::max());
+        this->max = glm::vec3(std::numeric_limits<float>::lowest());
+        this->verticesDirty = true;
+        return;
     }
 
-    // Recalculate min and max value
-    this->min = glm::vec3(std::numeric_limits<float>::max());
-    this->max = glm::vec3(std::numeric_limits<float>::lowest());
-    this->CalMinMax(newVertex);
-
-    // Regnerate the box
-    this->GenerateBoxVertices();
-
+    glm::vec3 center = glm::vec3(model[3]) +
+                       glm::vec3(model[0]) * this->localCenter.x +
+                       glm::vec3(model[1]) * this->localCenter.y +
+                       glm::vec3(model[2]) * this->localCenter.z;
+    glm::vec3 extent = glm::abs(glm::vec3(model[0])) * this->localExtent.x +
+                       glm::abs(glm::vec3(model[1])) * this->localExtent.y +
+                       glm::abs(glm::vec3(model[2])) * this->localExtent.z;
+
+    this->min = center - extent;
+    this->max = center + extent;
+    // Corners are regenerated only when debug drawing asks for them
+    this->verticesDirty = true;
 }
 
-void AABB::GenerateBoxVertices() {
+void AABB::GenerateBoxVertices() const {
     this->boxVertex = {
         // fix y axis, change z and y
         glm::vec3(min.x, min.y, min.z),  // 0
@@ -72,65 +95,34 @@ void AABB::GenerateBoxVertices() {
         glm::vec3(max.x, max.y, min.z),  // 6
         glm::vec3(max.x, max.y, max.z)   // 7
     };
+    this->verticesDirty = false;
 }
 
-// Test if ray is intersecting with aabb box 
-// based on slab algorithm
-bool AABB::IntersectRay(const Ray& ray, float& tminOut) {
-    float txmin, txmax, tymin, tymax, tzmin, tzmax;
-    // Check if ray is parallel to x axis
-    if(std::abs(ray.direction.x) < EPSILON) {
-        if (ray.origin.x < this->min.x || ray.origin.x > this->max.x) {
-            return false;
-        }
-        txmin = std::numeric_limits<float>::lowest();
-        txmax = std::numeric_limits<float>::max();
-    } else {
-        float tx1 = (this->min.x - ray.origin.x) / ray.direction.x;
-        float tx2 = (this->max.x - ray.origin.x) / ray.direction.x;
-        txmin = glm::min(tx1, tx2);
-        txmax = glm::max(tx1, tx2);
-    }
-    // Check if ray is parallel to y axis
-    if(std::abs(ray.direction.y) < EPSILON) {
-        if (ray.origin.y < this->min.y || ray.origin.y > this->max.y) {
-            return false;
-        }
-        tymin = std::numeric_limits<float>::lowest();
-        tymax = std::numeric_limits<float>::max();
-    } else {
-        float ty1 = (this->min.y - ray.origin.y) / ray.direction.y;
-        float ty2 = (this->max.y - ray.origin.y) / ray.direction.y;
-        tymin = glm::min(ty1, ty2);
-        tymax = glm::max(ty1, ty2);
-    }
-    // Check if ray is parallel to z axis
-    if(std::abs(ray.direction.z) < EPSILON) {
-        if (ray.origin.z < this->min.z || ray.origin.z > this->max.z) {
-            return false;
-        }
-        tzmin = std::numeric_limits<float>::lowest();
-        tzmax = std::numeric_limits<float>::max();
-    } else {
-        float tz1 = (this->min.z - ray.origin.z) / ray.direction.z;
-        float tz2 = (this->max.z - ray.origin.z) / ray.direction.z;
-        tzmin = glm::min(tz1, tz2);
-        tzmax = glm::max(tz1, tz2);
+const std::vector<glm::vec3>& AABB::GetVertices() const {
+    if (this->verticesDirty) {
+        this->GenerateBoxVertices();
     }
-    // Compute the overlapping interval [tmin, tmax] across all three axes.
-    // - tmin: the latest entry time — when the ray enters the overlapping region, so using max
-    // - tmax: the earliest exit time — when the ray exits the overlapping region.
-    // If tmin > tmax, there's no intersection because the ray misses the box in at least one axis.
-    float tmin = glm::max(glm::max(txmin, tymin), tzmin);
-    float tmax = glm::min(glm::min(txmax, tymax), tzmax);
-
-    // return false if it is empty set
-    if(tmin > tmax) {
-        return false;
-    } else {
-        tminOut = tmin;
-        return true;
+    return this->boxVertex;
+}
+
+const std::vector<unsigned int>& AABB::GetIndices() const {
+    if (this->boxIndices.empty()) {
+        this->boxIndices = {
+            0, 1, 1, 3, 3, 2, 2, 0,  // bottom box
+            4, 5, 5, 7, 7, 6, 6, 4,  // top box
+            0, 4, 1, 5, 2, 6, 3, 7   // vertical connections
+        };
     }
+    return this->boxIndices;
+}
+
+// Test if ray is intersecting with aabb box, branch-free slab test shared with the
+// BVH traversals (RayBoxTest). Axis-parallel rays get an infinite inverse direction
+// instead of a special case. tminOut is the entry distance, 0 when the origin is
+// inside the box, boxes behind the origin are missed.
+bool AABB::IntersectRay(const Ray& ray, float& tminOut) {
+    const glm::vec3 invDir = 1.0f / ray.direction;
+    return RayBoxTest(ray.origin, invDir, this->min, this->max, std::numeric_limits<float>::max(), tminOut);
 }
 
 
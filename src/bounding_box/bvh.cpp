@@ -0,0 +1,437 @@
+#include "bounding_box/bvh.h"
+#include "scene.h"
+#include "bounding_box/mesh_bvh.h"
+#include <algorithm>
+
+static const glm::vec3 EMPTY_MIN(std::numeric_limits<float>::max());
+static const glm::vec3 EMPTY_MAX(std::numeric_limits<float>::lowest());
+
+// Rebuild when refitting made the tree this much more expensive than a fresh build
+static constexpr float REFIT_REBUILD_RATIO = 2.0f;
+
+static float SurfaceArea(const glm::vec3& min, const glm::vec3& max) {
+    glm::vec3 e = glm::max(max - min, glm::vec3(0.0f));
+    return 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+}
+
+//==================BuildBinnedSAH========================
+namespace {
+    constexpr int BIN_COUNT = 12;
+
+    struct SAHBuilder {
+        const std::vector<glm::vec3>& mins;
+        const std::vector<glm::vec3>& maxs;
+        std::vector<glm::vec3> centroids;   // in order of the order array
+        uint32_t maxLeafSize;
+        std::vector<BVHNode>& nodes;
+        std::vector<uint32_t>& order;
+
+        void Swap(uint32_t a, uint32_t b) {
+            std::swap(this->order[a], this->order[b]);
+            std::swap(this->centroids[a], this->centroids[b]);
+        }
+
+        // Centroids are sorted into BIN_COUNT bins per axis and the split
+        // between bins with the lowest area * count cost is taken.
+        void Build(uint32_t nodeIndex, uint32_t first, uint32_t count, uint32_t depth) {
+            glm::vec3 boundsMin = EMPTY_MIN, boundsMax = EMPTY_MAX;
+            glm::vec3 centroidMin = EMPTY_MIN, centroidMax = EMPTY_MAX;
+            for (uint32_t i = first; i < first + count; ++i) {
+                boundsMin = glm::min(boundsMin, this->mins[this->order[i]]);
+                boundsMax = glm::max(boundsMax, this->maxs[this->order[i]]);
+                centroidMin = glm::min(centroidMin, this->centroids[i]);
+                centroidMax = glm::max(centroidMax, this->centroids[i]);
+            }
+            BVHNode& node = this->nodes[nodeIndex];
+            node.min = boundsMin;
+            node.max = boundsMax;
+            node.first = first;
+            node.count = count;
+
+            // Deep leftovers become larger leaves
+            if (count <= this->maxLeafSize || depth >= BVH_MAX_DEPTH) {
+                return;
+            }
+
+            int bestAxis = -1;
+            int bestSplit = 0;
+            float bestCost = std::numeric_limits<float>::max();
+            const glm::vec3 extent = centroidMax - centroidMin;
+
+            for (int axis = 0; axis < 3; ++axis) {
+                if (extent[axis] <= 0.0f) continue;
+                const float scale = BIN_COUNT / extent[axis];
+
+                uint32_t binCounts[BIN_COUNT] = {};
+                glm::vec3 binMins[BIN_COUNT], binMaxs[BIN_COUNT];
+                for (int b = 0; b < BIN_COUNT; ++b) {
+                    binMins[b] = EMPTY_MIN;
+                    binMaxs[b] = EMPTY_MAX;
+                }
+                for (uint32_t i = first; i < first + count; ++i) {
+                    int b = std::min(BIN_COUNT - 1, static_cast<int>((this->centroids[i][axis] - centroidMin[axis]) * scale));
+                    binCounts[b]++;
+                    binMins[b] = glm::min(binMins[b], this->mins[this->order[i]]);
+                    binMaxs[b] = glm::max(binMaxs[b], this->maxs[this->order[i]]);
+                }
+
+                // Sweep from the right to get the cost of every right side, then from the left
+                float rightAreas[BIN_COUNT];
+                uint32_t rightCounts[BIN_COUNT];
+                glm::vec3 accMin = EMPTY_MIN, accMax = EMPTY_MAX;
+                uint32_t accCount = 0;
+                for (int b = BIN_COUNT - 1; b > 0; --b) {
+                    accMin = glm::min(accMin, binMins[b]);
+                    accMax = glm::max(accMax, binMaxs[b]);
+                    accCount += binCounts[b];
+                    rightAreas[b] = SurfaceArea(accMin, accMax);
+                    rightCounts[b] = accCount;
+                }
+                accMin = EMPTY_MIN;
+                accMax = EMPTY_MAX;
+                accCount = 0;
+                for (int b = 0; b < BIN_COUNT - 1; ++b) {
+                    accMin = glm::min(accMin, binMins[b]);
+                    accMax = glm::max(accMax, binMaxs[b]);
+                    accCount += binCounts[b];
+                    if (accCount == 0 || rightCounts[b + 1] == 0) continue;
+                    float cost = SurfaceArea(accMin, accMax) * accCount + rightAreas[b + 1] * rightCounts[b + 1];
+                    if (cost < bestCost) {
+                        bestCost = cost;
+                        bestAxis = axis;
+                        bestSplit = b + 1;
+                    }
+                }
+            }
+
+            // All centroids coincide, nothing to split on
+            if (bestAxis < 0) {
+                return;
+            }
+
+            // Partition items by bin, left side are bins below bestSplit
+            const float scale = BIN_COUNT / extent[bestAxis];
+            uint32_t mid = first;
+            for (uint32_t i = first; i < first + count; ++i) {
+                int b = std::min(BIN_COUNT - 1, static_cast<int>((this->centroids[i][bestAxis] - centroidMin[bestAxis]) * scale));
+                if (b < bestSplit) {
+                    this->Swap(i, mid++);
+                }
+            }
+            const uint32_t leftCount = mid - first;
+            if (leftCount == 0 || leftCount == count) {
+                return;
+            }
+
+            const uint32_t left = static_cast<uint32_t>(this->nodes.size());
+            this->nodes.push_back(BVHNode{});
+            this->nodes.push_back(BVHNode{});
+            this->nodes[nodeIndex].first = left;
+            this->nodes[nodeIndex].count = 0;
+
+            this->Build(left, first, leftCount, depth + 1);
+            this->Build(left + 1, mid, count - leftCount, depth + 1);
+        }
+    };
+}
+
+void BuildBinnedSAH(const std::vector<glm::vec3>& mins, const std::vector<glm::vec3>& maxs,
+                    uint32_t maxLeafSize, std::vector<BVHNode>& nodes, std::vector<uint32_t>& order) {
+    nodes.clear();
+    order.resize(mins.size());
+    if (mins.empty()) {
+        return;
+    }
+
+    SAHBuilder builder{mins, maxs, {}, std::max(maxLeafSize, 1u), nodes, order};
+    builder.centroids.resize(mins.size());
+    for (uint32_t i = 0; i < mins.size(); ++i) {
+        order[i] = i;
+        builder.centroids[i] = 0.5f * (mins[i] + maxs[i]);
+    }
+
+    // A binary tree with leaves of at least one item has at most 2n - 1 nodes
+    nodes.reserve(2 * mins.size());
+    nodes.push_back(BVHNode{});
+    builder.Build(0, 0, static_cast<uint32_t>(mins.size()), 0);
+}
+
+float ComputeSAHCost(const std::vector<BVHNode>& nodes) {
+    if (nodes.empty()) return 0.0f;
+    float rootArea = SurfaceArea(nodes[0].min, nodes[0].max);
+    if (rootArea <= 0.0f) return 0.0f;
+
+    float cost = 0.0f;
+    for (const BVHNode& node : nodes) {
+        float area = SurfaceArea(node.min, node.max);
+        cost += node.count > 0 ? area * node.count : area;
+    }
+    return cost / rootArea;
+}
+
+uint32_t IntersectChildren(const PacketRay& ray, const BVHNode* children, float tMax, float tEntry[4]) {
+    AABB4 boxes;
+    boxes.Set(0, children[0].min, children[0].max);
+    boxes.Set(1, children[1].min, children[1].max);
+    boxes.Set(2, EMPTY_MIN, EMPTY_MAX);
+    boxes.Set(3, EMPTY_MIN, EMPTY_MAX);
+    return IntersectRayAABB4(ray, boxes, tMax, tEntry);
+}
+
+//==================SceneBVH========================
+void SceneBVH::Clear() {
+    this->nodes.clear();
+    this->items.clear();
+    this->itemMins.clear();
+    this->itemMaxs.clear();
+    this->buildCost = 0.0f;
+}
+
+void SceneBVH::Build(const std::vector<SceneNode*>& nodes) {
+    this->Clear();
+
+    std::vector<SceneNode*> candidates;
+    candidates.reserve(nodes.size());
+    for (SceneNode* node : nodes) {
+        if (!node) continue;
+        auto box = node->GetWorldAABB();
+        if (!box || !box->IsValid()) continue;
+        candidates.push_back(node);
+        this->itemMins.push_back(box->GetMin());
+        this->itemMaxs.push_back(box->GetMax());
+    }
+    if (candidates.empty()) {
+        return;
+    }
+
+    BuildBinnedSAH(this->itemMins, this->itemMaxs, MAX_LEAF_SIZE, this->nodes, this->order);
+
+    // Store items in leaf order so a leaf is a contiguous range
+    std::vector<glm::vec3> mins(this->order.size()), maxs(this->order.size());
+    this->items.resize(this->order.size());
+    for (size_t i = 0; i < this->order.size(); ++i) {
+        this->items[i] = candidates[this->order[i]];
+        mins[i] = this->itemMins[this->order[i]];
+        maxs[i] = this->itemMaxs[this->order[i]];
+    }
+    this->itemMins.swap(mins);
+    this->itemMaxs.swap(maxs);
+
+    this->buildCost = ComputeSAHCost(this->nodes);
+    this->stats.builds++;
+}
+
+// Children always follow their parent, so a reverse pass sees children first
+bool SceneBVH::Refit() {
+    if (this->nodes.empty()) return true;
+
+    for (size_t i = 0; i < this->items.size(); ++i) {
+        auto box = this->items[i]->GetWorldAABB();
+        if (box && box->IsValid()) {
+            this->itemMins[i] = box->GetMin();
+            this->itemMaxs[i] = box->GetMax();
+        } else {
+            this->itemMins[i] = EMPTY_MIN;
+            this->itemMaxs[i] = EMPTY_MAX;
+        }
+    }
+
+    for (size_t n = this->nodes.size(); n-- > 0;) {
+        BVHNode& node = this->nodes[n];
+        glm::vec3 boundsMin = EMPTY_MIN, boundsMax = EMPTY_MAX;
+        if (node.count > 0) {
+            for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+                boundsMin = glm::min(boundsMin, this->itemMins[i]);
+                boundsMax = glm::max(boundsMax, this->itemMaxs[i]);
+            }
+        } else {
+            const BVHNode& l = this->nodes[node.first];
+            const BVHNode& r = this->nodes[node.first + 1];
+            boundsMin = glm::min(l.min, r.min);
+            boundsMax = glm::max(l.max, r.max);
+        }
+        node.min = boundsMin;
+        node.max = boundsMax;
+    }
+    this->stats.refits++;
+
+    return ComputeSAHCost(this->nodes) <= this->buildCost * REFIT_REBUILD_RATIO;
+}
+
+// Triangle test in mesh space. The direction is transformed but not renormalized,
+// so the hit parameter is directly the world-space distance.
+bool SceneBVH::IntersectItem(uint32_t item, const Ray& ray, float tMax, BVHHit& hit) const {
+    SceneNode* node = this->items[item];
+    const auto& mesh = node->GetMesh();
+    if (!mesh) return false;
+    this->stats.meshesTested++;
+
+    const glm::mat4 invModel = glm::inverse(node->GetWorldTransform());
+    const glm::vec3 origin = glm::vec3(invModel * glm::vec4(ray.origin, 1.0f));
+    const glm::vec3 direction = glm::vec3(invModel * glm::vec4(ray.direction, 0.0f));
+
+    MeshHit meshHit;
+    meshHit.t = tMax;
+    if (!mesh->GetBVH().Intersect(origin, direction, meshHit)) {
+        return false;
+    }
+    hit.node = node;
+    hit.t = meshHit.t;
+    hit.triangle = static_cast<int32_t>(meshHit.triangle);
+    hit.u = meshHit.u;
+    hit.v = meshHit.v;
+    return true;
+}
+
+// Front-to-back traversal with a small stack, the nearer child is visited first
+// and subtrees beyond the current closest hit are skipped
+bool SceneBVH::Raycast(const Ray& ray, BVHHit& hit, PickMode mode) const {
+    if (this->nodes.empty()) return false;
+
+    const PacketRay packetRay(ray.origin, ray.direction);
+    float closest = hit.t;
+    bool found = false;
+
+    uint32_t stack[BVH_STACK_SIZE];
+    int top = 0;
+    float tRoot;
+    if (!RayBoxTest(packetRay.origin, packetRay.invDir, this->nodes[0].min, this->nodes[0].max, closest, tRoot)) {
+        return false;
+    }
+    stack[top++] = 0;
+
+    while (top > 0) {
+        const BVHNode& node = this->nodes[stack[--top]];
+        this->stats.nodesVisited++;
+
+        if (node.count > 0) {
+            // Leaf boxes four at a time, closest may shrink between lanes so it is checked again
+            const uint32_t end = node.first + node.count;
+            for (uint32_t first = node.first; first < end; first += 4) {
+                const uint32_t lanes = std::min<uint32_t>(4, end - first);
+                AABB4 boxes;
+                boxes.Clear();
+                for (uint32_t k = 0; k < lanes; ++k) {
+                    boxes.Set(static_cast<int>(k), this->itemMins[first + k], this->itemMaxs[first + k]);
+                }
+                float tEntry[4];
+                const uint32_t mask = IntersectRayAABB4(packetRay, boxes, closest, tEntry);
+                this->stats.itemsTested += lanes;
+
+                for (uint32_t k = 0; k < lanes; ++k) {
+                    const uint32_t i = first + k;
+                    const float t = tEntry[k];
+                    if (!(mask & (1u << k)) || t >= closest) {
+                        continue;
+                    }
+                    if (mode == PickMode::Triangle && this->items[i]->GetMesh()->CanPickTriangles()) {
+                        // The box is only a bound here, descend into the mesh's triangle BVH
+                        if (this->IntersectItem(i, ray, closest, hit)) {
+                            closest = hit.t;
+                            found = true;
+                        }
+                    } else {
+                        // Box mode, or a mesh whose triangles were released (MeshResidency::Drop)
+                        closest = t;
+                        hit.node = this->items[i];
+                        hit.t = t;
+                        hit.triangle = -1;
+                        found = true;
+                    }
+                }
+            }
+            continue;
+        }
+
+        uint32_t nearChild = node.first, farChild = node.first + 1;
+        float tEntry[4];
+        const uint32_t mask = IntersectChildren(packetRay, &this->nodes[node.first], closest, tEntry);
+        bool hitNear = (mask & 1u) != 0, hitFar = (mask & 2u) != 0;
+        if (hitNear && hitFar && tEntry[1] < tEntry[0]) {
+            std::swap(nearChild, farChild);
+        }
+        // Push the far child first so the near one is popped next
+        if (hitFar) stack[top++] = farChild;
+        if (hitNear) stack[top++] = nearChild;
+    }
+    return found;
+}
+
+void SceneBVH::AppendSubtree(uint32_t nodeIndex, std::vector<SceneNode*>& out) const {
+    const BVHNode& node = this->nodes[nodeIndex];
+    if (node.count > 0) {
+        for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+            if (this->itemMins[i].x <= this->itemMaxs[i].x) {
+                out.push_back(this->items[i]);
+            }
+        }
+        return;
+    }
+    this->AppendSubtree(node.first, out);
+    this->AppendSubtree(node.first + 1, out);
+}
+
+// Subtrees fully inside the frustum are appended without further plane tests
+void SceneBVH::QueryFrustum(const Frustum& frustum, std::vector<SceneNode*>& out) const {
+    if (this->nodes.empty()) return;
+
+    uint32_t stack[BVH_STACK_SIZE];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        uint32_t index = stack[--top];
+        const BVHNode& node = this->nodes[index];
+        this->stats.nodesVisited++;
+        if (node.min.x > node.max.x) continue;
+
+        Frustum::Result r = frustum.TestAABB(node.min, node.max);
+        if (r == Frustum::Result::Outside) continue;
+        if (r == Frustum::Result::Inside) {
+            this->AppendSubtree(index, out);
+            continue;
+        }
+
+        if (node.count > 0) {
+            for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+                this->stats.itemsTested++;
+                if (this->itemMins[i].x <= this->itemMaxs[i].x && frustum.IsVisible(this->itemMins[i], this->itemMaxs[i])) {
+                    out.push_back(this->items[i]);
+                }
+            }
+        } else {
+            stack[top++] = node.first + 1;
+            stack[top++] = node.first;
+        }
+    }
+}
+
+static inline bool Overlaps(const glm::vec3& aMin, const glm::vec3& aMax, const glm::vec3& bMin, const glm::vec3& bMax) {
+    return aMin.x <= bMax.x && aMax.x >= bMin.x &&
+           aMin.y <= bMax.y && aMax.y >= bMin.y &&
+           aMin.z <= bMax.z && aMax.z >= bMin.z;
+}
+
+void SceneBVH::QueryOverlap(const glm::vec3& min, const glm::vec3& max, std::vector<SceneNode*>& out) const {
+    if (this->nodes.empty()) return;
+
+    uint32_t stack[BVH_STACK_SIZE];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const BVHNode& node = this->nodes[stack[--top]];
+        this->stats.nodesVisited++;
+        if (!Overlaps(node.min, node.max, min, max)) continue;
+
+        if (node.count > 0) {
+            for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+                this->stats.itemsTested++;
+                if (Overlaps(this->itemMins[i], this->itemMaxs[i], min, max)) {
+                    out.push_back(this->items[i]);
+                }
+            }
+        } else {
+            stack[top++] = node.first + 1;
+            stack[top++] = node.first;
+        }
+    }
+}
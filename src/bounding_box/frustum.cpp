@@ -0,0 +1,55 @@
+#include "bounding_box/frustum.h"
+#include <cmath>
+
+void Frustum::Update(const glm::mat4& viewProj) {
+    // glm is column-major, row i of the matrix is (m[0][i], m[1][i], m[2][i], m[3][i])
+    auto row = [&](int i) {
+        return glm::vec4(viewProj[0][i], viewProj[1][i], viewProj[2][i], viewProj[3][i]);
+    };
+    const glm::vec4 r0 = row(0), r1 = row(1), r2 = row(2), r3 = row(3);
+    const glm::vec4 planes[PLANE_COUNT] = {
+        r3 + r0,    // left
+        r3 - r0,    // right
+        r3 + r1,    // bottom
+        r3 - r1,    // top
+        r3 + r2,    // near
+        r3 - r2     // far
+    };
+
+    for (int i = 0; i < PLANE_COUNT; ++i) {
+        float len = glm::length(glm::vec3(planes[i]));
+        float inv = len > 0.0f ? 1.0f / len : 0.0f;
+        this->nx[i] = planes[i].x * inv;
+        this->ny[i] = planes[i].y * inv;
+        this->nz[i] = planes[i].z * inv;
+        this->d[i]  = planes[i].w * inv;
+    }
+    // Padding planes always accept everything
+    for (int i = PLANE_COUNT; i < PLANE_COUNT + 2; ++i) {
+        this->nx[i] = this->ny[i] = this->nz[i] = 0.0f;
+        this->d[i] = 1.0f;
+    }
+}
+
+// Center/extent test: the box is outside a plane if its center distance plus the
+// projected extent is negative, and fully inside if the distance minus it is positive.
+Frustum::Result Frustum::TestAABB(const glm::vec3& min, const glm::vec3& max) const {
+    const float cx = 0.5f * (min.x + max.x), cy = 0.5f * (min.y + max.y), cz = 0.5f * (min.z + max.z);
+    const float ex = 0.5f * (max.x - min.x), ey = 0.5f * (max.y - min.y), ez = 0.5f * (max.z - min.z);
+
+    // Branch-free over all planes, reduced at the end
+    float dist[PLANE_COUNT + 2];
+    float radius[PLANE_COUNT + 2];
+    for (int i = 0; i < PLANE_COUNT + 2; ++i) {
+        dist[i]   = this->nx[i] * cx + this->ny[i] * cy + this->nz[i] * cz + this->d[i];
+        radius[i] = std::fabs(this->nx[i]) * ex + std::fabs(this->ny[i]) * ey + std::fabs(this->nz[i]) * ez;
+    }
+
+    bool outside = false, intersect = false;
+    for (int i = 0; i < PLANE_COUNT + 2; ++i) {
+        outside   |= dist[i] + radius[i] < 0.0f;
+        intersect |= dist[i] - radius[i] < 0.0f;
+    }
+    if (outside) return Result::Outside;
+    return intersect ? Result::Intersect : Result::Inside;
+}
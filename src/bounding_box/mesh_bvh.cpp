@@ -0,0 +1,187 @@
+#include "bounding_box/mesh_bvh.h"
+#include "geometry.h"
+#include <algorithm>
+#include <cmath>
+
+void MeshBVH::Build(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices) {
+    this->Build(vertices.data(), vertices.size(), indices.data(), indices.size());
+}
+
+void MeshBVH::Build(const Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount) {
+    this->BuildFrom([vertices](unsigned int i) -> const glm::vec3& { return vertices[i].position; },
+                    vertexCount, indices, indexCount);
+}
+
+void MeshBVH::Build(const glm::vec3* positions, size_t vertexCount, const unsigned int* indices, size_t indexCount) {
+    this->BuildFrom([positions](unsigned int i) -> const glm::vec3& { return positions[i]; },
+                    vertexCount, indices, indexCount);
+}
+
+template<typename PositionOf>
+void MeshBVH::BuildFrom(PositionOf positionOf, size_t vertexCount, const unsigned int* indices, size_t indexCount) {
+    this->nodes.clear();
+    this->positions.clear();
+    this->triangleIds.clear();
+
+    // Triangle boxes, triangles with out of range indices are skipped
+    const size_t triangleCount = indexCount / 3;
+    std::vector<glm::vec3> mins, maxs;
+    std::vector<uint32_t> ids;
+    mins.reserve(triangleCount);
+    maxs.reserve(triangleCount);
+    ids.reserve(triangleCount);
+    for (size_t tri = 0; tri < triangleCount; ++tri) {
+        unsigned int i0 = indices[3 * tri], i1 = indices[3 * tri + 1], i2 = indices[3 * tri + 2];
+        if (i0 >= vertexCount || i1 >= vertexCount || i2 >= vertexCount) continue;
+        const glm::vec3& a = positionOf(i0);
+        const glm::vec3& b = positionOf(i1);
+        const glm::vec3& c = positionOf(i2);
+        mins.push_back(glm::min(a, glm::min(b, c)));
+        maxs.push_back(glm::max(a, glm::max(b, c)));
+        ids.push_back(static_cast<uint32_t>(tri));
+    }
+    if (ids.empty()) {
+        return;
+    }
+
+    std::vector<uint32_t> order;
+    BuildBinnedSAH(mins, maxs, MAX_LEAF_SIZE, this->nodes, order);
+
+    this->positions.resize(3 * order.size());
+    this->triangleIds.resize(order.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        uint32_t tri = ids[order[i]];
+        this->triangleIds[i] = tri;
+        this->positions[3 * i]     = positionOf(indices[3 * tri]);
+        this->positions[3 * i + 1] = positionOf(indices[3 * tri + 1]);
+        this->positions[3 * i + 2] = positionOf(indices[3 * tri + 2]);
+    }
+}
+
+size_t MeshBVH::GetMemoryBytes() const {
+    return this->nodes.size() * sizeof(BVHNode) +
+           this->positions.size() * sizeof(glm::vec3) +
+           this->triangleIds.size() * sizeof(uint32_t);
+}
+
+namespace {
+    // Per ray setup of the watertight test (Woop, Benthin, Wald 2013):
+    // the ray is permuted so z is its dominant axis and sheared onto +z,
+    // after which edge tests are 2D and consistent between neighbours.
+    struct WatertightRay {
+        int kx, ky, kz;
+        float sx, sy, sz;
+        glm::vec3 origin;
+
+        WatertightRay(const glm::vec3& o, const glm::vec3& d) : origin(o) {
+            glm::vec3 a = glm::abs(d);
+            this->kz = (a.x > a.y) ? (a.x > a.z ? 0 : 2) : (a.y > a.z ? 1 : 2);
+            this->kx = (this->kz + 1) % 3;
+            this->ky = (this->kx + 1) % 3;
+            // Keep the winding: swap x and y when the dominant component is negative
+            if (d[this->kz] < 0.0f) std::swap(this->kx, this->ky);
+            this->sx = d[this->kx] / d[this->kz];
+            this->sy = d[this->ky] / d[this->kz];
+            this->sz = 1.0f / d[this->kz];
+        }
+
+        // Returns true on a hit with t in (0, tMax), both faces are accepted
+        bool Intersect(const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2,
+                       float tMax, float& t, float& b1, float& b2) const {
+            const glm::vec3 A = v0 - this->origin;
+            const glm::vec3 B = v1 - this->origin;
+            const glm::vec3 C = v2 - this->origin;
+
+            const float ax = A[kx] - sx * A[kz], ay = A[ky] - sy * A[kz];
+            const float bx = B[kx] - sx * B[kz], by = B[ky] - sy * B[kz];
+            const float cx = C[kx] - sx * C[kz], cy = C[ky] - sy * C[kz];
+
+            float U = cx * by - cy * bx;
+            float V = ax * cy - ay * cx;
+            float W = bx * ay - by * ax;
+
+            // Edge exactly through the ray: redo the 2D cross products in double
+            if (U == 0.0f || V == 0.0f || W == 0.0f) {
+                U = static_cast<float>(static_cast<double>(cx) * by - static_cast<double>(cy) * bx);
+                V = static_cast<float>(static_cast<double>(ax) * cy - static_cast<double>(ay) * cx);
+                W = static_cast<float>(static_cast<double>(bx) * ay - static_cast<double>(by) * ax);
+            }
+
+            if ((U < 0.0f || V < 0.0f || W < 0.0f) && (U > 0.0f || V > 0.0f || W > 0.0f)) {
+                return false;
+            }
+            const float det = U + V + W;
+            if (det == 0.0f) {
+                return false;
+            }
+
+            const float az = sz * A[kz], bz = sz * B[kz], cz = sz * C[kz];
+            const float T = U * az + V * bz + W * cz;
+
+            // Range check on the unscaled distance, sign follows the determinant
+            if (det > 0.0f) {
+                if (T <= 0.0f || T >= tMax * det) return false;
+            } else {
+                if (T >= 0.0f || T <= tMax * det) return false;
+            }
+
+            const float invDet = 1.0f / det;
+            t = T * invDet;
+            b1 = V * invDet;
+            b2 = W * invDet;
+            return true;
+        }
+    };
+}
+
+// Front-to-back traversal, children beyond the closest hit are skipped
+bool MeshBVH::Intersect(const glm::vec3& origin, const glm::vec3& direction, MeshHit& hit) const {
+    if (this->nodes.empty()) return false;
+    if (direction.x == 0.0f && direction.y == 0.0f && direction.z == 0.0f) return false;
+
+    const WatertightRay ray(origin, direction);
+    const PacketRay packetRay(origin, direction);
+    float closest = hit.t;
+    bool found = false;
+
+    float tRoot;
+    if (!RayBoxTest(packetRay.origin, packetRay.invDir, this->nodes[0].min, this->nodes[0].max, closest, tRoot)) {
+        return false;
+    }
+
+    uint32_t stack[BVH_STACK_SIZE];
+    int top = 0;
+    stack[top++] = 0;
+
+    while (top > 0) {
+        const BVHNode& node = this->nodes[stack[--top]];
+
+        if (node.count > 0) {
+            for (uint32_t i = node.first; i < node.first + node.count; ++i) {
+                float t, b1, b2;
+                if (ray.Intersect(this->positions[3 * i], this->positions[3 * i + 1], this->positions[3 * i + 2],
+                                  closest, t, b1, b2)) {
+                    closest = t;
+                    hit.t = t;
+                    hit.triangle = this->triangleIds[i];
+                    hit.u = b1;
+                    hit.v = b2;
+                    found = true;
+                }
+            }
+            continue;
+        }
+
+        uint32_t nearChild = node.first, farChild = node.first + 1;
+        float tEntry[4];
+        const uint32_t mask = IntersectChildren(packetRay, &this->nodes[node.first], closest, tEntry);
+        bool hitNear = (mask & 1u) != 0, hitFar = (mask & 2u) != 0;
+        if (hitNear && hitFar && tEntry[1] < tEntry[0]) {
+            std::swap(nearChild, farChild);
+        }
+        // Push the far child first so the near one is popped next
+        if (hitFar) stack[top++] = farChild;
+        if (hitNear) stack[top++] = nearChild;
+    }
+    return found;
+}
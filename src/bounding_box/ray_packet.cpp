@@ -0,0 +1,199 @@
+#include "bounding_box/ray_packet.h"
+#include <limits>
+
+#if defined(RAY_PACKET_AVX2) || defined(RAY_PACKET_SSE)
+#include <immintrin.h>
+#elif defined(RAY_PACKET_NEON)
+#include <arm_neon.h>
+#endif
+
+// Exit distances are widened by 1 + 2 * gamma(3) against rounding in the slab test
+static constexpr float EXIT_SCALE = 1.00000072f;
+
+// Scalar min/max in the same operand order as the packet code below:
+// the second operand is returned when either is NaN
+static inline float MinOrSecond(float a, float b) { return a < b ? a : b; }
+static inline float MaxOrSecond(float a, float b) { return a > b ? a : b; }
+
+bool RayBoxTest(const glm::vec3& origin, const glm::vec3& invDir,
+                const glm::vec3& min, const glm::vec3& max, float tMax, float& tEntry) {
+    const glm::vec3 t1 = (min - origin) * invDir;
+    const glm::vec3 t2 = (max - origin) * invDir;
+    // Per axis entry/exit, a NaN axis is passed first so the reduction skips it
+    const float nearX = MinOrSecond(t2.x, t1.x), farX = MaxOrSecond(t1.x, t2.x);
+    const float nearY = MinOrSecond(t2.y, t1.y), farY = MaxOrSecond(t1.y, t2.y);
+    const float nearZ = MinOrSecond(t2.z, t1.z), farZ = MaxOrSecond(t1.z, t2.z);
+    float tNear = MaxOrSecond(nearX, MaxOrSecond(nearY, MaxOrSecond(nearZ, 0.0f)));
+    float tFar = MinOrSecond(farX, MinOrSecond(farY, MinOrSecond(farZ, std::numeric_limits<float>::infinity())));
+    // Widen the exit so rounding never rejects a ray grazing a vertex on the
+    // box boundary (Ize, robust BVH ray traversal), keeps picking watertight
+    tFar = MinOrSecond(tFar * EXIT_SCALE, tMax);
+    tEntry = tNear;
+    return tNear <= tFar;
+}
+
+void AABB4::Set(int lane, const glm::vec3& min, const glm::vec3& max) {
+    this->minX[lane] = min.x; this->minY[lane] = min.y; this->minZ[lane] = min.z;
+    this->maxX[lane] = max.x; this->maxY[lane] = max.y; this->maxZ[lane] = max.z;
+}
+
+void AABB4::Clear() {
+    for (int i = 0; i < 4; ++i) {
+        this->Set(i, glm::vec3(std::numeric_limits<float>::max()), glm::vec3(std::numeric_limits<float>::lowest()));
+    }
+}
+
+void AABB8::Set(int lane, const glm::vec3& min, const glm::vec3& max) {
+    this->minX[lane] = min.x; this->minY[lane] = min.y; this->minZ[lane] = min.z;
+    this->maxX[lane] = max.x; this->maxY[lane] = max.y; this->maxZ[lane] = max.z;
+}
+
+void AABB8::Clear() {
+    for (int i = 0; i < 8; ++i) {
+        this->Set(i, glm::vec3(std::numeric_limits<float>::max()), glm::vec3(std::numeric_limits<float>::lowest()));
+    }
+}
+
+void RayPacket4::Set(int lane, const PacketRay& ray, float tMax) {
+    this->originX[lane] = ray.origin.x; this->originY[lane] = ray.origin.y; this->originZ[lane] = ray.origin.z;
+    this->invDirX[lane] = ray.invDir.x; this->invDirY[lane] = ray.invDir.y; this->invDirZ[lane] = ray.invDir.z;
+    this->tMax[lane] = tMax;
+}
+
+// 4-wide float with SSE min/max semantics on every backend: Min(a, b) and
+// Max(a, b) return b when either operand is NaN. The slab code relies on this
+// order to drop NaN slabs (ray on a slab plane) instead of propagating them.
+namespace {
+#if defined(RAY_PACKET_SSE)
+    using F4 = __m128;
+    inline F4 Load(const float* p) { return _mm_load_ps(p); }
+    inline F4 Set1(float v) { return _mm_set1_ps(v); }
+    inline F4 Sub(F4 a, F4 b) { return _mm_sub_ps(a, b); }
+    inline F4 Mul(F4 a, F4 b) { return _mm_mul_ps(a, b); }
+    inline F4 Min(F4 a, F4 b) { return _mm_min_ps(a, b); }
+    inline F4 Max(F4 a, F4 b) { return _mm_max_ps(a, b); }
+    inline void Store(float* p, F4 v) { _mm_storeu_ps(p, v); }
+    // Bit i set when a[i] <= b[i]
+    inline uint32_t LessEqualMask(F4 a, F4 b) { return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(a, b))); }
+#elif defined(RAY_PACKET_NEON)
+    using F4 = float32x4_t;
+    inline F4 Load(const float* p) { return vld1q_f32(p); }
+    inline F4 Set1(float v) { return vdupq_n_f32(v); }
+    inline F4 Sub(F4 a, F4 b) { return vsubq_f32(a, b); }
+    inline F4 Mul(F4 a, F4 b) { return vmulq_f32(a, b); }
+    // vminq/vmaxq propagate NaN, select explicitly to keep the SSE order
+    inline F4 Min(F4 a, F4 b) { return vbslq_f32(vcltq_f32(a, b), a, b); }
+    inline F4 Max(F4 a, F4 b) { return vbslq_f32(vcgtq_f32(a, b), a, b); }
+    inline void Store(float* p, F4 v) { vst1q_f32(p, v); }
+    inline uint32_t LessEqualMask(F4 a, F4 b) {
+        static const uint32_t bits[4] = { 1u, 2u, 4u, 8u };
+        return vaddvq_u32(vandq_u32(vcleq_f32(a, b), vld1q_u32(bits)));
+    }
+#else
+    struct F4 { float v[4]; };
+    inline F4 Load(const float* p) { return F4{ { p[0], p[1], p[2], p[3] } }; }
+    inline F4 Set1(float x) { return F4{ { x, x, x, x } }; }
+    inline F4 Sub(F4 a, F4 b) { for (int i = 0; i < 4; ++i) a.v[i] -= b.v[i]; return a; }
+    inline F4 Mul(F4 a, F4 b) { for (int i = 0; i < 4; ++i) a.v[i] *= b.v[i]; return a; }
+    inline F4 Min(F4 a, F4 b) { for (int i = 0; i < 4; ++i) a.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i]; return a; }
+    inline F4 Max(F4 a, F4 b) { for (int i = 0; i < 4; ++i) a.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i]; return a; }
+    inline void Store(float* p, F4 a) { for (int i = 0; i < 4; ++i) p[i] = a.v[i]; }
+    inline uint32_t LessEqualMask(F4 a, F4 b) {
+        uint32_t m = 0;
+        for (int i = 0; i < 4; ++i) m |= (a.v[i] <= b.v[i]) ? (1u << i) : 0u;
+        return m;
+    }
+#endif
+
+    // One slab: near = Min(t2, t1) is NaN only if t1 is, far = Max(t1, t2) only if t2 is,
+    // and the accumulators are passed second so a NaN leaves them unchanged
+    inline void Slab(F4 min, F4 max, F4 origin, F4 invDir, F4& tNear, F4& tFar) {
+        F4 t1 = Mul(Sub(min, origin), invDir);
+        F4 t2 = Mul(Sub(max, origin), invDir);
+        tNear = Max(Min(t2, t1), tNear);
+        tFar = Min(Max(t1, t2), tFar);
+    }
+
+    // Shared by all 4-wide entry points, any argument may be a broadcast
+    inline uint32_t Test4(F4 minX, F4 minY, F4 minZ, F4 maxX, F4 maxY, F4 maxZ,
+                          F4 ox, F4 oy, F4 oz, F4 ix, F4 iy, F4 iz, F4 tMax, float* tEntry) {
+        F4 tNear = Set1(0.0f);
+        F4 tFar = Set1(std::numeric_limits<float>::infinity());
+        Slab(minX, maxX, ox, ix, tNear, tFar);
+        Slab(minY, maxY, oy, iy, tNear, tFar);
+        Slab(minZ, maxZ, oz, iz, tNear, tFar);
+        tFar = Min(Mul(tFar, Set1(EXIT_SCALE)), tMax);
+        Store(tEntry, tNear);
+        // Empty lanes (min > max) never hit
+        return LessEqualMask(tNear, tFar) & LessEqualMask(minX, maxX);
+    }
+}
+
+uint32_t IntersectRayAABB4(const PacketRay& ray, const AABB4& boxes, float tMax, float tEntry[4]) {
+    return Test4(Load(boxes.minX), Load(boxes.minY), Load(boxes.minZ),
+                 Load(boxes.maxX), Load(boxes.maxY), Load(boxes.maxZ),
+                 Set1(ray.origin.x), Set1(ray.origin.y), Set1(ray.origin.z),
+                 Set1(ray.invDir.x), Set1(ray.invDir.y), Set1(ray.invDir.z),
+                 Set1(tMax), tEntry);
+}
+
+uint32_t IntersectRay4AABB(const RayPacket4& rays, const glm::vec3& min, const glm::vec3& max, float tEntry[4]) {
+    // Box bounds are broadcast, so the empty-lane check is uniform
+    return Test4(Set1(min.x), Set1(min.y), Set1(min.z),
+                 Set1(max.x), Set1(max.y), Set1(max.z),
+                 Load(rays.originX), Load(rays.originY), Load(rays.originZ),
+                 Load(rays.invDirX), Load(rays.invDirY), Load(rays.invDirZ),
+                 Load(rays.tMax), tEntry);
+}
+
+#if defined(RAY_PACKET_AVX2)
+uint32_t IntersectRayAABB8(const PacketRay& ray, const AABB8& boxes, float tMax, float tEntry[8]) {
+    const __m256 ox = _mm256_set1_ps(ray.origin.x), oy = _mm256_set1_ps(ray.origin.y), oz = _mm256_set1_ps(ray.origin.z);
+    const __m256 ix = _mm256_set1_ps(ray.invDir.x), iy = _mm256_set1_ps(ray.invDir.y), iz = _mm256_set1_ps(ray.invDir.z);
+    __m256 tNear = _mm256_setzero_ps();
+    __m256 tFar = _mm256_set1_ps(std::numeric_limits<float>::infinity());
+
+    const float* mins[3] = { boxes.minX, boxes.minY, boxes.minZ };
+    const float* maxs[3] = { boxes.maxX, boxes.maxY, boxes.maxZ };
+    const __m256 origins[3] = { ox, oy, oz };
+    const __m256 invDirs[3] = { ix, iy, iz };
+    for (int axis = 0; axis < 3; ++axis) {
+        __m256 t1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(mins[axis]), origins[axis]), invDirs[axis]);
+        __m256 t2 = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(maxs[axis]), origins[axis]), invDirs[axis]);
+        tNear = _mm256_max_ps(_mm256_min_ps(t2, t1), tNear);
+        tFar = _mm256_min_ps(_mm256_max_ps(t1, t2), tFar);
+    }
+    tFar = _mm256_min_ps(_mm256_mul_ps(tFar, _mm256_set1_ps(EXIT_SCALE)), _mm256_set1_ps(tMax));
+    _mm256_storeu_ps(tEntry, tNear);
+
+    __m256 hit = _mm256_and_ps(_mm256_cmp_ps(tNear, tFar, _CMP_LE_OQ),
+                               _mm256_cmp_ps(_mm256_load_ps(boxes.minX), _mm256_load_ps(boxes.maxX), _CMP_LE_OQ));
+    return static_cast<uint32_t>(_mm256_movemask_ps(hit));
+}
+#else
+// Two 4-wide halves, the arrays of AABB8 stay 16-byte aligned at lane 4
+uint32_t IntersectRayAABB8(const PacketRay& ray, const AABB8& boxes, float tMax, float tEntry[8]) {
+    const F4 ox = Set1(ray.origin.x), oy = Set1(ray.origin.y), oz = Set1(ray.origin.z);
+    const F4 ix = Set1(ray.invDir.x), iy = Set1(ray.invDir.y), iz = Set1(ray.invDir.z);
+    uint32_t mask = 0;
+    for (int half = 0; half < 2; ++half) {
+        const int o = 4 * half;
+        mask |= Test4(Load(boxes.minX + o), Load(boxes.minY + o), Load(boxes.minZ + o),
+                      Load(boxes.maxX + o), Load(boxes.maxY + o), Load(boxes.maxZ + o),
+                      ox, oy, oz, ix, iy, iz, Set1(tMax), tEntry + o) << o;
+    }
+    return mask;
+}
+#endif
+
+const char* GetRayPacketBackend() {
+#if defined(RAY_PACKET_AVX2)
+    return "AVX2 (8 wide) + SSE (4 wide)";
+#elif defined(RAY_PACKET_SSE)
+    return "SSE (4 wide)";
+#elif defined(RAY_PACKET_NEON)
+    return "NEON (4 wide)";
+#else
+    return "scalar";
+#endif
+}
@@ -10,12 +10,20 @@
 #include <filesystem>
 #include <gli/gli.hpp>
 #include <gli/load_ktx.hpp>
+#include <chrono>
+#include <cstring>
+#include <algorithm>
 #include "config.h"
+#include "mapped_file.h"
+#include "cubemap/ibl_baker.h"
+#include "texture/hdr_format.h"
 namespace fs = std::filesystem;
 
 Cubemap::Cubemap():
     cubemap(0),
+    size(0),
     mipLevels(0),
+    totalMipLevels(0),
     internalFormat(GL_RGB32F),
     format(GL_RGB),
     type(GL_FLOAT) {
@@ -23,12 +31,21 @@ Cubemap::Cubemap():
 }
 
 // Create HDR format by default
-Cubemap::Cubemap(unsigned int size, int mipLevels): 
+Cubemap::Cubemap(unsigned int size, int mipLevels, GLenum internalFormat): 
     size(size), 
     mipLevels(mipLevels),
     internalFormat(GL_RGB32F),
     format(GL_RGB),
     type(GL_FLOAT) {
+        HDRFormatInfo info;
+        if (GetHDRFormatInfo(internalFormat, info)) {
+            this->internalFormat = info.internalFormat;
+            this->format = info.format;
+            this->type = info.type;
+        } else {
+            std::cerr << "[Cubemap] Unsupported internal format 0x" << std::hex << internalFormat << std::dec
+                      << ", using GL_RGB32F\n";
+        }
         this->totalMipLevels = static_cast<int>(std::floor(std::log2(this->size))) + 1;
         this->InitializeCubemap();
 }
@@ -62,6 +79,13 @@ void Cubemap::LoadKTXToCubemap(const std::string& path) {
     // 非对齐格式安全起见
     glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
+    // Storage format conversion, e.g. an RGB32F file into a GL_R11F_G11F_B10F cubemap
+    HDRFormatInfo sourceInfo, targetInfo;
+    const bool convert = !gli::is_compressed(tex.format()) &&
+                         static_cast<GLenum>(glFmt.Internal) != this->internalFormat &&
+                         GetHDRFormatInfo(static_cast<GLenum>(glFmt.Internal), sourceInfo) &&
+                         GetHDRFormatInfo(this->internalFormat, targetInfo);
+
     // 6) 逐 mip / face 上传
     for (std::size_t level = 0; level < tex.levels(); ++level) {
         const auto e = tex.extent(level); // e.x, e.y
@@ -79,6 +103,16 @@ void Cubemap::LoadKTXToCubemap(const std::string& path) {
                 glCompressedTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + static_cast<GLenum>(face),
                                        static_cast<GLint>(level),
                                        glFmt.Internal, w, h, 0, size, data);
+            } else if (convert) {
+                // Float data in another HDR format: repack to the cubemap's internal format
+                const size_t count = static_cast<size_t>(w) * h;
+                const std::vector<float> texels = UnpackHDRPixels(data, count, sourceInfo.internalFormat);
+                const std::vector<unsigned char> pixels =
+                    PackHDRPixels(texels.data(), sourceInfo.channels, count, this->internalFormat);
+                glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + static_cast<GLenum>(face),
+                             static_cast<GLint>(level),
+                             this->internalFormat, w, h, 0,
+                             this->format, this->type, pixels.data());
             } else {
                 // 非压缩纹理走常规上传（格式/类型由 translator 给出）
                 glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + static_cast<GLenum>(face),
@@ -99,7 +133,11 @@ void Cubemap::LoadKTXToCubemap(const std::string& path) {
     glBindTexture(target, 0);
 
     std::cout << "[Cubemap] Successfully loaded KTX cubemap: " << path
-              << " (levels=" << tex.levels() << ")\n";
+              << " (levels=" << tex.levels();
+    if (convert) {
+        std::cout << ", " << GetHDRFormatName(sourceInfo.internalFormat) << " -> " << GetHDRFormatName(this->internalFormat);
+    }
+    std::cout << ")\n";
 }
 
 
@@ -123,8 +161,8 @@ void Cubemap::InitializeCubemap() {
         for (int mip = 0; mip < this->totalMipLevels; ++mip) {
             int mipSize = this->size >> mip;
             glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, mip,
-                         GL_RGB32F, mipSize, mipSize, 0,
-                         GL_RGB, GL_FLOAT, nullptr);
+                         this->internalFormat, mipSize, mipSize, 0,
+                         this->format, this->type, nullptr);
         }
     }
 
@@ -151,94 +189,151 @@ void Cubemap::InitializeCubemap() {
 
 // Load and convert equirectangular HDR image to cubemap
 void Cubemap::LoadEquiToCubemap(const std::string& path) {
-    // Create 2d texture and loaded with equirectanguar image
-    auto envTexture2D = std::make_shared<Texture2D>(this->size, this->size, this->internalFormat, this->format, this->type);
-    envTexture2D->LoadHDRToTexture(path);
+    auto start = std::chrono::high_resolution_clock::now();
+    auto elapsedMs = [&start]() {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    };
 
-    // Check if texture is loaded successfully
-    if (envTexture2D->GetTexture() == 0) {
-        std::cerr << "❌ Texture loading failed. Cannot proceed with cubemap generation.\n";
-        return;
+    // Default constructed: size from the image header, a face covers a quarter of the width
+    if (this->size <= 0) {
+        int w = 0, h = 0, comp = 0;
+        if (!stbi_info(path.c_str(), &w, &h, &comp)) {
+            std::cerr << "❌ Failed to read HDR header: " << path << "\n";
+            return;
+        }
+        this->size = std::max(1, w / 4);
+        this->totalMipLevels = static_cast<int>(std::floor(std::log2(this->size))) + 1;
+        this->InitializeCubemap();
     }
 
-    // Create unit cube for drawing cubemap
-    auto cube = std::make_shared<UnitCube>();
-
-    // Create FBO + RBO
-    GLuint fbo, rbo;
-    glGenFramebuffers(1, &fbo);
-    glGenRenderbuffers(1, &rbo);
-    glBindFramebuffer(GL_FRAMEBUFFER, fbo); // Bind to FBO
-    glBindRenderbuffer(GL_RENDERBUFFER, rbo);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, this->size, this->size);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rbo);
-
-    // Camera parameters for sampling 6 faces of cubemap
-    glm::vec3 cameraPos = glm::vec3(0.0f, 0.0f, 0.0f);
-    glm::vec3 cameraFront[6] = {
-        glm::vec3( 1.0f,  0.0f,  0.0f),
-        glm::vec3(-1.0f,  0.0f,  0.0f),
-        glm::vec3( 0.0f,  1.0f,  0.0f),
-        glm::vec3( 0.0f, -1.0f,  0.0f),
-        glm::vec3( 0.0f,  0.0f,  1.0f),
-        glm::vec3( 0.0f,  0.0f, -1.0f)
-    };
+    // Warm start: the converted cube is already on disk
+    const std::string cachePath = this->GetEquiCachePath(path);
+    // Any error reading either time counts as stale and rebuilds the cache
+    std::error_code cacheEc, sourceEc;
+    bool cacheFresh = false;
+    if (fs::exists(cachePath, cacheEc)) {
+        const auto cacheTime = fs::last_write_time(cachePath, cacheEc);
+        const auto sourceTime = fs::last_write_time(path, sourceEc);
+        cacheFresh = !cacheEc && !sourceEc && cacheTime >= sourceTime;
+    }
+    if (cacheFresh && this->LoadMappedKTX(cachePath)) {
+        std::cout << "[Cubemap] Loaded cached cubemap " << cachePath << " in " << elapsedMs() << " ms\n";
+        return;
+    }
 
-    glm::vec3 cameraUp[6] = {
-        glm::vec3(0.0f, -1.0f,  0.0f),
-        glm::vec3(0.0f, -1.0f,  0.0f),
-        glm::vec3(0.0f,  0.0f,  1.0f),
-        glm::vec3(0.0f,  0.0f, -1.0f),
-        glm::vec3(0.0f, -1.0f,  0.0f),
-        glm::vec3(0.0f, -1.0f,  0.0f)
-    };
+    // Cold start: resample on the CPU, upload and bake for the next launch
+    EquirectImage equirect;
+    if (!equirect.Load(path)) {
+        std::cerr << "❌ Texture loading failed. Cannot proceed with cubemap generation.\n";
+        return;
+    }
+    CubeImage image;
+    image.Allocate(this->size, this->mipLevels > 1 ? this->totalMipLevels : 1);
+    IBLBaker::EquirectToCube(equirect, image);
+    if (image.GetLevelCount() > 1) {
+        image.GenerateMipmaps();
+    }
+    this->UploadCubeImage(image);
+    std::cout << "[Cubemap] Converted " << path << " (" << this->size << "x" << this->size
+              << ", levels=" << image.GetLevelCount() << ") in " << elapsedMs() << " ms\n";
 
-    glm::mat4 projection = glm::perspective(glm::radians(90.0f), 1.0f, 0.1f, 10.0f);
+    if (!IBLBaker::SaveCubeKTX(image, cachePath, this->internalFormat)) {
+        std::cerr << "[Cubemap] Could not write cache " << cachePath << "\n";
+    }
+}
 
-    // ==================Create Equirect → cubemap=======================
-    auto equiShader = std::make_shared<Shader>("shader/equi.vert", "shader/equi.frag");
-    equiShader->Use();
-    equiShader->SetUniform("envEqui", 0); 
+std::string Cubemap::GetEquiCachePath(const std::string& path) const {
+    const fs::path source(path);
+    const std::string name = source.stem().string() + ".cube" + std::to_string(this->size) +
+                             (this->mipLevels > 1 ? "m" : "") + "." + GetHDRFormatName(this->internalFormat) + ".ktx";
+    return (source.parent_path() / name).string();
+}
 
-    envTexture2D->Bind(DEFAULT_TEXTURE_UNIT); // bind
+void Cubemap::SetSamplerParameters(bool mipmapped) {
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, mipmapped ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+}
 
-    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
-    GLint prevViewport[4];
-    glGetIntegerv(GL_VIEWPORT, prevViewport); // Save the current viewport setting for reseting later
-    glViewport(0, 0, this->size, this->size); // Adjust the viewport to sample cubemap
-    for (int face = 0; face < 6; ++face) {
-        // attach face
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0,
-                            GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, this->cubemap, 0);
-        // Setup draw buffer
-        GLenum drawBuffers[1] = { GL_COLOR_ATTACHMENT0 };
-        glDrawBuffers(1, drawBuffers);
-
-        // Check framebuffer status
-        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-            std::cerr << "❌ Framebuffer not complete at face " << face << std::endl;
+void Cubemap::UploadCubeImage(const CubeImage& image) {
+    glBindTexture(GL_TEXTURE_CUBE_MAP, this->cubemap);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (int level = 0; level < image.GetLevelCount(); ++level) {
+        const int n = image.GetLevelSize(level);
+        for (int face = 0; face < 6; ++face) {
+            const std::vector<unsigned char> pixels =
+                PackHDRPixels(image.levels[level][face].data(), 3, static_cast<size_t>(n) * n, this->internalFormat);
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, this->internalFormat, n, n, 0,
+                         this->format, this->type, pixels.data());
         }
+    }
+    this->SetSamplerParameters(image.GetLevelCount() > 1);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+}
 
-        // Clear 
-        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+// KTX 1.1: identifier, 13 uint32 header fields, key/value data, then per level an
+// imageSize word followed by the six faces, each padded to 4 bytes. Only the byte
+// layout is used (writers disagree whether imageSize covers one face or all six).
+bool Cubemap::LoadMappedKTX(const std::string& path) {
+    static const unsigned char identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+    struct Header {
+        uint32_t endianness, glType, glTypeSize, glFormat, glInternalFormat, glBaseInternalFormat;
+        uint32_t pixelWidth, pixelHeight, pixelDepth, numberOfArrayElements, numberOfFaces;
+        uint32_t numberOfMipmapLevels, bytesOfKeyValueData;
+    };
 
-        // Upload view and projection matrix to shader
-        glm::mat4 view = glm::lookAt(cameraPos, cameraPos + cameraFront[face], cameraUp[face]);
-        equiShader->SetUniform("view", view);
-        equiShader->SetUniform("projection", projection);
-        
-        cube->Draw();
+    MappedFile file;
+    if (!file.Open(path) || file.GetSize() < sizeof(identifier) + sizeof(Header) ||
+        std::memcmp(file.GetData(), identifier, sizeof(identifier)) != 0) {
+        return false;
+    }
+    Header header;
+    std::memcpy(&header, file.GetData() + sizeof(identifier), sizeof(Header));
+    if (header.endianness != 0x04030201 || header.numberOfFaces != 6 || header.numberOfArrayElements != 0 ||
+        header.pixelWidth != static_cast<uint32_t>(this->size) || header.pixelHeight != header.pixelWidth ||
+        header.glInternalFormat != this->internalFormat || header.glType != this->type ||
+        header.glFormat != this->format) {
+        std::cerr << "[Cubemap] Cache does not match, converting again: " << path << "\n";
+        return false;
+    }
+    const int levels = std::max(1u, header.numberOfMipmapLevels);
+    if (levels != (this->mipLevels > 1 ? this->totalMipLevels : 1)) {
+        return false;
     }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0); // unbind fbo
 
-    // Release resources
-    cube.reset();
-    equiShader.reset();
-    glDeleteRenderbuffers(1, &rbo);
-    glDeleteFramebuffers(1, &fbo);
+    // Check every face lies inside the file before anything is uploaded
+    HDRFormatInfo info;
+    GetHDRFormatInfo(this->internalFormat, info);
+    const size_t bytesPerPixel = info.bytesPerPixel;
+    std::vector<const unsigned char*> faces;
+    size_t offset = sizeof(identifier) + sizeof(Header) + header.bytesOfKeyValueData;
+    for (int level = 0; level < levels; ++level) {
+        const size_t n = std::max(1, this->size >> level);
+        const size_t faceBytes = n * n * bytesPerPixel;
+        offset += sizeof(uint32_t);
+        for (int face = 0; face < 6; ++face) {
+            if (offset + faceBytes > file.GetSize()) {
+                std::cerr << "[Cubemap] Truncated cache: " << path << "\n";
+                return false;
+            }
+            faces.push_back(file.GetData() + offset);
+            offset += (faceBytes + 3) & ~static_cast<size_t>(3);
+        }
+    }
 
-    // Reset the viewport size
-    glViewport(prevViewport[0], prevViewport[1], prevViewport[2], prevViewport[3]);
+    file.AdviseSequential();
+    glBindTexture(GL_TEXTURE_CUBE_MAP, this->cubemap);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (int level = 0; level < levels; ++level) {
+        const GLsizei n = std::max(1, this->size >> level);
+        for (int face = 0; face < 6; ++face) {
+            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, this->internalFormat, n, n, 0,
+                         this->format, this->type, faces[level * 6 + face]);
+        }
+    }
+    this->SetSamplerParameters(levels > 1);
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+    return true;
 }
-
@@ -0,0 +1,647 @@
+#include "cubemap/ibl_baker.h"
+#include "thread_pool.h"
+#include "stb_image.h"
+#include <gli/gli.hpp>
+#include <gli/load.hpp>
+#include <gli/save_ktx.hpp>
+#include <gli/gl.hpp>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#define IBL_BAKER_SSE 1
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#define IBL_BAKER_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+    // KTX format of the HDR storage formats (texture/hdr_format.h)
+    gli::format ToGliFormat(GLenum internalFormat) {
+        switch (internalFormat) {
+            case GL_RGBA32F:        return gli::FORMAT_RGBA32_SFLOAT_PACK32;
+            case GL_RGB32F:         return gli::FORMAT_RGB32_SFLOAT_PACK32;
+            case GL_RG32F:          return gli::FORMAT_RG32_SFLOAT_PACK32;
+            case GL_RGBA16F:        return gli::FORMAT_RGBA16_SFLOAT_PACK16;
+            case GL_RGB16F:         return gli::FORMAT_RGB16_SFLOAT_PACK16;
+            case GL_RG16F:          return gli::FORMAT_RG16_SFLOAT_PACK16;
+            case GL_R11F_G11F_B10F: return gli::FORMAT_RG11B10_UFLOAT_PACK32;
+            default:                return gli::FORMAT_UNDEFINED;
+        }
+    }
+}
+
+// 4-wide float for the convolution kernels: SSE, NEON (Apple Silicon) or scalar
+namespace {
+#if defined(IBL_BAKER_SSE)
+    using F4 = __m128;
+    inline F4 Load(const float* p) { return _mm_loadu_ps(p); }
+    inline F4 Set1(float v) { return _mm_set1_ps(v); }
+    inline F4 Add(F4 a, F4 b) { return _mm_add_ps(a, b); }
+    inline F4 Sub(F4 a, F4 b) { return _mm_sub_ps(a, b); }
+    inline F4 Mul(F4 a, F4 b) { return _mm_mul_ps(a, b); }
+    inline F4 Div(F4 a, F4 b) { return _mm_div_ps(a, b); }
+    inline F4 Max(F4 a, F4 b) { return _mm_max_ps(a, b); }
+    inline F4 Min(F4 a, F4 b) { return _mm_min_ps(a, b); }
+    inline F4 Sqrt(F4 a) { return _mm_sqrt_ps(a); }
+    inline F4 Abs(F4 a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+    inline void Store(float* p, F4 v) { _mm_storeu_ps(p, v); }
+    using M4 = __m128;
+    inline M4 Less(F4 a, F4 b) { return _mm_cmplt_ps(a, b); }
+    inline F4 Select(M4 m, F4 a, F4 b) { return _mm_or_ps(_mm_and_ps(m, a), _mm_andnot_ps(m, b)); }
+#elif defined(IBL_BAKER_NEON)
+    using F4 = float32x4_t;
+    inline F4 Load(const float* p) { return vld1q_f32(p); }
+    inline F4 Set1(float v) { return vdupq_n_f32(v); }
+    inline F4 Add(F4 a, F4 b) { return vaddq_f32(a, b); }
+    inline F4 Sub(F4 a, F4 b) { return vsubq_f32(a, b); }
+    inline F4 Mul(F4 a, F4 b) { return vmulq_f32(a, b); }
+    inline F4 Div(F4 a, F4 b) { return vdivq_f32(a, b); }
+    inline F4 Max(F4 a, F4 b) { return vmaxq_f32(a, b); }
+    inline F4 Min(F4 a, F4 b) { return vminq_f32(a, b); }
+    inline F4 Sqrt(F4 a) { return vsqrtq_f32(a); }
+    inline F4 Abs(F4 a) { return vabsq_f32(a); }
+    inline void Store(float* p, F4 v) { vst1q_f32(p, v); }
+    using M4 = uint32x4_t;
+    inline M4 Less(F4 a, F4 b) { return vcltq_f32(a, b); }
+    inline F4 Select(M4 m, F4 a, F4 b) { return vbslq_f32(m, a, b); }
+#else
+    struct F4 { float v[4]; };
+    inline F4 Load(const float* p) { return F4{ { p[0], p[1], p[2], p[3] } }; }
+    inline F4 Set1(float x) { return F4{ { x, x, x, x } }; }
+    inline F4 Add(F4 a, F4 b) { for (int i = 0; i < 4; ++i) a.v[i] += b.v[i]; return a; }
+    inline F4 Sub(F4 a, F4 b) { for (int i = 0; i < 4; ++i) a.v[i] -= b.v[i]; return a; }
+    inline F4 Mul(F4 a, F4 b) { for (int i = 0; i < 4; ++i) a.v[i] *= b.v[i]; return a; }
+    inline F4 Div(F4 a, F4 b) { for (int i = 0; i < 4; ++i) a.v[i] /= b.v[i]; return a; }
+    inline F4 Max(F4 a, F4 b) { for (int i = 0; i < 4; ++i) a.v[i] = a.v[i] > b.v[i] ? a.v[i] : b.v[i]; return a; }
+    inline F4 Min(F4 a, F4 b) { for (int i = 0; i < 4; ++i) a.v[i] = a.v[i] < b.v[i] ? a.v[i] : b.v[i]; return a; }
+    inline F4 Sqrt(F4 a) { for (int i = 0; i < 4; ++i) a.v[i] = std::sqrt(a.v[i]); return a; }
+    inline F4 Abs(F4 a) { for (int i = 0; i < 4; ++i) a.v[i] = std::abs(a.v[i]); return a; }
+    inline void Store(float* p, F4 a) { for (int i = 0; i < 4; ++i) p[i] = a.v[i]; }
+    struct M4 { bool v[4]; };
+    inline M4 Less(F4 a, F4 b) { M4 m; for (int i = 0; i < 4; ++i) m.v[i] = a.v[i] < b.v[i]; return m; }
+    inline F4 Select(M4 m, F4 a, F4 b) { for (int i = 0; i < 4; ++i) a.v[i] = m.v[i] ? a.v[i] : b.v[i]; return a; }
+#endif
+
+    inline float Sum(F4 v) {
+        float lanes[4];
+        Store(lanes, v);
+        return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    }
+
+    // atan2 from a polynomial for atan on [0, 1] (Abramowitz & Stegun 4.4.49) and
+    // octant fix-ups, max error 1e-5 rad (a 16k equirect texel is 4e-4 rad wide)
+    inline F4 Atan2(F4 y, F4 x) {
+        const F4 zero = Set1(0.0f);
+        const F4 ax = Abs(x), ay = Abs(y);
+        const F4 a = Div(Min(ax, ay), Max(Max(ax, ay), Set1(1e-30f)));
+        const F4 s = Mul(a, a);
+        F4 r = Add(Mul(Set1(0.0208351f), s), Set1(-0.0851330f));
+        r = Add(Mul(r, s), Set1(0.1801410f));
+        r = Add(Mul(r, s), Set1(-0.3302995f));
+        r = Add(Mul(r, s), Set1(0.9998660f));
+        r = Mul(r, a);
+        r = Select(Less(ax, ay), Sub(Set1(0.5f * PI), r), r);
+        r = Select(Less(x, zero), Sub(Set1(PI), r), r);
+        return Select(Less(y, zero), Sub(zero, r), r);
+    }
+
+    double MsSince(std::chrono::high_resolution_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    // Van der Corput radical inverse in base 2
+    float RadicalInverse(uint32_t bits) {
+        bits = (bits << 16u) | (bits >> 16u);
+        bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+        bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+        bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+        bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+        return static_cast<float>(bits) * 2.3283064365386963e-10f;
+    }
+
+    // GGX distributed half vector around +Z, alpha = roughness^2
+    glm::vec3 ImportanceSampleGGX(uint32_t i, uint32_t count, float roughness) {
+        const float a = roughness * roughness;
+        const float phi = 2.0f * PI * (static_cast<float>(i) / static_cast<float>(count));
+        const float u = RadicalInverse(i);
+        const float cosTheta = std::sqrt((1.0f - u) / (1.0f + (a * a - 1.0f) * u));
+        const float sinTheta = std::sqrt(std::max(0.0f, 1.0f - cosTheta * cosTheta));
+        return glm::vec3(std::cos(phi) * sinTheta, std::sin(phi) * sinTheta, cosTheta);
+    }
+
+    float DistributionGGX(float NdotH, float roughness) {
+        const float a2 = roughness * roughness * roughness * roughness;
+        const float d = NdotH * NdotH * (a2 - 1.0f) + 1.0f;
+        return a2 / (PI * d * d);
+    }
+
+    // Solid angle of the cube face region [-1, x] x [-1, y] seen from the center
+    float AreaElement(float x, float y) {
+        return std::atan2(x * y, std::sqrt(x * x + y * y + 1.0f));
+    }
+}
+
+// ====================EquirectImage====================
+
+bool EquirectImage::Load(const std::string& path) {
+    stbi_set_flip_vertically_on_load(false);
+    int w, h, comp;
+    float* pixels = stbi_loadf(path.c_str(), &w, &h, &comp, 3);
+    if (!pixels) {
+        std::cerr << "[IBLBaker] Failed to load HDR: " << path << "\n";
+        return false;
+    }
+    this->width = w;
+    this->height = h;
+    this->rgb.assign(pixels, pixels + static_cast<size_t>(w) * h * 3);
+    stbi_image_free(pixels);
+    return true;
+}
+
+glm::vec3 EquirectImage::Sample(const glm::vec3& direction) const {
+    const glm::vec3 d = glm::normalize(direction);
+    const float u = std::atan2(d.z, d.x) / (2.0f * PI) + 0.5f;
+    const float v = 0.5f - std::asin(glm::clamp(d.y, -1.0f, 1.0f)) / PI;
+
+    return this->SampleTexel(u * this->width - 0.5f, v * this->height - 0.5f);
+}
+
+glm::vec3 EquirectImage::SampleTexel(float fx, float fy) const {
+    // Wrap around the seam horizontally, clamp at the poles
+    fy = glm::clamp(fy, 0.0f, static_cast<float>(this->height - 1));
+    const int x0 = static_cast<int>(std::floor(fx));
+    const int y0 = static_cast<int>(fy);
+    const float tx = fx - x0, ty = fy - y0;
+    const int xa = (x0 % this->width + this->width) % this->width;
+    const int xb = (xa + 1) % this->width;
+    const int ya = y0, yb = std::min(y0 + 1, this->height - 1);
+
+    auto texel = [&](int x, int y) {
+        const float* p = &this->rgb[(static_cast<size_t>(y) * this->width + x) * 3];
+        return glm::vec3(p[0], p[1], p[2]);
+    };
+    return glm::mix(glm::mix(texel(xa, ya), texel(xb, ya), tx),
+                    glm::mix(texel(xa, yb), texel(xb, yb), tx), ty);
+}
+
+// ====================CubeImage====================
+
+void CubeImage::Allocate(int size, int levelCount) {
+    const int fullChain = static_cast<int>(std::floor(std::log2(std::max(1, size)))) + 1;
+    this->size = size;
+    this->levels.assign(levelCount > 0 ? std::min(levelCount, fullChain) : fullChain, {});
+    for (int level = 0; level < this->GetLevelCount(); ++level) {
+        const int s = this->GetLevelSize(level);
+        for (auto& face : this->levels[level]) {
+            face.assign(static_cast<size_t>(s) * s * 3, 0.0f);
+        }
+    }
+}
+
+// GL cube map face selection (OpenGL spec, table 3.21) run backwards:
+// face texel (s, t) in [-1, 1] to the direction it is looked up with
+glm::vec3 CubeImage::TexelDirection(int face, int x, int y, int faceSize) {
+    const float u = 2.0f * (x + 0.5f) / faceSize - 1.0f;
+    const float v = 2.0f * (y + 0.5f) / faceSize - 1.0f;
+    glm::vec3 d;
+    switch (face) {
+        case 0:  d = glm::vec3( 1.0f,   -v,   -u); break;
+        case 1:  d = glm::vec3(-1.0f,   -v,    u); break;
+        case 2:  d = glm::vec3(    u, 1.0f,    v); break;
+        case 3:  d = glm::vec3(    u,-1.0f,   -v); break;
+        case 4:  d = glm::vec3(    u,   -v, 1.0f); break;
+        default: d = glm::vec3(   -u,   -v,-1.0f); break;
+    }
+    return glm::normalize(d);
+}
+
+float CubeImage::TexelSolidAngle(int x, int y, int faceSize) {
+    const float inv = 1.0f / static_cast<float>(faceSize);
+    const float x0 = 2.0f * x * inv - 1.0f, x1 = x0 + 2.0f * inv;
+    const float y0 = 2.0f * y * inv - 1.0f, y1 = y0 + 2.0f * inv;
+    return AreaElement(x0, y0) - AreaElement(x0, y1) - AreaElement(x1, y0) + AreaElement(x1, y1);
+}
+
+glm::vec3 CubeImage::Sample(const glm::vec3& direction, float lod) const {
+    // Major axis picks the face, the other two give (s, t)
+    const glm::vec3 a = glm::abs(direction);
+    int face;
+    float sc, tc, ma;
+    if (a.x >= a.y && a.x >= a.z) {
+        face = direction.x > 0.0f ? 0 : 1;
+        sc = direction.x > 0.0f ? -direction.z : direction.z;
+        tc = -direction.y;
+        ma = a.x;
+    } else if (a.y >= a.z) {
+        face = direction.y > 0.0f ? 2 : 3;
+        sc = direction.x;
+        tc = direction.y > 0.0f ? direction.z : -direction.z;
+        ma = a.y;
+    } else {
+        face = direction.z > 0.0f ? 4 : 5;
+        sc = direction.z > 0.0f ? direction.x : -direction.x;
+        tc = -direction.y;
+        ma = a.z;
+    }
+    const float s = 0.5f * (sc / ma + 1.0f);
+    const float t = 0.5f * (tc / ma + 1.0f);
+
+    auto bilinear = [&](int level) {
+        const int n = this->GetLevelSize(level);
+        const std::vector<float>& texels = this->levels[level][face];
+        const float fx = glm::clamp(s * n - 0.5f, 0.0f, static_cast<float>(n - 1));
+        const float fy = glm::clamp(t * n - 0.5f, 0.0f, static_cast<float>(n - 1));
+        const int x0 = static_cast<int>(fx), y0 = static_cast<int>(fy);
+        const int x1 = std::min(x0 + 1, n - 1), y1 = std::min(y0 + 1, n - 1);
+        const float tx = fx - x0, ty = fy - y0;
+        auto texel = [&](int x, int y) {
+            const float* p = &texels[(static_cast<size_t>(y) * n + x) * 3];
+            return glm::vec3(p[0], p[1], p[2]);
+        };
+        return glm::mix(glm::mix(texel(x0, y0), texel(x1, y0), tx),
+                        glm::mix(texel(x0, y1), texel(x1, y1), tx), ty);
+    };
+
+    lod = glm::clamp(lod, 0.0f, static_cast<float>(this->GetLevelCount() - 1));
+    const int level = static_cast<int>(lod);
+    const float blend = lod - level;
+    if (blend <= 0.0f || level + 1 >= this->GetLevelCount()) {
+        return bilinear(level);
+    }
+    return glm::mix(bilinear(level), bilinear(level + 1), blend);
+}
+
+void CubeImage::GenerateMipmaps() {
+    for (int level = 1; level < this->GetLevelCount(); ++level) {
+        const int n = this->GetLevelSize(level);
+        const int src = this->GetLevelSize(level - 1);
+        ThreadPool::Get().ParallelFor(6, [&](size_t face) {
+            const std::vector<float>& in = this->levels[level - 1][face];
+            std::vector<float>& out = this->levels[level][face];
+            for (int y = 0; y < n; ++y) {
+                for (int x = 0; x < n; ++x) {
+                    for (int c = 0; c < 3; ++c) {
+                        const size_t row0 = static_cast<size_t>(2 * y) * src, row1 = row0 + src;
+                        out[(static_cast<size_t>(y) * n + x) * 3 + c] = 0.25f *
+                            (in[(row0 + 2 * x) * 3 + c] + in[(row0 + 2 * x + 1) * 3 + c] +
+                             in[(row1 + 2 * x) * 3 + c] + in[(row1 + 2 * x + 1) * 3 + c]);
+                    }
+                }
+            }
+        });
+    }
+}
+
+bool CubeImage::LoadKTX(const std::string& path) {
+    gli::texture texture = gli::load(path);
+    if (texture.empty() || texture.faces() != 6) {
+        std::cerr << "[IBLBaker] Not a cubemap KTX: " << path << "\n";
+        return false;
+    }
+    gli::gl translator(gli::gl::PROFILE_GL33);
+    const GLenum internalFormat = static_cast<GLenum>(translator.translate(texture.format(), texture.swizzles()).Internal);
+    HDRFormatInfo info;
+    if (gli::is_compressed(texture.format()) || !GetHDRFormatInfo(internalFormat, info) || info.channels < 3) {
+        std::cerr << "[IBLBaker] Unsupported KTX format (float RGB/RGBA only): " << path << "\n";
+        return false;
+    }
+
+    this->Allocate(texture.extent(0).x, static_cast<int>(texture.levels()));
+    for (int level = 0; level < this->GetLevelCount(); ++level) {
+        const size_t texels = static_cast<size_t>(this->GetLevelSize(level)) * this->GetLevelSize(level);
+        for (int face = 0; face < 6; ++face) {
+            const std::vector<float> src = UnpackHDRPixels(texture.data(0, face, level), texels, internalFormat);
+            float* dst = this->levels[level][face].data();
+            for (size_t i = 0; i < texels; ++i) {
+                dst[i * 3 + 0] = src[i * info.channels + 0];
+                dst[i * 3 + 1] = src[i * info.channels + 1];
+                dst[i * 3 + 2] = src[i * info.channels + 2];
+            }
+        }
+    }
+    return true;
+}
+
+// ====================IBLBaker====================
+
+IBLBaker::IBLBaker(const IBLBakeSettings& settings): settings(settings) {
+
+}
+
+// Texel directions of a face row are linear in u, 4 texels at a time get their
+// equirect coordinates from two SIMD atan2 (longitude, latitude), the bilinear
+// fetch itself is a scalar gather
+void IBLBaker::EquirectToCube(const EquirectImage& equirect, CubeImage& cube) {
+    const int n = cube.size;
+    const F4 scaleU = Set1(equirect.width / (2.0f * PI));
+    const F4 offsetU = Set1(0.5f * equirect.width - 0.5f);
+    const F4 scaleV = Set1(-equirect.height / PI);
+    const F4 offsetV = Set1(0.5f * equirect.height - 0.5f);
+    const F4 one = Set1(1.0f), minusOne = Set1(-1.0f);
+
+    ThreadPool::Get().ParallelFor(6 * static_cast<size_t>(n), [&](size_t job) {
+        const int face = static_cast<int>(job / n);
+        const int y = static_cast<int>(job % n);
+        float* row = &cube.levels[0][face][static_cast<size_t>(y) * n * 3];
+        const float v = 2.0f * (y + 0.5f) / n - 1.0f;
+        const F4 v4 = Set1(v), minusV = Set1(-v);
+
+        for (int x = 0; x < n; x += 4) {
+            float lanes[4];
+            for (int i = 0; i < 4; ++i) lanes[i] = 2.0f * (x + i + 0.5f) / n - 1.0f;
+            const F4 u = Load(lanes), minusU = Sub(Set1(0.0f), u);
+            // Same face table as CubeImage::TexelDirection, unnormalized
+            F4 dx, dy, dz;
+            switch (face) {
+                case 0:  dx = one;      dy = minusV; dz = minusU;   break;
+                case 1:  dx = minusOne; dy = minusV; dz = u;        break;
+                case 2:  dx = u;        dy = one;    dz = v4;       break;
+                case 3:  dx = u;        dy = minusOne; dz = minusV; break;
+                case 4:  dx = u;        dy = minusV; dz = one;      break;
+                default: dx = minusU;   dy = minusV; dz = minusOne; break;
+            }
+            const F4 longitude = Atan2(dz, dx);
+            const F4 latitude = Atan2(dy, Sqrt(Add(Mul(dx, dx), Mul(dz, dz))));
+            float fx[4], fy[4];
+            Store(fx, Add(Mul(longitude, scaleU), offsetU));
+            Store(fy, Add(Mul(latitude, scaleV), offsetV));
+
+            for (int i = 0; i < 4 && x + i < n; ++i) {
+                const glm::vec3 c = equirect.SampleTexel(fx[i], fy[i]);
+                row[(x + i) * 3 + 0] = c.r;
+                row[(x + i) * 3 + 1] = c.g;
+                row[(x + i) * 3 + 2] = c.b;
+            }
+        }
+    });
+}
+
+bool IBLBaker::LoadEquirect(const std::string& path) {
+    auto start = std::chrono::high_resolution_clock::now();
+    EquirectImage equirect;
+    if (!equirect.Load(path)) return false;
+    this->stats.loadMs = MsSince(start);
+
+    start = std::chrono::high_resolution_clock::now();
+    this->environment.Allocate(static_cast<int>(this->settings.envSize), 0);
+    EquirectToCube(equirect, this->environment);
+    this->environment.GenerateMipmaps();
+    this->stats.cubeMs = MsSince(start);
+    return true;
+}
+
+// E(N) / pi = 1/pi * sum over the source texels of L * max(N.L, 0) * solid angle.
+// The source is small, so the sum is exact for it and has no sampling noise.
+CubeImage IBLBaker::BakeIrradiance() {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    int sourceLevel = 0;
+    while (sourceLevel + 1 < this->environment.GetLevelCount() &&
+           this->environment.GetLevelSize(sourceLevel) > static_cast<int>(IBL_IRRADIANCE_SOURCE_SIZE)) {
+        ++sourceLevel;
+    }
+    const int sourceSize = this->environment.GetLevelSize(sourceLevel);
+
+    // Source texels as structure of arrays, radiance premultiplied by solid angle.
+    // Padding lanes have zero weight.
+    const size_t count = 6 * static_cast<size_t>(sourceSize) * sourceSize;
+    const size_t padded = (count + 3) & ~static_cast<size_t>(3);
+    std::vector<float> dirX(padded, 0.0f), dirY(padded, 0.0f), dirZ(padded, 0.0f);
+    std::vector<float> weightR(padded, 0.0f), weightG(padded, 0.0f), weightB(padded, 0.0f);
+    size_t k = 0;
+    for (int face = 0; face < 6; ++face) {
+        const std::vector<float>& texels = this->environment.levels[sourceLevel][face];
+        for (int y = 0; y < sourceSize; ++y) {
+            for (int x = 0; x < sourceSize; ++x, ++k) {
+                const glm::vec3 d = CubeImage::TexelDirection(face, x, y, sourceSize);
+                const float solidAngle = CubeImage::TexelSolidAngle(x, y, sourceSize) / PI;
+                const float* c = &texels[(static_cast<size_t>(y) * sourceSize + x) * 3];
+                dirX[k] = d.x; dirY[k] = d.y; dirZ[k] = d.z;
+                weightR[k] = c[0] * solidAngle;
+                weightG[k] = c[1] * solidAngle;
+                weightB[k] = c[2] * solidAngle;
+            }
+        }
+    }
+
+    CubeImage irradiance;
+    irradiance.Allocate(static_cast<int>(this->settings.irradianceSize), 1);
+    const int n = irradiance.size;
+    ThreadPool::Get().ParallelFor(6 * static_cast<size_t>(n), [&](size_t job) {
+        const int face = static_cast<int>(job / n);
+        const int y = static_cast<int>(job % n);
+        float* row = &irradiance.levels[0][face][static_cast<size_t>(y) * n * 3];
+        for (int x = 0; x < n; ++x) {
+            const glm::vec3 normal = CubeImage::TexelDirection(face, x, y, n);
+            const F4 nx = Set1(normal.x), ny = Set1(normal.y), nz = Set1(normal.z);
+            const F4 zero = Set1(0.0f);
+            F4 r = zero, g = zero, b = zero;
+            for (size_t i = 0; i < padded; i += 4) {
+                F4 cosine = Add(Add(Mul(nx, Load(&dirX[i])), Mul(ny, Load(&dirY[i]))), Mul(nz, Load(&dirZ[i])));
+                cosine = Max(cosine, zero);
+                r = Add(r, Mul(cosine, Load(&weightR[i])));
+                g = Add(g, Mul(cosine, Load(&weightG[i])));
+                b = Add(b, Mul(cosine, Load(&weightB[i])));
+            }
+            row[x * 3 + 0] = Sum(r);
+            row[x * 3 + 1] = Sum(g);
+            row[x * 3 + 2] = Sum(b);
+        }
+    });
+
+    this->stats.irradianceMs = MsSince(start);
+    return irradiance;
+}
+
+// Split sum prefilter (Karis 2013) with N = V = R. Each sample reads the environment
+// mip whose texel covers the sample's solid angle (GPU Gems 3, ch. 20), so a few
+// hundred samples give a smooth result without fireflies from bright spots.
+CubeImage IBLBaker::BakePrefilter() {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    CubeImage prefilter;
+    prefilter.Allocate(static_cast<int>(this->settings.prefilterSize), 0);
+    const int levelCount = prefilter.GetLevelCount();
+    const uint32_t sampleCount = std::max(1u, this->settings.prefilterSamples);
+    const float envSize = static_cast<float>(this->environment.size);
+    const float texelSolidAngle = 4.0f * PI / (6.0f * envSize * envSize);
+
+    // Tangent space light directions of one roughness level, weight is N.L
+    struct Sample { glm::vec3 light; float weight; float lod; };
+    std::vector<Sample> samples;
+
+    for (int level = 0; level < levelCount; ++level) {
+        const int n = prefilter.GetLevelSize(level);
+        const float roughness = levelCount > 1 ? static_cast<float>(level) / (levelCount - 1) : 0.0f;
+
+        samples.clear();
+        if (level == 0) {
+            // Mirror reflection: the environment filtered down to this size
+            samples.push_back({ glm::vec3(0.0f, 0.0f, 1.0f), 1.0f, std::log2(envSize / n) });
+        } else {
+            for (uint32_t i = 0; i < sampleCount; ++i) {
+                const glm::vec3 h = ImportanceSampleGGX(i, sampleCount, roughness);
+                const glm::vec3 l = 2.0f * h.z * h - glm::vec3(0.0f, 0.0f, 1.0f);
+                if (l.z <= 0.0f) continue;
+                // pdf of l is D * NdotH / (4 * VdotH) = D / 4 with N = V
+                const float pdf = DistributionGGX(h.z, roughness) * 0.25f;
+                const float sampleSolidAngle = 1.0f / (sampleCount * pdf + 1e-4f);
+                samples.push_back({ l, l.z, std::max(0.0f, 0.5f * std::log2(sampleSolidAngle / texelSolidAngle)) });
+            }
+        }
+
+        ThreadPool::Get().ParallelFor(6 * static_cast<size_t>(n), [&](size_t job) {
+            const int face = static_cast<int>(job / n);
+            const int y = static_cast<int>(job % n);
+            float* row = &prefilter.levels[level][face][static_cast<size_t>(y) * n * 3];
+            for (int x = 0; x < n; ++x) {
+                const glm::vec3 normal = CubeImage::TexelDirection(face, x, y, n);
+                const glm::vec3 up = std::abs(normal.z) < 0.999f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+                const glm::vec3 tangent = glm::normalize(glm::cross(up, normal));
+                const glm::vec3 bitangent = glm::cross(normal, tangent);
+
+                glm::vec3 color(0.0f);
+                float totalWeight = 0.0f;
+                for (const Sample& s : samples) {
+                    const glm::vec3 l = tangent * s.light.x + bitangent * s.light.y + normal * s.light.z;
+                    color += this->environment.Sample(l, s.lod) * s.weight;
+                    totalWeight += s.weight;
+                }
+                color /= totalWeight;
+                row[x * 3 + 0] = color.r;
+                row[x * 3 + 1] = color.g;
+                row[x * 3 + 2] = color.b;
+            }
+        });
+    }
+
+    this->stats.prefilterMs = MsSince(start);
+    return prefilter;
+}
+
+// Scale (x) and bias (y) to F0 of the split sum specular term, u = NdotV, v = roughness.
+// Geometry term uses k = roughness^2 / 2 as for IBL.
+std::vector<float> IBLBaker::BakeBRDFLUT() {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    const int n = static_cast<int>(this->settings.brdfLUTSize);
+    const uint32_t sampleCount = (std::max(4u, this->settings.brdfLUTSamples) + 3u) & ~3u;
+    std::vector<float> lut(static_cast<size_t>(n) * n * 2, 0.0f);
+
+    ThreadPool::Get().ParallelFor(static_cast<size_t>(n), [&](size_t y) {
+        const float roughness = (y + 0.5f) / n;
+        const float k = roughness * roughness * 0.5f;
+
+        // Half vectors only depend on roughness, shared by the whole row
+        std::vector<float> hx(sampleCount), hz(sampleCount);
+        for (uint32_t i = 0; i < sampleCount; ++i) {
+            const glm::vec3 h = ImportanceSampleGGX(i, sampleCount, roughness);
+            hx[i] = h.x;    // V lies in the XZ plane, H.y never enters a dot product
+            hz[i] = h.z;
+        }
+
+        const F4 zero = Set1(0.0f), one = Set1(1.0f), two = Set1(2.0f);
+        const F4 k4 = Set1(k), oneMinusK = Set1(1.0f - k);
+        for (int x = 0; x < n; ++x) {
+            const float NdotV = (x + 0.5f) / n;
+            const float gV = NdotV / (NdotV * (1.0f - k) + k);
+            const F4 vx = Set1(std::sqrt(1.0f - NdotV * NdotV)), vz = Set1(NdotV);
+            // G * VdotH / (NdotH * NdotV), the NdotV and G(V) parts are constant per texel
+            const F4 visScale = Set1(gV / NdotV);
+
+            F4 scale = zero, bias = zero;
+            for (uint32_t i = 0; i < sampleCount; i += 4) {
+                const F4 h_x = Load(&hx[i]), h_z = Load(&hz[i]);
+                const F4 VdotH = Max(Add(Mul(vx, h_x), Mul(vz, h_z)), zero);
+                const F4 NdotL = Max(Sub(Mul(Mul(two, VdotH), h_z), vz), zero);
+                const F4 gL = Div(NdotL, Add(Mul(NdotL, oneMinusK), k4));
+                const F4 vis = Div(Mul(Mul(gL, VdotH), visScale), h_z);
+                const F4 f = Sub(one, VdotH);
+                const F4 f2 = Mul(f, f);
+                const F4 fc = Mul(Mul(f2, f2), f);
+                scale = Add(scale, Mul(Sub(one, fc), vis));
+                bias = Add(bias, Mul(fc, vis));
+            }
+            float* texel = &lut[(y * n + x) * 2];
+            texel[0] = Sum(scale) / sampleCount;
+            texel[1] = Sum(bias) / sampleCount;
+        }
+    });
+
+    this->stats.brdfLUTMs = MsSince(start);
+    return lut;
+}
+
+bool IBLBaker::SaveCubeKTX(const CubeImage& cube, const std::string& path, GLenum internalFormat) {
+    const gli::format format = ToGliFormat(internalFormat);
+    if (format == gli::FORMAT_UNDEFINED || internalFormat == GL_RG32F || internalFormat == GL_RG16F) {
+        std::cerr << "[IBLBaker] Unsupported cubemap format " << GetHDRFormatName(internalFormat) << "\n";
+        return false;
+    }
+    gli::texture_cube texture(format,
+                              gli::texture_cube::extent_type(cube.size, cube.size),
+                              static_cast<size_t>(cube.GetLevelCount()));
+    for (int level = 0; level < cube.GetLevelCount(); ++level) {
+        for (int face = 0; face < 6; ++face) {
+            const std::vector<float>& texels = cube.levels[level][face];
+            const std::vector<unsigned char> pixels = PackHDRPixels(texels.data(), 3, texels.size() / 3, internalFormat);
+            std::memcpy(texture[face][level].data(), pixels.data(), pixels.size());
+        }
+    }
+    if (!gli::save_ktx(texture, path)) {
+        std::cerr << "[IBLBaker] Failed to write " << path << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool IBLBaker::SaveBRDFLUTKTX(const std::vector<float>& lut, unsigned size, const std::string& path, GLenum internalFormat) {
+    if (internalFormat != GL_RG32F && internalFormat != GL_RG16F) {
+        std::cerr << "[IBLBaker] Unsupported BRDF LUT format " << GetHDRFormatName(internalFormat) << "\n";
+        return false;
+    }
+    gli::texture2d texture(ToGliFormat(internalFormat), gli::texture2d::extent_type(size, size), 1);
+    const std::vector<unsigned char> pixels = PackHDRPixels(lut.data(), 2, lut.size() / 2, internalFormat);
+    std::memcpy(texture[0].data(), pixels.data(), pixels.size());
+    if (!gli::save_ktx(texture, path)) {
+        std::cerr << "[IBLBaker] Failed to write " << path << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool IBLBaker::Bake(const std::string& hdrPath, const std::string& outDir, bool writeBRDFLUT) {
+    if (!this->LoadEquirect(hdrPath)) return false;
+    const CubeImage irradiance = this->BakeIrradiance();
+    const CubeImage prefilter = this->BakePrefilter();
+    std::vector<float> lut;
+    if (writeBRDFLUT) {
+        lut = this->BakeBRDFLUT();
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    std::error_code ec;
+    fs::create_directories(outDir, ec);
+    const fs::path dir(outDir);
+    bool ok = SaveCubeKTX(irradiance, (dir / "irradiance.ktx").string(), this->settings.irradianceFormat) &&
+              SaveCubeKTX(prefilter, (dir / "prefilter.ktx").string(), this->settings.prefilterFormat);
+    if (ok && writeBRDFLUT) {
+        ok = SaveBRDFLUTKTX(lut, this->settings.brdfLUTSize, (dir / "brdfLUT.ktx").string(), this->settings.brdfLUTFormat);
+    }
+    this->stats.writeMs = MsSince(start);
+    return ok;
+}
+
+void IBLBaker::PrintStats() const {
+    std::cout << "[IBLBaker] load " << this->stats.loadMs << " ms, cube " << this->stats.cubeMs
+              << " ms, irradiance " << this->stats.irradianceMs << " ms, prefilter " << this->stats.prefilterMs
+              << " ms, brdfLUT " << this->stats.brdfLUTMs << " ms, write " << this->stats.writeMs
+              << " ms (" << ThreadPool::Get().GetThreadCount() << " threads)\n";
+}
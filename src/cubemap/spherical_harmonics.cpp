@@ -0,0 +1,103 @@
+#include "cubemap/spherical_harmonics.h"
+#include "thread_pool.h"
+#include <cmath>
+#include <vector>
+
+std::array<float, 9> SH9::Basis(const glm::vec3& n) {
+    return {
+        0.282095f,
+        0.488603f * n.y,
+        0.488603f * n.z,
+        0.488603f * n.x,
+        1.092548f * n.x * n.y,
+        1.092548f * n.y * n.z,
+        0.315392f * (3.0f * n.z * n.z - 1.0f),
+        1.092548f * n.x * n.z,
+        0.546274f * (n.x * n.x - n.y * n.y)
+    };
+}
+
+glm::vec3 SH9::Evaluate(const glm::vec3& n) const {
+    const std::array<float, 9> basis = Basis(n);
+    glm::vec3 result(0.0f);
+    for (int i = 0; i < 9; ++i) {
+        result += this->coefficients[i] * basis[i];
+    }
+    return result;
+}
+
+SH9 SH9::ConvolveCosine() const {
+    static const float band[9] = { 1.0f, 2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f,
+                                   0.25f, 0.25f, 0.25f, 0.25f, 0.25f };
+    SH9 result;
+    for (int i = 0; i < 9; ++i) {
+        result.coefficients[i] = this->coefficients[i] * band[i];
+    }
+    return result;
+}
+
+SH9 SH9::Project(const CubeImage& cube, int level) {
+    const int n = cube.GetLevelSize(level);
+    std::vector<SH9> partials(6 * static_cast<size_t>(n));
+    ThreadPool::Get().ParallelFor(partials.size(), [&](size_t job) {
+        const int face = static_cast<int>(job / n);
+        const int y = static_cast<int>(job % n);
+        const float* row = &cube.levels[level][face][static_cast<size_t>(y) * n * 3];
+        SH9& sum = partials[job];
+        for (int x = 0; x < n; ++x) {
+            const float weight = CubeImage::TexelSolidAngle(x, y, n);
+            const glm::vec3 color = glm::vec3(row[x * 3], row[x * 3 + 1], row[x * 3 + 2]) * weight;
+            const std::array<float, 9> basis = Basis(CubeImage::TexelDirection(face, x, y, n));
+            for (int i = 0; i < 9; ++i) {
+                sum.coefficients[i] += color * basis[i];
+            }
+        }
+    });
+
+    SH9 result;
+    for (const SH9& partial : partials) {
+        for (int i = 0; i < 9; ++i) {
+            result.coefficients[i] += partial.coefficients[i];
+        }
+    }
+    return result;
+}
+
+// Texel (x, y) covers longitude (u - 0.5) * 2pi and latitude (0.5 - v) * pi
+// (the mapping of shader/equi.frag), its solid angle shrinks with cos(latitude)
+SH9 SH9::Project(const EquirectImage& equirect) {
+    const int w = equirect.width, h = equirect.height;
+    std::vector<SH9> partials(static_cast<size_t>(h));
+    ThreadPool::Get().ParallelFor(partials.size(), [&](size_t y) {
+        const float latitude = (0.5f - (y + 0.5f) / h) * PI;
+        const float weight = std::cos(latitude) * (2.0f * PI / w) * (PI / h);
+        const float* row = &equirect.rgb[y * w * 3];
+        SH9& sum = partials[y];
+        for (int x = 0; x < w; ++x) {
+            const float longitude = ((x + 0.5f) / w - 0.5f) * 2.0f * PI;
+            const glm::vec3 direction(std::cos(longitude) * std::cos(latitude), std::sin(latitude),
+                                      std::sin(longitude) * std::cos(latitude));
+            const glm::vec3 color = glm::vec3(row[x * 3], row[x * 3 + 1], row[x * 3 + 2]) * weight;
+            const std::array<float, 9> basis = Basis(direction);
+            for (int i = 0; i < 9; ++i) {
+                sum.coefficients[i] += color * basis[i];
+            }
+        }
+    });
+
+    SH9 result;
+    for (const SH9& partial : partials) {
+        for (int i = 0; i < 9; ++i) {
+            result.coefficients[i] += partial.coefficients[i];
+        }
+    }
+    return result;
+}
+
+glm::mat3 SH9::GetChannelMatrix(int channel) const {
+    glm::mat3 m(0.0f);
+    for (int i = 0; i < 9; ++i) {
+        m[i / 3][i % 3] = this->coefficients[i][channel];
+    }
+    return m;
+}
@@ -2,26 +2,49 @@
 #include "shader.h"
 #include "config.h"
 #include "cubemap/cubemap.h"
+#include "cubemap/ibl_baker.h"
+#include "texture/hdr_format.h"
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
 
+// Read mip 0 of a GL cubemap back into a CubeImage
+static bool ReadBackCubemap(GLuint texture, CubeImage& cube) {
+    GLint size = 0;
+    glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+    glGetTexLevelParameteriv(GL_TEXTURE_CUBE_MAP_POSITIVE_X, 0, GL_TEXTURE_WIDTH, &size);
+    if (size <= 0) {
+        glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+        return false;
+    }
+    cube.Allocate(size, 1);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    for (int face = 0; face < 6; ++face) {
+        glGetTexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GL_RGB, GL_FLOAT, cube.levels[0][face].data());
+    }
+    glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+    return true;
+}
  
+// The irradiance cubemap is only read back once to get its SH9
 Environment::Environment(
     const std::shared_ptr<Cubemap>& irradiance, 
     const std::shared_ptr<Cubemap>& prefilter, 
     const std::shared_ptr<Texture2D>& brdflut): 
-        irradiance(irradiance),
         prefilter(prefilter),
         brdflut(brdflut) {
+    CubeImage cube;
+    if (irradiance && ReadBackCubemap(irradiance->GetTexture(), cube)) {
+        this->irradianceSH = SH9::Project(cube);
+    }
 }
 
-Environment::Environment(): irradiance(nullptr), prefilter(nullptr), brdflut(nullptr) {
+Environment::Environment(): prefilter(nullptr), brdflut(nullptr) {
 
 }
 
 Environment::~Environment() {
     // Unbind all textures
-    if (this->irradiance) {
-        this->irradiance->Unbind();  
-    }
     if (this->prefilter) {
         this->prefilter->Unbind();  
     }
@@ -30,30 +53,60 @@ Environment::~Environment() {
     }
 }
 
-// Load irradiance map from ktx file
+// Load irradiance map from ktx file, it is already convolved so the projection is all that is needed
 void Environment::LoadIrradianceMap(const std::string& irradiancePath, unsigned int size) {
-    this->irradiance = std::make_shared<Cubemap>(size, 0); // irradiance map only have mip0
-    this->irradiance->LoadKTXToCubemap(irradiancePath);
+    CubeImage cube;
+    if (!cube.LoadKTX(irradiancePath)) {
+        return;
+    }
+    if (cube.size != static_cast<int>(size)) {
+        std::cerr << "[Environment] " << irradiancePath << " is " << cube.size << "x" << cube.size
+                  << ", expected " << size << "\n";
+    }
+    this->irradianceSH = SH9::Project(cube);
+    std::cout << "[Environment] Irradiance SH9 from " << irradiancePath << "\n";
+}
+
+// Project the environment radiance and convolve it with the cosine lobe
+bool Environment::ComputeIrradianceSH(const std::string& environmentPath) {
+    std::string extension = std::filesystem::path(environmentPath).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+    SH9 radiance;
+    if (extension == ".ktx") {
+        CubeImage cube;
+        if (!cube.LoadKTX(environmentPath)) return false;
+        radiance = SH9::Project(cube);
+    } else {
+        EquirectImage equirect;
+        if (!equirect.Load(environmentPath)) return false;
+        radiance = SH9::Project(equirect);
+    }
+    this->irradianceSH = radiance.ConvolveCosine();
+    std::cout << "[Environment] Irradiance SH9 from " << environmentPath << "\n";
+    return true;
 }
 
 // Load prefilter map from ktx file
 void Environment::LoadPrefilterMap(const std::string& prefilterPath, unsigned int size, unsigned int mipLevels) {
-    this->prefilter = std::make_shared<Cubemap>(size, mipLevels);
+    this->prefilter = std::make_shared<Cubemap>(size, mipLevels, PREFILTER_FORMAT);
     this->prefilter->LoadKTXToCubemap(prefilterPath);
 }
 
 // Load BRDF LUT from ktx file
 void Environment::LoadBRDFLut(const std::string& brdflutPath, unsigned int size) {
     this->brdflut = std::make_shared<Texture2D>(size, size, GL_RGB32F, GL_RGB, GL_FLOAT);
-    this->brdflut->LoadKTXToTexture(brdflutPath);
+    this->brdflut->LoadKTXToTexture(brdflutPath, BRDF_LUT_FORMAT);
 }
 
 void Environment::UploadToShader(const std::shared_ptr<Shader>& shader) {
     shader->Use();
 
-    // Bind irradiance texture
-    shader->SetUniform("irradianceMap", IRRADIANCE_TEXTURE_UNIT);
-    this->irradiance->Bind(IRRADIANCE_TEXTURE_UNIT);
+    // Irradiance SH9, one coefficient matrix per color channel
+    shader->SetUniform("irradianceSHR", this->irradianceSH.GetChannelMatrix(0));
+    shader->SetUniform("irradianceSHG", this->irradianceSH.GetChannelMatrix(1));
+    shader->SetUniform("irradianceSHB", this->irradianceSH.GetChannelMatrix(2));
 
     // Bind prefilter texture
     shader->SetUniform("prefilterMap", PREFILTER_TEXTURE_UNIT);
@@ -1,8 +1,12 @@
 #include "geometry.h"
 #include <vector>
+#include <algorithm>
 #include <iostream>
 #include <cmath>
+#include <utility>
 #include "config.h"
+#include "bounding_box/mesh_bvh.h"
+#include "vertex_format.h"
 
 Geometry::Geometry() {
 
@@ -114,6 +118,11 @@ void ScreenQuad::SetupBuffers() {
 }
 
 //===============Mesh======================
+bool Mesh::optimizeOnUpload = true;
+bool Mesh::compactVertices = COMPACT_VERTICES;
+// Picking needs positions and indices only, the other 44 bytes per vertex live on the GPU
+MeshResidency Mesh::defaultResidency = MeshResidency::PositionsOnly;
+
 Mesh::Mesh():  
     VAO(0), 
     VBO(0), 
@@ -135,6 +144,7 @@ void Mesh::Init() {
         this->GenerateVertices();   //< Must be implemented in derived class
     if (this->indices.empty())
         this->GenerateIndices();    //< Must be implemented in derived class
+    this->bvh.reset();
     this->SetupBuffers();           //< Create and bind OpenGL buffers
     
     this->initialized = true;
@@ -142,24 +152,194 @@ void Mesh::Init() {
 
 // API for model loader to bypass tangent/bitangent calculation
 void Mesh::LoadFromModel(std::vector<Vertex> vertices, std::vector<unsigned int> indices) {
-    this->vertices = vertices;
-    this->indices = indices;
+    this->vertices = std::move(vertices);
+    this->indices = std::move(indices);
+    this->optimized = false;
+    this->ReleaseExternal();
     this->SetupBuffers();
 }
 
+const MeshOptimizeStats& Mesh::Optimize() {
+    if (!this->optimized && !this->externalVertices) {
+        this->optimizeStats = OptimizeMesh(this->vertices, this->indices);
+        this->optimized = true;
+        this->bvh.reset();
+    }
+    return this->optimizeStats;
+}
+
+const MeshBVH& Mesh::GetBVH() const {
+    if (!this->bvh) {
+        this->bvh = std::make_shared<MeshBVH>();
+        if (this->GetVertexCount() > 0) {
+            this->bvh->Build(this->GetVertexData(), this->GetVertexCount(), this->GetIndexData(), this->GetIndexCount());
+        } else if (!this->positions.empty()) {
+            this->bvh->Build(this->positions.data(), this->positions.size(), this->GetIndexData(), this->GetIndexCount());
+        }
+    }
+    return *this->bvh;
+}
+
+bool Mesh::CanPickTriangles() const {
+    if (this->bvh) return !this->bvh->IsEmpty();
+    return this->GetIndexCount() > 0 && (this->GetVertexCount() > 0 || !this->positions.empty());
+}
+
+size_t Mesh::GetBVHBytes() const {
+    return this->bvh ? this->bvh->GetMemoryBytes() : 0;
+}
+
+void Mesh::SetResidency(MeshResidency residency) {
+    this->residency = residency;
+    if (this->gpuBytes) this->ApplyResidency();   // already uploaded
+}
+
+// Free what the residency policy does not keep. Mapped MeshCache data is clean
+// page cache the OS can evict on its own, PositionsOnly leaves it mapped.
+void Mesh::ApplyResidency() {
+    switch (this->residency) {
+        case MeshResidency::Keep:
+            break;
+        case MeshResidency::PositionsOnly:
+            if (!this->vertices.empty()) {
+                this->positions.resize(this->vertices.size());
+                for (size_t i = 0; i < this->vertices.size(); ++i) this->positions[i] = this->vertices[i].position;
+                std::vector<Vertex>().swap(this->vertices);
+            }
+            break;
+        case MeshResidency::Drop:
+            std::vector<Vertex>().swap(this->vertices);
+            std::vector<unsigned int>().swap(this->indices);
+            std::vector<glm::vec3>().swap(this->positions);
+            this->externalOwner.reset();
+            this->externalVertices = nullptr;
+            this->externalIndices = nullptr;
+            this->externalVertexCount = 0;
+            this->externalIndexCount = 0;
+            break;
+    }
+}
+
+// Drops the external data, the CPU arrays are used from now on
+void Mesh::ReleaseExternal() {
+    this->externalOwner.reset();
+    this->externalVertices = nullptr;
+    this->externalIndices = nullptr;
+    this->externalVertexCount = 0;
+    this->externalIndexCount = 0;
+    this->positions.clear();
+    this->bvh.reset();
+}
+
 // Initialize VAO, VBO and EBO, enable location in shader
 void Mesh::SetupBuffers() {
+    if (Mesh::optimizeOnUpload) this->Optimize();
+    this->UploadBuffers(this->vertices.data(), this->vertices.size(), this->indices.data(), this->indices.size());
+    this->ApplyResidency();
+}
+
+void Mesh::SetupBuffersExternal(std::shared_ptr<const void> owner,
+                                const Vertex* vertices, size_t vertexCount,
+                                const unsigned int* indices, size_t indexCount,
+                                const MeshGPUArrays* gpuArrays) {
+    this->vertices.clear();
+    this->indices.clear();
+    this->ReleaseExternal();
+    this->externalOwner = std::move(owner);
+    this->externalVertices = vertices;
+    this->externalIndices = indices;
+    this->externalVertexCount = vertexCount;
+    this->externalIndexCount = indexCount;
+    this->UploadBuffers(vertices, vertexCount, indices, indexCount, gpuArrays);
+    this->ApplyResidency();
+}
+
+void Mesh::UploadBuffers(const Vertex* vertices, size_t vertexCount, const unsigned int* indices, size_t indexCount,
+                         const MeshGPUArrays* gpuArrays) {
     glGenVertexArrays(1, &this->VAO);
     glGenBuffers(1, &this->VBO);
     glGenBuffers(1, &this->EBO);
 
     glBindVertexArray(this->VAO);
 
+    // Bounds for AABB and culling, they outlive the CPU arrays
+    this->hasBounds = vertexCount > 0;
+    if (gpuArrays) {
+        this->boundsMin = gpuArrays->boundsMin;
+        this->boundsMax = gpuArrays->boundsMax;
+    } else {
+        this->boundsMin = this->boundsMax = vertexCount > 0 ? vertices[0].position : glm::vec3(0.0f);
+        for (size_t i = 1; i < vertexCount; ++i) {
+            this->boundsMin = glm::min(this->boundsMin, vertices[i].position);
+            this->boundsMax = glm::max(this->boundsMax, vertices[i].position);
+        }
+    }
+    this->drawIndexCount = indexCount;
+
     glBindBuffer(GL_ARRAY_BUFFER, this->VBO);
-    glBufferData(GL_ARRAY_BUFFER, this->vertices.size() * sizeof(Vertex), this->vertices.data(), GL_STATIC_DRAW);
+    this->compact = Mesh::compactVertices;
+    if (this->compact && gpuArrays && gpuArrays->compactVertices) {
+        glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(CompactVertex), gpuArrays->compactVertices, GL_STATIC_DRAW);
+        this->dequantScale = gpuArrays->dequantScale;
+        this->dequantOffset = gpuArrays->dequantOffset;
+        this->gpuBytes = vertexCount * sizeof(CompactVertex);
+    } else if (this->compact) {
+        std::vector<CompactVertex> packed;
+        PackCompactVertices(vertices, vertexCount, packed, this->dequantScale, this->dequantOffset);
+        glBufferData(GL_ARRAY_BUFFER, packed.size() * sizeof(CompactVertex), packed.data(), GL_STATIC_DRAW);
+        this->gpuBytes = packed.size() * sizeof(CompactVertex);
+    } else {
+        glBufferData(GL_ARRAY_BUFFER, vertexCount * sizeof(Vertex), vertices, GL_STATIC_DRAW);
+        this->dequantScale = glm::vec3(1.0f);
+        this->dequantOffset = glm::vec3(0.0f);
+        this->gpuBytes = vertexCount * sizeof(Vertex);
+    }
 
+    // The CPU arrays stay 32 bit (BVH, optimizer and MeshCache share them), the GL
+    // buffer gets the narrowest type that holds the largest index. Baked arrays
+    // already decided it: no narrow copy means 32 bit.
+    unsigned int maxIndex = 0;
+    if (!gpuArrays) {
+        for (size_t i = 0; i < indexCount; ++i) maxIndex = std::max(maxIndex, indices[i]);
+    }
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->EBO);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, this->indices.size() * sizeof(unsigned int), this->indices.data(), GL_STATIC_DRAW);
+    if (gpuArrays && gpuArrays->narrowIndices) {
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(uint16_t), gpuArrays->narrowIndices, GL_STATIC_DRAW);
+        this->indexType = GL_UNSIGNED_SHORT;
+        this->gpuBytes += indexCount * sizeof(uint16_t);
+    } else if (!gpuArrays && maxIndex <= 0xFFFFu) {
+        std::vector<uint16_t> narrow(indices, indices + indexCount);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(uint16_t), narrow.data(), GL_STATIC_DRAW);
+        this->indexType = GL_UNSIGNED_SHORT;
+        this->gpuBytes += indexCount * sizeof(uint16_t);
+    } else {
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * sizeof(unsigned int), indices, GL_STATIC_DRAW);
+        this->indexType = GL_UNSIGNED_INT;
+        this->gpuBytes += indexCount * sizeof(unsigned int);
+    }
+
+    if (this->compact) {
+        const GLsizei stride = sizeof(CompactVertex);
+
+        // layout = 0 : position (int16 x3) + bitangent sign (w)
+        glVertexAttribPointer(0, 4, GL_SHORT, GL_FALSE, stride, (void*)offsetof(CompactVertex, position));
+        glEnableVertexAttribArray(0);
+
+        // layout = 2 : uv (half x2)
+        glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, stride, (void*)offsetof(CompactVertex, texCoord));
+        glEnableVertexAttribArray(2);
+
+        // layout = 5 : octahedral normal (int16 x2)
+        glVertexAttribPointer(5, 2, GL_SHORT, GL_FALSE, stride, (void*)offsetof(CompactVertex, normal));
+        glEnableVertexAttribArray(5);
+
+        // layout = 6 : octahedral tangent (int16 x2)
+        glVertexAttribPointer(6, 2, GL_SHORT, GL_FALSE, stride, (void*)offsetof(CompactVertex, tangent));
+        glEnableVertexAttribArray(6);
+
+        glBindVertexArray(0);
+        return;
+    }
 
     // layout = 0 : position
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
@@ -188,7 +368,12 @@ void Mesh::SetupBuffers() {
 // Draw the mesh
 void Mesh::Draw(){
     glBindVertexArray(this->VAO);
-    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(this->indices.size()), GL_UNSIGNED_INT, 0);
+    // Per-draw constants of the vertex layout: generic attribute values (no array is
+    // bound to these locations), so they reach the shader without knowing which one is bound
+    glVertexAttrib4f(DEQUANT_SCALE_LOCATION, this->dequantScale.x, this->dequantScale.y, this->dequantScale.z,
+                     this->compact ? 1.0f : 0.0f);
+    glVertexAttrib3f(DEQUANT_OFFSET_LOCATION, this->dequantOffset.x, this->dequantOffset.y, this->dequantOffset.z);
+    glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(this->drawIndexCount), this->indexType, 0);
     glBindVertexArray(0);
 }
 
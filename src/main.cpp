@@ -6,6 +6,7 @@
 
 #include "cubemap/cubemap.h"
 #include "texture/texture.h"
+#include "texture/hdr_format.h"
 #include "cubemap/skybox.h"
 #include "geometry.h"
 #include "env.h"
@@ -17,6 +18,7 @@
 #include "imgui_impl_opengl3.h"
 #include "model_loader/ply_loader.h"
 #include "model_loader/glb_loader.h"
+#include "model_loader/glb_async_loader.h"
 #include "scene.h"
 
 // ======== Camera state ========
@@ -199,6 +201,8 @@ int main() {
     Environment env; // Create env object to load irradiance, prefilter and brdf lut
 
     //================Env maps=======================
+    // Baked from an equirectangular HDR with the "ibl bake" tool: ./ibl_bake -o debug env.hdr
+    // writes these three files (tools/ibl_bake.cpp)
     // load prefilter map
     const unsigned int prefilterSize = 128;
     const unsigned int mipLevels = 8;
@@ -212,7 +216,7 @@ int main() {
 
     // load brdf lut
     std::string brdflutPath = "debug/brdflut.hdr";
-    std::string brdflutktxPath = "debug/brdflut.ktx";
+    std::string brdflutktxPath = "debug/brdfLUT.ktx";
     unsigned int brdfSize = 512;
     env.LoadBRDFLut(brdflutktxPath, brdfSize);
 
@@ -246,7 +250,7 @@ int main() {
     // TODO: Combine it iinto skybox class
     std::string envMapPath = "assets/env.hdr";
     unsigned int envSize = 2048;
-    auto envMap = std::make_shared<Cubemap>(envSize, 0);
+    auto envMap = std::make_shared<Cubemap>(envSize, 0, ENV_CUBEMAP_FORMAT);   // half float: 48 -> 24 MB
     envMap->LoadEquiToCubemap(envMapPath);
 
     auto skyShader = std::make_shared<Shader>("shader/debug.vert", "shader/debug.frag");
@@ -275,16 +279,12 @@ int main() {
     // Create scene manager
     std::shared_ptr<Scene> scene = std::make_shared<Scene>();
 
-    GlbLoader loader;
-
     auto hemlet = std::make_shared<SceneNode>(nullptr, nullptr);
 
     const std::string glbPath = "assets/models/sponza/glTF/Sponza.gltf";
 
-    if (!loader.LoadFile(glbPath, hemlet)) {
-        std::cerr << "Load glb failed\n";
-        return -1;
-    }
+    // Streams in while rendering, see modelLoad->Update in the render loop
+    std::shared_ptr<GlbAsyncLoad> modelLoad = GlbLoader::LoadFileAsync(glbPath, hemlet);
     //hemlet->SetScale(glm::vec3(100.0f));
     scene->AddNode(hemlet);
 
@@ -308,8 +308,12 @@ int main() {
     glCullFace(GL_BACK);
     glFrontFace(GL_CCW);
     // ==================== Main Render Loop ===================
+    unsigned long long frameIndex = 0;
     while (!glfwWindowShouldClose(window)) {
         ProcessInput(window);
+        pbrShader->ResetUniformStats(); // Uniform counters are per frame
+        MaterialBlockBuffer::Get().ResetStats();
+        TransformStore::Get().ResetStats();
 
         int fbw = 0, fbh = 0;
         glfwGetFramebufferSize(window, &fbw, &fbh);
@@ -355,7 +359,47 @@ int main() {
         pbrShader->SetUniform("projection", proj);
         pbrShader->SetUniform("camPos", camPos);
 
-        scene->Render(pbrShader, camPos);
+        // Upload what the loader threads finished, within the frame budget
+        if (modelLoad && !modelLoad->Update(STREAM_BUDGET_MS, STREAM_BUDGET_BYTES)) {
+            if (modelLoad->GetState() == GlbAsyncLoad::State::Failed) {
+                std::cerr << "Load glb failed\n";
+            }
+            modelLoad.reset();
+        }
+
+        scene->UpdateTransforms();
+        scene->Render(pbrShader, camPos, proj * view);
+
+        // ================== Render statistics ===================
+        if (STATS_PRINT_INTERVAL > 0 && ++frameIndex % STATS_PRINT_INTERVAL == 0) {
+            const UniformStats& us = pbrShader->GetUniformStats();
+            std::cout << "[Stats] uniforms: sets=" << us.uniformSets
+                      << " lookupsAvoided=" << us.lookupsAvoided
+                      << " redundantSkipped=" << us.redundantSetsSkipped << "\n";
+            const MaterialBlockStats& ms = MaterialBlockBuffer::Get().GetStats();
+            std::cout << "[Stats] material blocks: uploads=" << ms.blockUploads
+                      << " rangeBinds=" << ms.rangeBinds
+                      << " bindsSkipped=" << ms.bindsSkipped << "\n";
+            const RenderStats& rs = scene->GetRenderStats();
+            std::cout << "[Stats] draws=" << rs.draws
+                      << " stateChanges=" << rs.StateChanges()
+                      << " (unsorted " << rs.stateChangesUnsorted << ")"
+                      << " visible=" << rs.nodesVisible
+                      << " culled=" << rs.nodesCulled
+                      << " subtreesCulled=" << rs.subtreesCulled << "\n";
+            const TransformStats& ts = TransformStore::Get().GetStats();
+            std::cout << "[Stats] transforms: recomputed=" << ts.matricesRecomputed
+                      << " dirtySubtrees=" << ts.dirtySubtrees << "\n";
+            const SceneMemoryStats mem = scene->GetMemoryStats();
+            std::cout << "[Stats] memory: nodes=" << mem.nodes << " (" << mem.nodeBytes / 1024 << " KB)"
+                      << " meshes=" << mem.meshes
+                      << " vertices=" << mem.vertexBytes / 1024 << " KB"
+                      << " positions=" << mem.positionBytes / 1024 << " KB"
+                      << " indices=" << mem.indexBytes / 1024 << " KB"
+                      << " mapped=" << mem.mappedBytes / 1024 << " KB"
+                      << " meshBVH=" << mem.meshBVHBytes / 1024 << " KB"
+                      << " gpu=" << mem.gpuBytes / 1024 << " KB\n";
+        }
 
     	//plane->Draw();
 
@@ -0,0 +1,63 @@
+#include "mapped_file.h"
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::~MappedFile() {
+    this->Close();
+}
+
+MappedFile::MappedFile(MappedFile&& other) noexcept:
+    data(other.data),
+    size(other.size) {
+    other.data = nullptr;
+    other.size = 0;
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+        this->Close();
+        std::swap(this->data, other.data);
+        std::swap(this->size, other.size);
+    }
+    return *this;
+}
+
+bool MappedFile::Open(const std::string& path) {
+    this->Close();
+
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        return false;
+    }
+    void* mapped = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping keeps its own reference
+    if (mapped == MAP_FAILED) return false;
+
+    this->data = static_cast<const unsigned char*>(mapped);
+    this->size = (size_t)st.st_size;
+    return true;
+}
+
+void MappedFile::Close() {
+    if (this->data) {
+        munmap(const_cast<unsigned char*>(this->data), this->size);
+    }
+    this->data = nullptr;
+    this->size = 0;
+}
+
+void MappedFile::AdviseSequential() const {
+    if (this->data) madvise(const_cast<unsigned char*>(this->data), this->size, MADV_SEQUENTIAL);
+}
+
+void MappedFile::AdviseWillNeed() const {
+    if (this->data) madvise(const_cast<unsigned char*>(this->data), this->size, MADV_WILLNEED);
+}
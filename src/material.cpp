@@ -4,6 +4,8 @@
 #include "config.h"
 #include <iostream>
 #include <glm/glm.hpp>
+#include <algorithm>
+#include <cstring>
 
 PBRMaterial::PBRMaterial(): 
     baseColor(glm::vec3(1.0f, 0.0f, 0.0f)), 
@@ -18,101 +20,241 @@ PBRMaterial::PBRMaterial():
     // Set default fallback values for material
 }
 
+PBRMaterial::~PBRMaterial() {
+    if (this->blockSlot >= 0) {
+        MaterialBlockBuffer::Get().Release(this->blockSlot);
+    }
+}
+
 void PBRMaterial::LoadAlbedoMap(const std::string& path) {
     this->albedoMap = std::make_shared<Texture2D>();
-    this->albedoMap->LoadLDRToTexture(path, true); // Use sRGB format for albedo map
+    this->albedoMap->LoadCookedTexture(path, TextureUsage::Color); // sRGB BC1/BC3
+    this->blockDirty = true;
 }
 
 void PBRMaterial::LoadMetalnessMap(const std::string& path) {
     this->metalnessMap = std::make_shared<Texture2D>();
-    this->metalnessMap->LoadLDRToTexture(path, false);
+    this->metalnessMap->LoadCookedTexture(path, TextureUsage::Mask);
+    this->blockDirty = true;
 }
 
 void PBRMaterial::LoadRoughnessMap(const std::string& path) {
     this->roughnessMap = std::make_shared<Texture2D>();
-    this->roughnessMap->LoadLDRToTexture(path, false);
+    this->roughnessMap->LoadCookedTexture(path, TextureUsage::Mask);
+    this->blockDirty = true;
 }
 
 void PBRMaterial::LoadNormalMap(const std::string& path) {
     this->normalMap = std::make_shared<Texture2D>();
-    this->normalMap->LoadLDRToTexture(path, false);
+    this->normalMap->LoadCookedTexture(path, TextureUsage::Normal);
+    this->blockDirty = true;
 }
 
 void PBRMaterial::LoadAoMap(const std::string& path) {
     this->aoMap = std::make_shared<Texture2D>();
-    this->aoMap->LoadLDRToTexture(path, false);
+    this->aoMap->LoadCookedTexture(path, TextureUsage::Mask);
+    this->blockDirty = true;
 }
 
 void PBRMaterial::LoadRoughnessMetalMap(const std::string& path) {
     this->roughnessMetalMap = std::make_shared<Texture2D>();
-    this->roughnessMetalMap->LoadLDRToTexture(path, false);
+    this->roughnessMetalMap->LoadCookedTexture(path, TextureUsage::Data);
+    this->blockDirty = true;
 }
 
 void PBRMaterial::LoadEmissiveMap(const std::string& path) {
     this->emissiveMap = std::make_shared<Texture2D>();
-    this->emissiveMap->LoadLDRToTexture(path, true); // use sRGB format for emissive map
+    this->emissiveMap->LoadCookedTexture(path, TextureUsage::Color); // sRGB BC1/BC3
+    this->blockDirty = true;
+}
+
+//==================MaterialBlockBuffer========================
+MaterialBlockBuffer& MaterialBlockBuffer::Get() {
+    static MaterialBlockBuffer instance;
+    return instance;
+}
+
+// Hand out a slot, reusing released ones first
+int MaterialBlockBuffer::Allocate() {
+    if (!this->freeSlots.empty()) {
+        int slot = this->freeSlots.back();
+        this->freeSlots.pop_back();
+        return slot;
+    }
+    int slot = this->slotCount++;
+    if (slot >= this->capacity) {
+        this->Grow(slot + 1);
+    }
+    return slot;
+}
+
+void MaterialBlockBuffer::Release(int slot) {
+    this->freeSlots.push_back(slot);
+}
+
+// Reallocate GPU storage (doubling) and refill it from the CPU shadow copy
+void MaterialBlockBuffer::Grow(int minCapacity) {
+    if (this->stride == 0) {
+        GLint alignment = 256;
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+        alignment = std::max(alignment, 1);
+        // std140 pads the block to a vec4 multiple (96 bytes), drivers report that as
+        // GL_UNIFORM_BLOCK_DATA_SIZE and a bound range must not be smaller
+        const GLsizeiptr blockSize = ((static_cast<GLsizeiptr>(sizeof(MaterialBlock)) + 15) / 16) * 16;
+        this->stride = ((blockSize + alignment - 1) / alignment) * alignment;
+    }
+    if (this->ubo == 0) {
+        glGenBuffers(1, &this->ubo);
+    }
+
+    int newCapacity = std::max(this->capacity * 2, 64);
+    while (newCapacity < minCapacity) newCapacity *= 2;
+
+    this->shadow.resize(static_cast<size_t>(newCapacity * this->stride), 0);
+    glBindBuffer(GL_UNIFORM_BUFFER, this->ubo);
+    glBufferData(GL_UNIFORM_BUFFER, newCapacity * this->stride, this->shadow.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+
+    this->capacity = newCapacity;
+    this->boundSlot = -1; // old range binding refers to the orphaned storage
+}
+
+void MaterialBlockBuffer::Update(int slot, const MaterialBlock& block) {
+    GLintptr offset = slot * this->stride;
+    std::memcpy(this->shadow.data() + offset, &block, sizeof(MaterialBlock));
+
+    glBindBuffer(GL_UNIFORM_BUFFER, this->ubo);
+    glBufferSubData(GL_UNIFORM_BUFFER, offset, sizeof(MaterialBlock), &block);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    this->stats.blockUploads++;
+}
+
+// Bind the whole slot to MATERIAL_BLOCK_BINDING, skipped if it is already bound
+void MaterialBlockBuffer::Bind(int slot) {
+    if (slot == this->boundSlot) {
+        this->stats.bindsSkipped++;
+        return;
+    }
+    glBindBufferRange(GL_UNIFORM_BUFFER, MATERIAL_BLOCK_BINDING, this->ubo,
+                      slot * this->stride, this->stride);
+    this->boundSlot = slot;
+    this->stats.rangeBinds++;
+}
+
+//==================PBRMaterial========================
+MaterialBlock PBRMaterial::BuildMaterialBlock() const {
+    MaterialBlock block{};
+    block.baseColor             = baseColor;
+    block.baseAlpha             = baseAlpha;
+    block.emissive              = emissiveFactor;
+    block.roughness             = roughness;
+    block.metalness             = metalness;
+    block.ao                    = aoFactor;
+    block.alphaCutoff           = alphaCutoff;
+    block.normalScale           = normalScale;
+    block.alphaMode             = static_cast<int>(alphaMode);
+    block.doubleSided           = doubleSided ? 1 : 0;
+    block.useVertexTangent      = useVertexTangent ? 1 : 0;
+    block.useAlbedoMap          = albedoMap ? 1 : 0;
+    block.useRoughnessMap       = roughnessMap ? 1 : 0;
+    block.useMetalnessMap       = metalnessMap ? 1 : 0;
+    block.useNormalMap          = normalMap ? 1 : 0;
+    block.useAOMap              = aoMap ? 1 : 0;
+    block.useRoughnessMetalMap  = roughnessMetalMap ? 1 : 0;
+    block.useEmissiveMap        = emissiveMap ? 1 : 0;
+    return block;
+}
+
+// Sampler handles used by PBRMaterial, resolved once per shader program
+struct PBRUniformIds {
+    GLuint program = 0;
+    UniformId albedoMap, roughnessMetalMap, roughnessMap, metalnessMap, normalMap, aoMap, emissiveMap;
+};
+
+static const PBRUniformIds& GetPBRUniformIds(const Shader& shader) {
+    static PBRUniformIds ids;
+    if (ids.program == shader.GetProgramID()) {
+        return ids;
+    }
+
+    ids.program              = shader.GetProgramID();
+    ids.albedoMap            = shader.GetUniformId("albedoMap");
+    ids.roughnessMetalMap    = shader.GetUniformId("roughnessMetalMap");
+    ids.roughnessMap         = shader.GetUniformId("roughnessMap");
+    ids.metalnessMap         = shader.GetUniformId("metalnessMap");
+    ids.normalMap            = shader.GetUniformId("normalMap");
+    ids.aoMap                = shader.GetUniformId("aoMap");
+    ids.emissiveMap          = shader.GetUniformId("emissiveMap");
+
+    // Material parameters are read from the shared uniform buffer
+    shader.BindUniformBlock("MaterialBlock", MATERIAL_BLOCK_BINDING);
+    return ids;
+}
+
+uint64_t PBRMaterial::GetTextureSetHash() const {
+    const std::shared_ptr<Texture2D> textures[] = {
+        albedoMap, roughnessMap, metalnessMap, normalMap, aoMap, roughnessMetalMap, emissiveMap
+    };
+    // FNV-1a over the texture object names
+    uint64_t hash = 1469598103934665603ull;
+    for (const auto& t : textures) {
+        hash ^= t ? static_cast<uint64_t>(t->GetTexture()) : 0ull;
+        hash *= 1099511628211ull;
+    }
+    return hash;
 }
 
 void PBRMaterial::UploadToShader(const std::shared_ptr<Shader>& shader) const {
     shader->Use();
+    this->UploadToBoundShader(shader);
+}
+
+void PBRMaterial::UploadToBoundShader(const std::shared_ptr<Shader>& shader) const {
+    const PBRUniformIds& ids = GetPBRUniformIds(*shader);
 
-    // --- If use texture ---
-    shader->SetUniform("useRoughnessMetalMap",  roughnessMetalMap   ? 1: 0);
-    shader->SetUniform("useAlbedoMap",          albedoMap           ? 1 : 0);
-    shader->SetUniform("useRoughnessMap",       roughnessMap        ? 1 : 0);
-    shader->SetUniform("useMetalnessMap",       metalnessMap        ? 1 : 0);
-    shader->SetUniform("useNormalMap",          normalMap           ? 1 : 0);
-    shader->SetUniform("useAOMap",              aoMap               ? 1 : 0);
-    shader->SetUniform("useEmissiveMap",        emissiveMap         ? 1 : 0);
-
-    // --- fallbacks (used when no texture is provided ) ---
-    shader->SetUniform("baseColor", baseColor);
-    shader->SetUniform("roughness", roughness);
-    shader->SetUniform("metalness", metalness);
-    shader->SetUniform("ao",        aoFactor);
-    shader->SetUniform("emissive",  emissiveFactor);
-
-    // --- Alpha control ---
-    shader->SetUniform("alphaCutoff", alphaCutoff);
-    shader->SetUniform("doubleSided", doubleSided);
-    shader->SetUniform("alphaMode", static_cast<int>(alphaMode));
-    shader->SetUniform("baseAlpha", baseAlpha);
-
-    // --- Normal control ---
-    shader->SetUniform("useVertexTangent", this->useVertexTangent);
-    shader->SetUniform("normalScale", this->normalScale);
+    // --- Factors, flags, alpha and normal control live in the material block ---
+    MaterialBlockBuffer& blocks = MaterialBlockBuffer::Get();
+    if (this->blockSlot < 0) {
+        this->blockSlot = blocks.Allocate();
+        this->blockDirty = true;
+    }
+    if (this->blockDirty) {
+        blocks.Update(this->blockSlot, this->BuildMaterialBlock());
+        this->blockDirty = false;
+    }
+    blocks.Bind(this->blockSlot);
     
     if (albedoMap) {
-        shader->SetUniform("albedoMap", ALBEDO_TEXTURE_UNIT);
+        shader->SetUniform(ids.albedoMap, ALBEDO_TEXTURE_UNIT);
         albedoMap->Bind(ALBEDO_TEXTURE_UNIT);
     }
     // If use RM map or seperate roughness and metalness map
     if (roughnessMetalMap) {
-        shader->SetUniform("roughnessMetalMap", ROUGHNESS_TEXTURE_UNIT);
+        shader->SetUniform(ids.roughnessMetalMap, ROUGHNESS_TEXTURE_UNIT);
         roughnessMetalMap->Bind(ROUGHNESS_TEXTURE_UNIT);
     } else {
         if (roughnessMap) {
-            shader->SetUniform("roughnessMap", ROUGHNESS_TEXTURE_UNIT);
+            shader->SetUniform(ids.roughnessMap, ROUGHNESS_TEXTURE_UNIT);
             roughnessMap->Bind(ROUGHNESS_TEXTURE_UNIT);
         }
         if (metalnessMap) {
-            shader->SetUniform("metalnessMap", METALNESS_TEXTURE_UNIT);
+            shader->SetUniform(ids.metalnessMap, METALNESS_TEXTURE_UNIT);
             metalnessMap->Bind(METALNESS_TEXTURE_UNIT);
         }
     }
 
     if (normalMap) {
-        shader->SetUniform("normalMap", NORMAL_TEXTURE_UNIT);
+        shader->SetUniform(ids.normalMap, NORMAL_TEXTURE_UNIT);
         normalMap->Bind(NORMAL_TEXTURE_UNIT);
     }
 
     if (aoMap) {
-        shader->SetUniform("aoMap", AO_TEXTURE_UNIT);
+        shader->SetUniform(ids.aoMap, AO_TEXTURE_UNIT);
         aoMap->Bind(AO_TEXTURE_UNIT);
     }
 
     if (emissiveMap) {
-        shader->SetUniform("emissiveMap", EMISSIVE_TEXTURE_UNIT);
+        shader->SetUniform(ids.emissiveMap, EMISSIVE_TEXTURE_UNIT);
         emissiveMap->Bind(EMISSIVE_TEXTURE_UNIT);
     }
 
@@ -0,0 +1,334 @@
+#include "mesh_optimizer.h"
+#include "geometry.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <ostream>
+
+//=================================Mesh Optimizer==================================
+namespace {
+    // Forsyth, "Linear-Speed Vertex Cache Optimisation": LRU cache of 32 entries,
+    // the last triangle's vertices get a fixed score, older entries decay and
+    // vertices with few remaining triangles are boosted so they get finished off
+    constexpr int FORSYTH_CACHE_SIZE = 32;
+    constexpr int FORSYTH_MAX_VALENCE = 32;
+    constexpr float FORSYTH_LAST_TRIANGLE_SCORE = 0.75f;
+    constexpr float FORSYTH_DECAY_POWER = 1.5f;
+    constexpr float FORSYTH_VALENCE_SCALE = 2.0f;
+    constexpr float FORSYTH_VALENCE_POWER = 0.5f;
+
+    struct ForsythTables {
+        float cache[FORSYTH_CACHE_SIZE];
+        float valence[FORSYTH_MAX_VALENCE + 1];
+
+        ForsythTables() {
+            for (int i = 0; i < FORSYTH_CACHE_SIZE; ++i) {
+                if (i < 3) {
+                    this->cache[i] = FORSYTH_LAST_TRIANGLE_SCORE;
+                } else {
+                    const float scale = 1.0f / (FORSYTH_CACHE_SIZE - 3);
+                    this->cache[i] = std::pow(1.0f - (i - 3) * scale, FORSYTH_DECAY_POWER);
+                }
+            }
+            this->valence[0] = 0.0f;
+            for (int i = 1; i <= FORSYTH_MAX_VALENCE; ++i) {
+                this->valence[i] = FORSYTH_VALENCE_SCALE * std::pow((float)i, -FORSYTH_VALENCE_POWER);
+            }
+        }
+    };
+    const ForsythTables forsythTables;
+
+    inline float VertexScore(int cachePosition, unsigned int remaining) {
+        if (remaining == 0) return -1.0f; // no triangle left to pull in
+        float score = cachePosition >= 0 ? forsythTables.cache[cachePosition] : 0.0f;
+        return score + forsythTables.valence[std::min<unsigned int>(remaining, FORSYTH_MAX_VALENCE)];
+    }
+
+    // FIFO cache simulation with timestamps: a vertex is cached while fewer than
+    // cacheSize misses happened since it was last transformed
+    struct FifoCache {
+        std::vector<unsigned int> stamps;
+        unsigned int time;
+        unsigned int size;
+
+        FifoCache(size_t vertexCount, unsigned int size): stamps(vertexCount, 0), time(size + 1), size(size) {}
+
+        bool Touch(unsigned int v) {
+            if (this->time - this->stamps[v] <= this->size) return false;
+            this->stamps[v] = this->time++;
+            return true;
+        }
+        void Reset() { this->time += this->size + 1; }
+    };
+}
+
+void MeshOptimizeStats::Add(const MeshOptimizeStats& other) {
+    this->meshes += other.meshes;
+    this->triangles += other.triangles;
+    this->vertices += other.vertices;
+    this->transformsBefore += other.transformsBefore;
+    this->transformsAfter += other.transformsAfter;
+    this->clusters += other.clusters;
+    this->ms += other.ms;
+}
+
+void MeshOptimizeStats::Print(std::ostream& out, const char* tag) const {
+    out << "[" << tag << "] optimized " << this->meshes << " meshes, " << this->triangles << " triangles: ACMR "
+        << this->GetACMRBefore() << " -> " << this->GetACMRAfter() << ", ATVR " << this->GetATVRBefore()
+        << " -> " << this->GetATVRAfter() << ", " << this->clusters << " overdraw clusters, "
+        << this->ms << " ms\n";
+}
+
+size_t AnalyzeVertexCache(const unsigned int* indices, size_t indexCount, size_t vertexCount, unsigned int cacheSize) {
+    FifoCache cache(vertexCount, cacheSize);
+    size_t misses = 0;
+    for (size_t i = 0; i < indexCount; ++i) {
+        if (cache.Touch(indices[i])) misses++;
+    }
+    return misses;
+}
+
+void OptimizeVertexCache(unsigned int* dst, const unsigned int* indices, size_t indexCount, size_t vertexCount) {
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0) return;
+
+    // Triangles of each vertex (CSR), the active part shrinks as triangles are emitted
+    std::vector<unsigned int> remaining(vertexCount, 0);
+    for (size_t i = 0; i < indexCount; ++i) remaining[indices[i]]++;
+    std::vector<unsigned int> offsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; ++v) offsets[v + 1] = offsets[v] + remaining[v];
+    std::vector<unsigned int> adjacency(indexCount);
+    {
+        std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < indexCount; ++i) adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+    }
+
+    std::vector<float> vertexScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) vertexScore[v] = VertexScore(-1, remaining[v]);
+
+    std::vector<float> triangleScore(triangleCount);
+    std::vector<char> emitted(triangleCount, 0);
+    for (size_t t = 0; t < triangleCount; ++t) {
+        triangleScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+    }
+
+    unsigned int cache[FORSYTH_CACHE_SIZE + 3];
+    unsigned int nextCache[FORSYTH_CACHE_SIZE + 3];
+    int cacheCount = 0;
+
+    size_t best = 0;
+    for (size_t t = 1; t < triangleCount; ++t) {
+        if (triangleScore[t] > triangleScore[best]) best = t;
+    }
+    size_t scanCursor = 0;
+
+    for (size_t out = 0; out < triangleCount; ++out) {
+        const unsigned int* tri = indices + best * 3;
+        dst[out * 3] = tri[0];
+        dst[out * 3 + 1] = tri[1];
+        dst[out * 3 + 2] = tri[2];
+        emitted[best] = 1;
+
+        // Remove the triangle from its vertices' active lists
+        for (int k = 0; k < 3; ++k) {
+            const unsigned int v = tri[k];
+            unsigned int* list = adjacency.data() + offsets[v];
+            for (unsigned int j = 0; j < remaining[v]; ++j) {
+                if (list[j] == best) {
+                    list[j] = list[remaining[v] - 1];
+                    remaining[v]--;
+                    break;
+                }
+            }
+        }
+
+        // New LRU state: the triangle's vertices in front, then the old entries
+        int nextCount = 0;
+        for (int k = 0; k < 3; ++k) {
+            if (std::find(nextCache, nextCache + nextCount, tri[k]) == nextCache + nextCount) nextCache[nextCount++] = tri[k];
+        }
+        for (int i = 0; i < cacheCount; ++i) {
+            const unsigned int v = cache[i];
+            if (v != tri[0] && v != tri[1] && v != tri[2]) nextCache[nextCount++] = v;
+        }
+
+        // Rescore every vertex whose position or valence changed, vertices pushed
+        // out of the cache lose their position score
+        for (int i = 0; i < nextCount; ++i) {
+            const unsigned int v = nextCache[i];
+            const int position = i < FORSYTH_CACHE_SIZE ? i : -1;
+            const float score = VertexScore(position, remaining[v]);
+            const float delta = score - vertexScore[v];
+            vertexScore[v] = score;
+            const unsigned int* list = adjacency.data() + offsets[v];
+            for (unsigned int j = 0; j < remaining[v]; ++j) triangleScore[list[j]] += delta;
+        }
+        cacheCount = std::min(nextCount, FORSYTH_CACHE_SIZE);
+        std::copy(nextCache, nextCache + cacheCount, cache);
+
+        // Next triangle: the best one touching the cache, else the first one left
+        float bestScore = -1.0f;
+        bool found = false;
+        for (int i = 0; i < cacheCount; ++i) {
+            const unsigned int v = cache[i];
+            const unsigned int* list = adjacency.data() + offsets[v];
+            for (unsigned int j = 0; j < remaining[v]; ++j) {
+                if (triangleScore[list[j]] > bestScore) {
+                    bestScore = triangleScore[list[j]];
+                    best = list[j];
+                    found = true;
+                }
+            }
+        }
+        if (!found) {
+            while (scanCursor < triangleCount && emitted[scanCursor]) ++scanCursor;
+            if (scanCursor == triangleCount) break;
+            best = scanCursor;
+        }
+    }
+}
+
+size_t OptimizeOverdraw(unsigned int* dst, const unsigned int* indices, size_t indexCount,
+                        const Vertex* vertices, size_t vertexCount, float slack) {
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0) return 0;
+
+    // Hard boundaries: triangles that miss the cache on all three vertices, the
+    // order before them does not matter to the cache
+    std::vector<size_t> hard;
+    {
+        FifoCache cache(vertexCount, MESH_OPT_CACHE_SIZE);
+        for (size_t t = 0; t < triangleCount; ++t) {
+            int misses = 0;
+            for (int k = 0; k < 3; ++k) misses += cache.Touch(indices[t * 3 + k]) ? 1 : 0;
+            if (t == 0 || misses == 3) hard.push_back(t);
+        }
+        hard.push_back(triangleCount);
+    }
+
+    // Soft boundaries: inside a hard cluster, cut whenever the part since the last
+    // cut (with a cold cache) is within slack of the whole cluster's ACMR
+    std::vector<size_t> starts;
+    {
+        FifoCache cache(vertexCount, MESH_OPT_CACHE_SIZE);
+        for (size_t c = 0; c + 1 < hard.size(); ++c) {
+            const size_t begin = hard[c], end = hard[c + 1];
+            cache.Reset();
+            size_t clusterMisses = 0;
+            for (size_t t = begin; t < end; ++t) {
+                for (int k = 0; k < 3; ++k) clusterMisses += cache.Touch(indices[t * 3 + k]) ? 1 : 0;
+            }
+            const float threshold = (float)clusterMisses / (end - begin) * slack;
+
+            cache.Reset();
+            starts.push_back(begin);
+            size_t start = begin, misses = 0;
+            for (size_t t = begin; t < end; ++t) {
+                for (int k = 0; k < 3; ++k) misses += cache.Touch(indices[t * 3 + k]) ? 1 : 0;
+                if (t + 1 < end && (float)misses / (t - start + 1) <= threshold) {
+                    starts.push_back(t + 1);
+                    start = t + 1;
+                    misses = 0;
+                    cache.Reset();
+                }
+            }
+        }
+    }
+    const size_t clusterCount = starts.size();
+    starts.push_back(triangleCount);
+
+    // Area weighted centroid and normal of each cluster and of the whole mesh
+    std::vector<glm::vec3> centroids(clusterCount), normals(clusterCount);
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (size_t c = 0; c < clusterCount; ++c) {
+        glm::vec3 centroid(0.0f), normal(0.0f);
+        float area = 0.0f;
+        for (size_t t = starts[c]; t < starts[c + 1]; ++t) {
+            const glm::vec3& a = vertices[indices[t * 3]].position;
+            const glm::vec3& b = vertices[indices[t * 3 + 1]].position;
+            const glm::vec3& d = vertices[indices[t * 3 + 2]].position;
+            const glm::vec3 n = glm::cross(b - a, d - a);
+            const float triangleArea = glm::length(n);
+            centroid += (a + b + d) * (triangleArea / 3.0f);
+            normal += n;
+            area += triangleArea;
+        }
+        meshCentroid += centroid;
+        meshArea += area;
+        centroids[c] = area > 0.0f ? centroid / area : centroid;
+        const float len = glm::length(normal);
+        normals[c] = len > 0.0f ? normal / len : glm::vec3(0.0f);
+    }
+    if (meshArea > 0.0f) meshCentroid /= meshArea;
+
+    // Clusters facing away from the center are on the outside: draw them first
+    std::vector<float> keys(clusterCount);
+    std::vector<size_t> order(clusterCount);
+    for (size_t c = 0; c < clusterCount; ++c) {
+        keys[c] = glm::dot(centroids[c] - meshCentroid, normals[c]);
+        order[c] = c;
+    }
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return keys[a] > keys[b]; });
+
+    size_t out = 0;
+    for (size_t c : order) {
+        const size_t count = (starts[c + 1] - starts[c]) * 3;
+        std::copy(indices + starts[c] * 3, indices + starts[c] * 3 + count, dst + out);
+        out += count;
+    }
+    return clusterCount;
+}
+
+size_t OptimizeVertexFetch(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
+    const unsigned int UNUSED = ~0u;
+    std::vector<unsigned int> remap(vertices.size(), UNUSED);
+    unsigned int next = 0;
+    for (unsigned int& index : indices) {
+        if (remap[index] == UNUSED) remap[index] = next++;
+        index = remap[index];
+    }
+
+    std::vector<Vertex> reordered(next);
+    for (size_t v = 0; v < vertices.size(); ++v) {
+        if (remap[v] != UNUSED) reordered[remap[v]] = vertices[v];
+    }
+    vertices.swap(reordered);
+    return next;
+}
+
+MeshOptimizeStats OptimizeMesh(std::vector<Vertex>& vertices, std::vector<unsigned int>& indices) {
+    auto start = std::chrono::steady_clock::now();
+    MeshOptimizeStats stats;
+    stats.meshes = 1;
+    stats.triangles = indices.size() / 3;
+    stats.vertices = vertices.size();
+
+    bool valid = !indices.empty() && indices.size() % 3 == 0;
+    for (size_t i = 0; valid && i < indices.size(); ++i) valid = indices[i] < vertices.size();
+    if (!valid) {
+        stats.transformsBefore = stats.transformsAfter = indices.size();
+        return stats;
+    }
+
+    const size_t indexCount = indices.size();
+    stats.transformsBefore = AnalyzeVertexCache(indices.data(), indexCount, vertices.size());
+
+    std::vector<unsigned int> cacheOrder(indexCount);
+    OptimizeVertexCache(cacheOrder.data(), indices.data(), indexCount, vertices.size());
+    std::vector<unsigned int> clustered(indexCount);
+    stats.clusters = OptimizeOverdraw(clustered.data(), cacheOrder.data(), indexCount, vertices.data(), vertices.size());
+
+    // Already well ordered input (Assimp's ImproveCacheLocality, an earlier pass) stays as it is
+    if (AnalyzeVertexCache(clustered.data(), indexCount, vertices.size()) <= stats.transformsBefore) {
+        indices.swap(clustered);
+    } else {
+        stats.clusters = 0;
+    }
+
+    // Renumbering keeps the triangle order, so it does not change the cache misses
+    stats.vertices = OptimizeVertexFetch(vertices, indices);
+    stats.transformsAfter = AnalyzeVertexCache(indices.data(), indexCount, vertices.size());
+    stats.ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
@@ -0,0 +1,321 @@
+#include "model_loader/glb_async_loader.h"
+#include "thread_pool.h"
+#include <iostream>
+#include <unordered_set>
+
+static double MsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::shared_ptr<GlbAsyncLoad> GlbLoader::LoadFileAsync(const std::string& path,
+                                                       const std::shared_ptr<SceneNode>& parent) {
+    return GlbAsyncLoad::Start(path, parent);
+}
+
+GlbAsyncLoad::GlbAsyncLoad(const std::string& path, const std::shared_ptr<SceneNode>& parent, uint32_t maxInFlight):
+    path(path),
+    parent(parent),
+    startTime(std::chrono::steady_clock::now()),
+    maxInFlight(maxInFlight > 0 ? maxInFlight : 2 * ThreadPool::Get().GetThreadCount()) {
+}
+
+// Render thread. Queued tasks skip their work, running ones finish
+GlbAsyncLoad::~GlbAsyncLoad() {
+    this->cancelled.store(true, std::memory_order_relaxed);
+    this->WaitForTasks();
+}
+
+void GlbAsyncLoad::SubmitTask(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(this->taskMutex);
+        this->tasksPending++;
+    }
+    ThreadPool::Get().Submit([this, task = std::move(task)]() {
+        if (!this->cancelled.load(std::memory_order_relaxed)) {
+            task();
+        }
+        // Notify under the lock, the destructor cannot return before it is released
+        std::lock_guard<std::mutex> lock(this->taskMutex);
+        this->tasksPending--;
+        this->taskDone.notify_all();
+    });
+}
+
+void GlbAsyncLoad::WaitForTasks() {
+    std::unique_lock<std::mutex> lock(this->taskMutex);
+    this->taskDone.wait(lock, [this]() { return this->tasksPending == 0; });
+}
+
+std::shared_ptr<GlbAsyncLoad> GlbAsyncLoad::Start(const std::string& path,
+                                                  const std::shared_ptr<SceneNode>& parent,
+                                                  uint32_t maxInFlight) {
+    std::shared_ptr<GlbAsyncLoad> load(new GlbAsyncLoad(path, parent, maxInFlight));
+    if (!parent) {
+        std::cerr << "[GlbAsyncLoad] parent is null\n";
+        load->state = State::Failed;
+        return load;
+    }
+
+    // Images stay encoded here and are decoded by their own jobs
+    load->SubmitTask([load = load.get()]() {
+        auto start = std::chrono::steady_clock::now();
+        load->parsed = GlbLoader::ParseFile(load->path, load->model, true);
+        if (load->parsed && load->loader.useMeshCache) {
+            load->meshDependencies = GlbLoader::GetBufferFiles(load->model, load->path);
+            load->loader.diskCache = MeshCache::Open(load->path, load->meshDependencies);
+        }
+        load->parseMs = MsSince(start);
+        load->parseDone.store(true, std::memory_order_release);
+    });
+    return load;
+}
+
+float GlbAsyncLoad::GetProgress() const {
+    if (this->state == State::Done) return 1.0f;
+    if (this->drawCount == 0) return 0.0f;
+    return float(this->drawCount - this->pendingDraws.size()) / float(this->drawCount);
+}
+
+bool GlbAsyncLoad::Update(double budgetMs, uint64_t budgetBytes) {
+    if (this->state == State::Parsing) {
+        if (!this->parseDone.load(std::memory_order_acquire)) return true;
+        if (!this->parsed) {
+            std::cerr << "[GlbAsyncLoad] load failed: " << this->path << "\n";
+            this->state = State::Failed;
+            return false;
+        }
+        OnParsed();
+    }
+    if (this->state != State::Streaming) return false;
+
+    this->budgetStart = std::chrono::steady_clock::now();
+    this->budgetMs = budgetMs;
+    this->budgetBytesEnd = this->loader.stats.bytesUploaded + budgetBytes;
+    this->handledAny = false;
+
+    // Draws that became ready earlier but did not fit into that frame's budget
+    AttachReadyDraws();
+    while (!OverBudget()) {
+        SubmitJobs();
+        Result result;
+        {
+            std::lock_guard<std::mutex> lock(this->resultMutex);
+            if (this->results.empty()) break;
+            result = std::move(this->results.front());
+            this->results.pop_front();
+        }
+        this->inFlight--;
+        HandleResult(result);
+        AttachReadyDraws();
+    }
+    SubmitJobs();
+
+    if (this->nextJob == this->jobs.size() && this->inFlight == 0 && this->pendingDraws.empty()) {
+        Finish();
+        return false;
+    }
+    return true;
+}
+
+// Builds the node hierarchy with empty nodes and queues the decode jobs. Jobs follow
+// the draw order, each draw's images first and then its mesh, so nodes complete
+// roughly in file order instead of after all images.
+void GlbAsyncLoad::OnParsed() {
+    this->loader.stats = GlbLoadStats{};
+    this->loader.stats.parseMs = this->parseMs;
+    this->loader.stats.decodeThreads = ThreadPool::Get().GetThreadCount();
+
+    this->parent->UpdateLocalTransform();
+    this->parent->UpdateWorldTransform();
+
+    this->imageReady.assign(this->model.images.size(), 0);
+    const std::vector<char> cooked = GlbLoader::GetCookedImages(this->model, this->path, &this->imageCookUsages);
+    for (size_t i = 0; i < this->model.images.size(); ++i) {
+        const auto& img = this->model.images[i];
+        if (img.component >= 0 || img.image.empty() || cooked[i]) this->imageReady[i] = 1; // nothing to decode
+    }
+
+    this->loader.deferMeshes = true;
+    for (int root : GlbLoader::GetSceneRoots(this->model)) {
+        auto node = this->loader.BuildNodeRecursive(this->model, root, this->path);
+        if (node) this->parent->AddChild(node);
+    }
+    this->loader.deferMeshes = false;
+
+    std::vector<char> imageQueued(this->imageReady);
+    std::unordered_set<uint64_t> meshQueued;
+    for (const auto& draw : this->loader.deferredDraws) {
+        PendingDraw pending;
+        pending.draw = draw;
+        const auto& prim = this->model.meshes[draw.mesh].primitives[draw.primitive];
+        GlbLoader::GetMaterialImages(this->model, prim.material, pending.images);
+
+        for (int image : pending.images) {
+            if (imageQueued[image]) continue;
+            imageQueued[image] = 1;
+            Job job;
+            job.image = image;
+            this->jobs.push_back(job);
+        }
+        if (meshQueued.insert(GlbLoader::CacheKey(draw.mesh, draw.primitive)).second) {
+            Job job;
+            job.mesh = draw.mesh;
+            job.primitive = draw.primitive;
+            this->jobs.push_back(job);
+        }
+        this->pendingDraws.push_back(std::move(pending));
+    }
+    this->loader.deferredDraws.clear();
+    this->drawCount = this->pendingDraws.size();
+    this->state = State::Streaming;
+}
+
+// Submission only happens here on the render thread, which is what bounds the
+// decoded data waiting for upload. Results come back through the queue.
+void GlbAsyncLoad::SubmitJobs() {
+    while (this->nextJob < this->jobs.size() && this->inFlight < this->maxInFlight) {
+        const Job job = this->jobs[this->nextJob++];
+        this->inFlight++;
+        this->SubmitTask([this, job]() { this->RunJob(job); });
+    }
+}
+
+// Each job writes only its own image or its own result, the model is otherwise read only
+void GlbAsyncLoad::RunJob(const Job& job) {
+    auto start = std::chrono::steady_clock::now();
+    Result result;
+    result.job = job;
+    if (job.image >= 0) {
+        result.ok = GlbLoader::DecodeImage(this->model.images[job.image]);
+        if (result.ok && !this->imageCookUsages[job.image].empty()) {
+            auto cookStart = std::chrono::steady_clock::now();
+            result.texturesCooked = GlbLoader::CookImage(this->model, job.image, this->path,
+                                                         this->imageCookUsages[job.image]);
+            result.cookMs = MsSince(cookStart);
+        }
+    } else if (this->loader.diskCache &&
+               this->loader.diskCache->Contains(GlbLoader::CacheKey(job.mesh, job.primitive))) {
+        result.ok = result.cached = true; // mapped and uploaded on the render thread
+    } else {
+        const auto& prim = this->model.meshes[job.mesh].primitives[job.primitive];
+        result.ok = this->loader.DecodePrimitive(this->model, prim, result.vertices, result.indices, &result.optimize);
+    }
+    result.ms = MsSince(start);
+
+    std::lock_guard<std::mutex> lock(this->resultMutex);
+    this->results.push_back(std::move(result));
+}
+
+// Decode times add up per job (CPU time over all workers), unlike LoadFile's wall times
+void GlbAsyncLoad::HandleResult(Result& result) {
+    this->handledAny = true;
+    if (result.job.image >= 0) {
+        this->imageReady[result.job.image] = 1;
+        this->loader.stats.imageDecodeMs += result.ms - result.cookMs;
+        this->loader.stats.textureCookMs += result.cookMs;
+        this->loader.stats.texturesCooked += result.texturesCooked;
+        if (result.ok) {
+            this->loader.stats.imagesDecoded++;
+        } else {
+            std::cerr << "[GlbAsyncLoad] cannot decode image[" << result.job.image << "]\n";
+        }
+        return;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    const uint64_t key = GlbLoader::CacheKey(result.job.mesh, result.job.primitive);
+    GlbLoader::CachedMesh entry;
+    if (result.cached) {
+        entry.mesh = this->loader.LoadMeshFromDisk(key);
+    } else {
+        entry.mesh = std::make_shared<Mesh>();
+        if (result.ok) {
+            this->loader.UploadMesh(entry.mesh, result.vertices, result.indices, &result.optimize);
+        }
+    }
+    entry.bytes = entry.mesh->GetGPUBytes();
+    const double uploadMs = MsSince(start);
+    entry.ms = result.ms + uploadMs;
+    this->loader.stats.meshDecodeMs += result.ms;
+    this->loader.stats.meshUploadMs += uploadMs;
+    this->loader.meshCache[key] = entry;
+}
+
+bool GlbAsyncLoad::IsDrawReady(const PendingDraw& pending) const {
+    if (!this->loader.meshCache.count(GlbLoader::CacheKey(pending.draw.mesh, pending.draw.primitive))) return false;
+    for (int image : pending.images) {
+        if (!this->imageReady[image]) return false;
+    }
+    return true;
+}
+
+// Material creation uploads the textures, so it runs under the budget as well
+void GlbAsyncLoad::AttachReadyDraws() {
+    size_t keep = 0;
+    for (size_t i = 0; i < this->pendingDraws.size(); ++i) {
+        PendingDraw& pending = this->pendingDraws[i];
+        if (OverBudget() || !IsDrawReady(pending)) {
+            if (keep != i) this->pendingDraws[keep] = std::move(pending);
+            ++keep;
+            continue;
+        }
+
+        const auto& draw = pending.draw;
+        const auto& prim = this->model.meshes[draw.mesh].primitives[draw.primitive];
+        bool hasTangent = prim.attributes.count("TANGENT") > 0;
+        auto mesh = this->loader.GetOrLoadMesh(this->model, draw.mesh, draw.primitive);
+        auto mat  = this->loader.GetOrLoadMaterial(this->model, prim.material, hasTangent, this->path);
+        draw.node->SetMesh(mesh);
+        draw.node->SetMaterial(mat);
+        this->handledAny = true;
+    }
+    this->pendingDraws.resize(keep);
+}
+
+// At least one item per Update, so a single large upload cannot stall the load
+bool GlbAsyncLoad::OverBudget() const {
+    if (!this->handledAny) return false;
+    return MsSince(this->budgetStart) >= this->budgetMs ||
+           this->loader.stats.bytesUploaded >= this->budgetBytesEnd;
+}
+
+void GlbAsyncLoad::Finish() {
+    this->loader.PrintStats();
+    std::cerr << "[GlbAsyncLoad] " << this->path << " streamed in " << MsSince(this->startTime) << " ms\n";
+
+    // Cold start: bake the decoded meshes on a worker. The arrays are copied so the
+    // task never holds the last reference to a Mesh (GL objects die on this thread).
+    if (this->loader.useMeshCache && !this->loader.diskCache) {
+        struct BakedMesh {
+            uint64_t key;
+            std::vector<Vertex> vertices;
+            std::vector<unsigned int> indices;
+        };
+        auto baked = std::make_shared<std::vector<BakedMesh>>();
+        for (const MeshCache::Source& s : this->loader.GetDecodedMeshes()) {
+            baked->push_back(BakedMesh{s.key, std::vector<Vertex>(s.vertices, s.vertices + s.vertexCount),
+                                       std::vector<unsigned int>(s.indices, s.indices + s.indexCount)});
+        }
+        std::string sourcePath = this->path;
+        std::vector<std::string> dependencies = this->meshDependencies;
+        ThreadPool::Get().Submit([baked, sourcePath, dependencies]() {
+            std::vector<MeshCache::Source> sources;
+            for (const BakedMesh& m : *baked) {
+                MeshCache::Source s;
+                s.key = m.key;
+                s.vertices = m.vertices.data();
+                s.vertexCount = m.vertices.size();
+                s.indices = m.indices.data();
+                s.indexCount = m.indices.size();
+                sources.push_back(s);
+            }
+            MeshCache::Write(sourcePath, dependencies, sources);
+        });
+    }
+    this->loader.ApplyMeshResidency();
+
+    // The scene owns the resources now, the parsed model is no longer needed
+    this->loader.ClearCaches();
+    this->model = tinygltf::Model();
+    this->state = State::Done;
+}
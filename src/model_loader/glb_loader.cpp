@@ -1,7 +1,10 @@
 #include "model_loader/glb_loader.h"
+#include "thread_pool.h"
 #include <fstream>
 #include <iostream>
 #include <cctype>
+#include <chrono>
+#include <algorithm>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/quaternion.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -31,6 +34,12 @@ std::string GlbLoader::DirOf(const std::string& p) {
     auto pos = p.find_last_of("/\\");
     return (pos == std::string::npos) ? std::string(".") : p.substr(0, pos);
 }
+uint64_t GlbLoader::CacheKey(int a, int b) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(a)) << 32) | static_cast<uint32_t>(b);
+}
+static double MsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
 static glm::mat4 MakeTRS(const glm::vec3& T, const glm::quat& R, const glm::vec3& S) {
     glm::mat4 M(1.0f);
     M = glm::translate(M, T);
@@ -69,18 +78,14 @@ void GlbLoader::FillBitangentsFromTangentW(std::vector<Vertex>& vertices, float
     }
 }
 
-// ---------- LoadFile ----------
-bool GlbLoader::LoadFile(const std::string& path, const std::shared_ptr<SceneNode>& parent) {
-    if (!parent) {
-        std::cerr << "[GlbLoader] parent is null\n";
-        return false;
-    }
+// ---------- ParseFile ----------
+// Touches no loader state, GlbAsyncLoad runs it on a worker thread
+bool GlbLoader::ParseFile(const std::string& path, tinygltf::Model& model, bool deferImages) {
     if (!file_exists(path)) {
         std::cerr << "[GlbLoader] file not found: " << path << "\n";
         return false;
     }
 
-    tinygltf::Model model;
     tinygltf::TinyGLTF loader;
     std::string err, warn;
 
@@ -102,6 +107,18 @@ bool GlbLoader::LoadFile(const std::string& path, const std::shared_ptr<SceneNod
         return ok;
     };
 
+    // Deferred images keep the encoded PNG/JPEG bytes during the parse (component -1
+    // marks them), DecodeImage turns them into pixels later
+    if (deferImages) {
+        loader.SetImageLoader([](tinygltf::Image* image, const int, std::string*, std::string*,
+                                 int, int, const unsigned char* bytes, int size, void*) {
+            image->image.assign(bytes, bytes + size);
+            image->width = image->height = image->component = -1;
+            image->bits = image->pixel_type = -1;
+            return true;
+        }, nullptr);
+    }
+
     bool ok = false;
     if (expect_glb) { ok = try_binary(); if (!ok) ok = try_ascii(); }
     else            { ok = try_ascii();  if (!ok) ok = try_binary(); }
@@ -110,31 +127,97 @@ bool GlbLoader::LoadFile(const std::string& path, const std::shared_ptr<SceneNod
         std::cerr << "[GlbLoader] failed: " << err << "\n";
         return false;
     }
+    return true;
+}
 
-    parent->UpdateLocalTransform();
-    parent->UpdateWorldTransform();
-
+std::vector<int> GlbLoader::GetSceneRoots(const tinygltf::Model& model) {
     int sceneIndex = model.defaultScene >= 0 ? model.defaultScene : 0;
 
-    auto attach_roots = [&](const tinygltf::Scene& s){
-        for (int root : s.nodes) {
-            auto node = BuildNodeRecursive(model, root, path);
-            if (node) parent->AddChild(node);
-        }
-    };
-
+    std::vector<int> roots;
     if (sceneIndex >= 0 && sceneIndex < (int)model.scenes.size()) {
-        attach_roots(model.scenes[sceneIndex]);
+        roots = model.scenes[sceneIndex].nodes;
     } else {
         // No scene: attach all nodes
-        tinygltf::Scene fake;
-        fake.nodes.resize(model.nodes.size());
-        for (int i = 0; i < (int)model.nodes.size(); ++i) fake.nodes[i] = i;
-        attach_roots(fake);
+        roots.resize(model.nodes.size());
+        for (int i = 0; i < (int)model.nodes.size(); ++i) roots[i] = i;
+    }
+    return roots;
+}
+
+// ---------- LoadFile ----------
+bool GlbLoader::LoadFile(const std::string& path, const std::shared_ptr<SceneNode>& parent) {
+    if (!parent) {
+        std::cerr << "[GlbLoader] parent is null\n";
+        return false;
+    }
+
+    tinygltf::Model model;
+    auto parseStart = std::chrono::steady_clock::now();
+    if (!ParseFile(path, model, this->parallelDecode)) {
+        return false;
+    }
+    const double parseMs = MsSince(parseStart);
+
+    parent->UpdateLocalTransform();
+    parent->UpdateWorldTransform();
+
+    ClearCaches();
+    this->stats = GlbLoadStats{};
+    this->stats.parseMs = parseMs;
+
+    std::vector<int> roots = GetSceneRoots(model);
+    std::vector<std::string> meshDependencies;
+    if (this->useMeshCache) {
+        meshDependencies = GetBufferFiles(model, path);
+        this->diskCache = MeshCache::Open(path, meshDependencies);
+    }
+
+    if (this->parallelDecode) {
+        this->stats.decodeThreads = ThreadPool::Get().GetThreadCount();
+        DecodeImagesParallel(model, path);
+        PreloadMeshesParallel(model, roots);
+    }
+
+    for (int root : roots) {
+        auto node = BuildNodeRecursive(model, root, path);
+        if (node) parent->AddChild(node);
     }
+
+    // Cold start: bake what was decoded for the next run
+    if (this->useMeshCache && !this->diskCache) {
+        MeshCache::Write(path, meshDependencies, GetDecodedMeshes());
+    }
+    ApplyMeshResidency();
+
+    PrintStats();
+
+    // Drop the cache references, the scene owns the resources now
+    ClearCaches();
     return true;
 }
 
+void GlbLoader::ClearCaches() {
+    this->diskCache.reset(); // mapped meshes keep the file mapped themselves
+    this->meshCache.clear();
+    this->materialCache.clear();
+    this->textureCache.clear();
+}
+
+void GlbLoader::PrintStats() const {
+    std::cerr << "[GlbLoader] meshes " << this->stats.meshesLoaded << " loaded (" << this->stats.meshesFromCache
+              << " from mesh cache) / " << this->stats.meshesReused << " reused"
+              << ", materials " << this->stats.materialsLoaded << " / " << this->stats.materialsReused
+              << ", textures " << this->stats.texturesLoaded << " / " << this->stats.texturesReused
+              << ", saved " << (this->stats.vramBytesSaved / (1024.0 * 1024.0)) << " MB VRAM, "
+              << this->stats.msSaved << " ms\n";
+    std::cerr << "[GlbLoader] parse " << this->stats.parseMs << " ms, decode images " << this->stats.imageDecodeMs
+              << " ms (" << this->stats.imagesDecoded << "), cook textures " << this->stats.textureCookMs
+              << " ms (" << this->stats.texturesCooked << "), meshes " << this->stats.meshDecodeMs << " ms on "
+              << std::max(this->stats.decodeThreads, 1u) << " threads, upload meshes " << this->stats.meshUploadMs
+              << " ms, textures " << this->stats.textureUploadMs << " ms\n";
+    if (this->stats.meshOptimize.meshes) this->stats.meshOptimize.Print(std::cerr, "GlbLoader");
+}
+
 // ---------- BuildNodeRecursive ----------
 std::shared_ptr<SceneNode> GlbLoader::BuildNodeRecursive(const tinygltf::Model& model,
                                                          int nodeIndex,
@@ -168,7 +251,8 @@ std::shared_ptr<SceneNode> GlbLoader::BuildNodeRecursive(const tinygltf::Model&
             applyNodeTransform(parentNode);
         }
 
-        for (const auto& prim : gltfMesh.primitives) {
+        for (size_t primIndex = 0; primIndex < gltfMesh.primitives.size(); ++primIndex) {
+            const auto& prim = gltfMesh.primitives[primIndex];
             if (prim.mode != TINYGLTF_MODE_TRIANGLES &&
                 prim.mode != TINYGLTF_MODE_TRIANGLE_STRIP &&
                 prim.mode != TINYGLTF_MODE_TRIANGLE_FAN) {
@@ -176,14 +260,17 @@ std::shared_ptr<SceneNode> GlbLoader::BuildNodeRecursive(const tinygltf::Model&
                 continue;
             }
 
-            auto mesh = LoadMesh(model, prim);
-            auto mat  = LoadMaterial(model, prim.material, gltfPath);
-            auto node = std::make_shared<SceneNode>(mesh, mat);
-
-            // IMPORTANT: material toggles whether to use vertex tangents.
-            if (mat) {
+            std::shared_ptr<SceneNode> node;
+            if (this->deferMeshes) {
+                // GlbAsyncLoad sets mesh and material once both are on the GPU
+                node = std::make_shared<SceneNode>(nullptr, nullptr);
+                this->deferredDraws.push_back(DeferredDraw{node, n.mesh, (int)primIndex});
+            } else {
+                // Material toggles whether to use vertex tangents, so it is part of the material key
                 bool hasTangent = prim.attributes.count("TANGENT") > 0;
-                mat->SetUseVertexTangent(hasTangent);
+                auto mesh = GetOrLoadMesh(model, n.mesh, (int)primIndex);
+                auto mat  = GetOrLoadMaterial(model, prim.material, hasTangent, gltfPath);
+                node = std::make_shared<SceneNode>(mesh, mat);
             }
 
             if (!parentNode) {
@@ -208,24 +295,380 @@ std::shared_ptr<SceneNode> GlbLoader::BuildNodeRecursive(const tinygltf::Model&
     return parentNode;
 }
 
+// ---------- Resource caches ----------
+// Times are CPU-side decode + GL submission of the first load
+std::shared_ptr<Mesh> GlbLoader::GetOrLoadMesh(const tinygltf::Model& model, int meshIndex, int primitiveIndex) {
+    const uint64_t key = CacheKey(meshIndex, primitiveIndex);
+    auto it = this->meshCache.find(key);
+    if (it != this->meshCache.end() && !it->second.used) {
+        it->second.used = true;
+        this->stats.meshesLoaded++;
+        return it->second.mesh;
+    }
+    if (it != this->meshCache.end()) {
+        this->stats.meshesReused++;
+        this->stats.vramBytesSaved += it->second.bytes;
+        this->stats.msSaved += it->second.ms;
+        return it->second.mesh;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    CachedMesh entry;
+    entry.mesh = LoadMeshFromDisk(key);
+    if (!entry.mesh) {
+        entry.mesh = LoadMesh(model, model.meshes[meshIndex].primitives[primitiveIndex]);
+    }
+    entry.ms = MsSince(start);
+    entry.bytes = entry.mesh->GetGPUBytes();
+    entry.used = true;
+    this->stats.meshesLoaded++;
+    return this->meshCache.emplace(key, entry).first->second.mesh;
+}
+
+// Baked arrays of an earlier run, nullptr when the mesh cache has no entry for key
+std::shared_ptr<Mesh> GlbLoader::LoadMeshFromDisk(uint64_t key) {
+    if (!this->diskCache || !this->diskCache->Contains(key)) return nullptr;
+    auto mesh = std::make_shared<Mesh>();
+    this->diskCache->Upload(key, *mesh);
+    this->stats.meshesFromCache++;
+    this->stats.bytesUploaded += mesh->GetGPUBytes();
+    return mesh;
+}
+
+// Hand the loaded meshes over to the default residency policy
+void GlbLoader::ApplyMeshResidency() {
+    for (auto& kv : this->meshCache) {
+        if (kv.second.mesh) kv.second.mesh->SetResidency(Mesh::GetDefaultResidency());
+    }
+}
+
+// Meshes with CPU arrays (decoded this load), keyed like meshCache
+std::vector<MeshCache::Source> GlbLoader::GetDecodedMeshes() const {
+    std::vector<MeshCache::Source> sources;
+    for (const auto& kv : this->meshCache) {
+        const Mesh* mesh = kv.second.mesh.get();
+        if (!mesh || mesh->GetVertices().empty() || mesh->GetIndices().empty()) continue;
+        MeshCache::Source s;
+        s.key = kv.first;
+        s.vertices = mesh->GetVertices().data();
+        s.vertexCount = mesh->GetVertices().size();
+        s.indices = mesh->GetIndices().data();
+        s.indexCount = mesh->GetIndices().size();
+        sources.push_back(s);
+    }
+    return sources;
+}
+
+// External .bin buffers the meshes are decoded from, part of the mesh cache stamp
+std::vector<std::string> GlbLoader::GetBufferFiles(const tinygltf::Model& model, const std::string& gltfPath) {
+    std::vector<std::string> files;
+    for (const auto& buffer : model.buffers) {
+        if (buffer.uri.empty() || buffer.uri.compare(0, 5, "data:") == 0) continue;
+        files.push_back(DirOf(gltfPath) + "/" + buffer.uri);
+    }
+    return files;
+}
+
+// Collects the distinct (mesh, primitive) pairs the node walk will ask for, decodes
+// them on the pool and uploads them here. Each decode writes only its own slot.
+void GlbLoader::PreloadMeshesParallel(const tinygltf::Model& model, const std::vector<int>& roots) {
+    struct PendingPrimitive {
+        int mesh = -1, primitive = -1;
+        std::vector<Vertex> vertices;
+        std::vector<unsigned int> indices;
+        MeshOptimizeStats optimize;
+        bool decoded = false;
+        double ms = 0.0;
+    };
+    std::vector<PendingPrimitive> pending;
+
+    std::vector<char> visited(model.nodes.size(), 0);
+    std::vector<int> stack(roots.rbegin(), roots.rend());
+    while (!stack.empty()) {
+        int nodeIndex = stack.back();
+        stack.pop_back();
+        if (nodeIndex < 0 || nodeIndex >= (int)model.nodes.size() || visited[nodeIndex]) continue;
+        visited[nodeIndex] = 1;
+
+        const auto& n = model.nodes[nodeIndex];
+        if (n.mesh >= 0 && n.mesh < (int)model.meshes.size()) {
+            const auto& gltfMesh = model.meshes[n.mesh];
+            for (size_t primIndex = 0; primIndex < gltfMesh.primitives.size(); ++primIndex) {
+                const int mode = gltfMesh.primitives[primIndex].mode;
+                if (mode != TINYGLTF_MODE_TRIANGLES &&
+                    mode != TINYGLTF_MODE_TRIANGLE_STRIP &&
+                    mode != TINYGLTF_MODE_TRIANGLE_FAN) continue;
+                const uint64_t key = CacheKey(n.mesh, (int)primIndex);
+                if (this->meshCache.count(key)) continue;
+                if (this->diskCache && this->diskCache->Contains(key)) continue; // GetOrLoadMesh maps it
+                this->meshCache.emplace(key, CachedMesh{});
+                PendingPrimitive p;
+                p.mesh = n.mesh;
+                p.primitive = (int)primIndex;
+                pending.push_back(std::move(p));
+            }
+        }
+        for (auto it = n.children.rbegin(); it != n.children.rend(); ++it) stack.push_back(*it);
+    }
+    if (pending.empty()) return;
+
+    auto decodeStart = std::chrono::steady_clock::now();
+    ThreadPool::Get().ParallelFor(pending.size(), [&](size_t i) {
+        auto start = std::chrono::steady_clock::now();
+        PendingPrimitive& p = pending[i];
+        p.decoded = DecodePrimitive(model, model.meshes[p.mesh].primitives[p.primitive], p.vertices, p.indices,
+                                    &p.optimize);
+        p.ms = MsSince(start);
+    });
+    this->stats.meshDecodeMs = MsSince(decodeStart);
+
+    auto uploadStart = std::chrono::steady_clock::now();
+    for (PendingPrimitive& p : pending) {
+        auto start = std::chrono::steady_clock::now();
+        CachedMesh& entry = this->meshCache[CacheKey(p.mesh, p.primitive)];
+        entry.mesh = std::make_shared<Mesh>();
+        if (p.decoded) {
+            UploadMesh(entry.mesh, p.vertices, p.indices, &p.optimize);
+        }
+        entry.bytes = entry.mesh->GetGPUBytes();
+        entry.ms = p.ms + MsSince(start);
+    }
+    this->stats.meshUploadMs = MsSince(uploadStart);
+}
+
+// Same result as tinygltf's default loader: 8 bit RGBA. stb_image keeps no shared
+// state apart from the global flip flag, which is only read here.
+bool GlbLoader::DecodeImage(tinygltf::Image& img) {
+    int w = 0, h = 0, comp = 0;
+    unsigned char* data = stbi_load_from_memory(img.image.data(), (int)img.image.size(), &w, &h, &comp, 4);
+    if (!data) {
+        img.image.clear();
+        img.width = img.height = 0;
+        return false;
+    }
+    img.width = w;
+    img.height = h;
+    img.component = 4;
+    img.bits = 8;
+    img.pixel_type = TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE;
+    img.image.assign(data, data + (size_t)w * h * 4);
+    stbi_image_free(data);
+    return true;
+}
+
+void GlbLoader::DecodeImagesParallel(tinygltf::Model& model, const std::string& gltfPath) {
+    std::vector<std::vector<TextureUsage>> toCook;
+    const std::vector<char> cooked = GetCookedImages(model, gltfPath, &toCook);
+    std::vector<int> pending;
+    for (int i = 0; i < (int)model.images.size(); ++i) {
+        const auto& img = model.images[i];
+        if (img.component < 0 && !img.image.empty() && !cooked[i]) pending.push_back(i);
+    }
+    if (pending.empty()) return;
+
+    // Each task cooks its own image serially, the pool is already busy with the others
+    std::vector<char> failed(pending.size(), 0);
+    std::vector<uint32_t> cookedFiles(pending.size(), 0);
+    std::vector<double> cookMs(pending.size(), 0.0);
+    auto decodeStart = std::chrono::steady_clock::now();
+    ThreadPool::Get().ParallelFor(pending.size(), [&](size_t i) {
+        failed[i] = DecodeImage(model.images[pending[i]]) ? 0 : 1;
+        if (!failed[i] && !toCook[pending[i]].empty()) {
+            auto cookStart = std::chrono::steady_clock::now();
+            cookedFiles[i] = CookImage(model, pending[i], gltfPath, toCook[pending[i]]);
+            cookMs[i] = MsSince(cookStart);
+        }
+    });
+    this->stats.imageDecodeMs = MsSince(decodeStart);
+    for (size_t i = 0; i < pending.size(); ++i) {
+        this->stats.texturesCooked += cookedFiles[i];
+        this->stats.textureCookMs += cookMs[i];
+    }
+
+    for (size_t i = 0; i < pending.size(); ++i) {
+        if (failed[i]) {
+            std::cerr << "[GlbLoader] cannot decode image[" << pending[i] << "] \""
+                      << model.images[pending[i]].name << "\"\n";
+        } else {
+            this->stats.imagesDecoded++;
+        }
+    }
+}
+
+std::shared_ptr<PBRMaterial> GlbLoader::GetOrLoadMaterial(const tinygltf::Model& model, int materialIndex,
+                                                          bool hasTangent, const std::string& gltfPath) {
+    const uint64_t key = CacheKey(materialIndex, hasTangent ? 1 : 0);
+    auto it = this->materialCache.find(key);
+    if (it != this->materialCache.end()) {
+        this->stats.materialsReused++;
+        this->stats.msSaved += it->second.ms;
+        return it->second.material;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    CachedMaterial entry;
+    entry.material = LoadMaterial(model, materialIndex, gltfPath);
+    entry.material->SetUseVertexTangent(hasTangent);
+    entry.ms = MsSince(start);
+    this->stats.materialsLoaded++;
+    return this->materialCache.emplace(key, entry).first->second.material;
+}
+
+// Keyed by image rather than texture, glTF textures often point at the same image.
+// Sampler state is not applied by CreateFromPixels, so it is not part of the key.
+// The usage is: an ORM image is cooked once as AO (BC4) and once as roughness/metal (BC1).
+std::shared_ptr<Texture2D> GlbLoader::GetOrLoadTexture(const tinygltf::Model& model, int texIndex, TextureUsage usage,
+                                                       const std::string& gltfPath) {
+    if (texIndex < 0 || texIndex >= (int)model.textures.size()) return nullptr;
+    const int imageIndex = model.textures[texIndex].source;
+    if (imageIndex < 0 || imageIndex >= (int)model.images.size()) return nullptr;
+
+    const uint64_t key = CacheKey(imageIndex, static_cast<int>(usage));
+    auto it = this->textureCache.find(key);
+    if (it != this->textureCache.end()) {
+        if (it->second.texture) {
+            this->stats.texturesReused++;
+            this->stats.vramBytesSaved += it->second.bytes;
+            this->stats.msSaved += it->second.ms;
+        }
+        return it->second.texture;
+    }
+
+    CachedTexture entry;
+    const auto& img = model.images[imageIndex];
+    std::string sourcePath, subKey;
+    GetImageSource(model, imageIndex, gltfPath, sourcePath, subKey);
+    // Left encoded because its cooked texture is fresh (GetCookedImages)
+    const bool cooked = img.component < 0 && !img.image.empty();
+    if (!cooked && (img.image.empty() || img.width <= 0 || img.height <= 0)) {
+        // remembered as missing so the warning path runs once per image
+    } else if (!cooked && img.pixel_type != TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE) {
+        std::cerr << "[GlbLoader] unsupported pixel_type=" << img.pixel_type << " (expect UBYTE)\n";
+    } else {
+        auto start = std::chrono::steady_clock::now();
+        entry.texture = std::make_shared<Texture2D>();
+        entry.texture->CreateFromPixelsCooked(cooked ? nullptr : img.image.data(), img.width, img.height,
+                                              img.component, usage, sourcePath, subKey);
+        entry.ms = MsSince(start);
+        this->stats.textureUploadMs += entry.ms;
+        entry.bytes = entry.texture->GetGPUBytes();
+        this->stats.bytesUploaded += entry.bytes;
+        this->stats.texturesLoaded++;
+    }
+    return this->textureCache.emplace(key, entry).first->second.texture;
+}
+
+void GlbLoader::GetImageSource(const tinygltf::Model& model, int imageIndex, const std::string& gltfPath,
+                               std::string& sourcePath, std::string& subKey) {
+    const std::string& uri = model.images[imageIndex].uri;
+    if (!uri.empty() && uri.compare(0, 5, "data:") != 0) {
+        sourcePath = DirOf(gltfPath) + "/" + uri;
+        subKey.clear();
+    } else {
+        sourcePath = gltfPath;
+        subKey = "image" + std::to_string(imageIndex);
+    }
+}
+
+std::vector<char> GlbLoader::GetCookedImages(const tinygltf::Model& model, const std::string& gltfPath,
+                                             std::vector<std::vector<TextureUsage>>* toCook) {
+    std::vector<char> used(model.images.size(), 0), stale(model.images.size(), 0);
+    if (toCook) toCook->assign(model.images.size(), {});
+    if (!Texture2D::GetCookTextures()) return used;
+    for (const auto& m : model.materials) {
+        const std::pair<int, TextureUsage> textures[] = {
+            { m.pbrMetallicRoughness.baseColorTexture.index,         TextureUsage::Color },
+            { m.normalTexture.index,                                 TextureUsage::Normal },
+            { m.pbrMetallicRoughness.metallicRoughnessTexture.index, TextureUsage::Data },
+            { m.occlusionTexture.index,                              TextureUsage::Mask },
+            { m.emissiveTexture.index,                               TextureUsage::Color },
+        };
+        for (const auto& texture : textures) {
+            if (texture.first < 0 || texture.first >= (int)model.textures.size()) continue;
+            const int image = model.textures[texture.first].source;
+            if (image < 0 || image >= (int)model.images.size()) continue;
+            used[image] = 1;
+            std::string sourcePath, subKey;
+            GetImageSource(model, image, gltfPath, sourcePath, subKey);
+            if (!Texture2D::SupportsCookedFormat(texture.second)) {
+                stale[image] = 1;
+            } else if (!TextureCooker::IsFresh(TextureCooker::GetCachePath(sourcePath, subKey, texture.second, false), sourcePath)) {
+                stale[image] = 1;
+                if (toCook && std::find((*toCook)[image].begin(), (*toCook)[image].end(), texture.second) == (*toCook)[image].end()) {
+                    (*toCook)[image].push_back(texture.second);
+                }
+            }
+        }
+    }
+    for (size_t i = 0; i < used.size(); ++i) {
+        used[i] = used[i] && !stale[i];
+    }
+    return used;
+}
+
+uint32_t GlbLoader::CookImage(const tinygltf::Model& model, int imageIndex, const std::string& gltfPath,
+                              const std::vector<TextureUsage>& usages) {
+    const auto& img = model.images[imageIndex];
+    if (img.image.empty() || img.width <= 0 || img.height <= 0 || img.component < 1 ||
+        img.pixel_type != TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE) {
+        return 0;
+    }
+    std::string sourcePath, subKey;
+    GetImageSource(model, imageIndex, gltfPath, sourcePath, subKey);
+    uint32_t written = 0;
+    for (TextureUsage usage : usages) {
+        const std::string cachePath = TextureCooker::GetCachePath(sourcePath, subKey, usage, false);
+        if (TextureCooker::Cook(img.image.data(), img.width, img.height, img.component, usage, cachePath,
+                                nullptr, false)) {
+            written++;
+        }
+    }
+    return written;
+}
+
 // ---------- LoadMesh ----------
 std::shared_ptr<Mesh> GlbLoader::LoadMesh(const tinygltf::Model& model,
                                           const tinygltf::Primitive& primitive) {
     auto mesh = std::make_shared<Mesh>();
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    if (DecodePrimitive(model, primitive, vertices, indices)) {
+        UploadMesh(mesh, vertices, indices);
+    }
+    return mesh;
+}
 
+// GL upload, context thread only
+void GlbLoader::UploadMesh(const std::shared_ptr<Mesh>& mesh, std::vector<Vertex>& vertices,
+                           std::vector<unsigned int>& indices, const MeshOptimizeStats* optimized) {
+    mesh->SetVertices(std::move(vertices));
+    mesh->SetIndices(std::move(indices));
+    if (optimized && optimized->meshes) mesh->MarkOptimized(*optimized);
+    // A cold start bakes the CPU arrays at the end of the load, ApplyMeshResidency releases them then
+    if (this->useMeshCache && !this->diskCache) mesh->SetResidency(MeshResidency::Keep);
+    mesh->SetupBuffers(); // Make sure you enabled layout 3/4 for tangent/bitangent in Mesh::SetupBuffers.
+    this->stats.bytesUploaded += mesh->GetGPUBytes();
+    if (mesh->IsOptimized()) this->stats.meshOptimize.Add(mesh->GetOptimizeStats());
+}
+
+// ---------- DecodePrimitive ----------
+// CPU only (reads the model, writes the output arrays), safe to run on worker threads
+bool GlbLoader::DecodePrimitive(const tinygltf::Model& model, const tinygltf::Primitive& primitive,
+                                std::vector<Vertex>& vertices, std::vector<unsigned int>& indices,
+                                MeshOptimizeStats* optimizeStats) {
     // POSITION (required, VEC3 float)
     if (!primitive.attributes.count("POSITION")) {
         std::cerr << "[GlbLoader] primitive missing POSITION\n";
-        return mesh;
+        return false;
     }
     const auto& posAcc = model.accessors.at(primitive.attributes.at("POSITION"));
     if (posAcc.type != TINYGLTF_TYPE_VEC3 || posAcc.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT) {
         std::cerr << "[GlbLoader] POSITION must be VEC3 float\n";
-        return mesh;
+        return false;
     }
 
     // Prepare vertices
-    std::vector<Vertex> vertices(posAcc.count);
+    vertices.assign(posAcc.count, Vertex{});
     for (size_t i=0; i<posAcc.count; ++i) {
         const float* p = reinterpret_cast<const float*>(AccessorElemPtr(model, posAcc, i));
         vertices[i].position = glm::vec3(p[0], p[1], p[2]);
@@ -302,7 +745,7 @@ std::shared_ptr<Mesh> GlbLoader::LoadMesh(const tinygltf::Model& model,
     }
 
     // Indices (convert strip/fan to triangles if needed)
-    std::vector<unsigned int> indices;
+    indices.clear();
     if (primitive.indices >= 0) {
         const auto& idxAcc = model.accessors[primitive.indices];
         const auto& idxBV  = model.bufferViews[idxAcc.bufferView];
@@ -396,18 +839,32 @@ std::shared_ptr<Mesh> GlbLoader::LoadMesh(const tinygltf::Model& model,
         if (hasTangent) FillBitangentsFromTangentW(vertices, 1.0f);
     }
 
-    // Upload to your Mesh
-    mesh->SetVertices(std::move(vertices));
-    mesh->SetIndices(std::move(indices));
-    mesh->SetupBuffers(); // Make sure you enabled layout 3/4 for tangent/bitangent in Mesh::SetupBuffers.
+    if (optimizeStats && Mesh::GetOptimizeOnUpload()) {
+        *optimizeStats = OptimizeMesh(vertices, indices);
+    }
 
-    return mesh;
+    return true;
 }
 
 // ---------- LoadMaterial ----------
+// Images LoadMaterial reads, in the same order
+void GlbLoader::GetMaterialImages(const tinygltf::Model& model, int materialIndex, std::vector<int>& out) {
+    if (materialIndex < 0 || materialIndex >= (int)model.materials.size()) return;
+    const auto& m = model.materials[materialIndex];
+    const int texIndices[] = {
+        m.pbrMetallicRoughness.baseColorTexture.index, m.normalTexture.index,
+        m.pbrMetallicRoughness.metallicRoughnessTexture.index, m.occlusionTexture.index, m.emissiveTexture.index
+    };
+    for (int t : texIndices) {
+        if (t < 0 || t >= (int)model.textures.size()) continue;
+        const int image = model.textures[t].source;
+        if (image >= 0 && image < (int)model.images.size()) out.push_back(image);
+    }
+}
+
 std::shared_ptr<PBRMaterial> GlbLoader::LoadMaterial(const tinygltf::Model& model,
                                                      int materialIndex,
-                                                     const std::string& /*gltfPath*/) {
+                                                     const std::string& gltfPath) {
     auto mat = std::make_shared<PBRMaterial>();
     if (materialIndex < 0 || materialIndex >= (int)model.materials.size()) return mat;
 
@@ -438,28 +895,17 @@ std::shared_ptr<PBRMaterial> GlbLoader::LoadMaterial(const tinygltf::Model& mode
         ));
     }
 
-    // ---- Helper: build Texture2D from embedded image ----
-    auto makeTex = [&](int texIndex, bool isSRGB) -> std::shared_ptr<Texture2D> {
-        if (texIndex < 0) return nullptr;
-        const auto& tex = model.textures[texIndex];
-        if (tex.source < 0 || tex.source >= (int)model.images.size()) return nullptr;
-        const auto& img = model.images[tex.source];
-        if (img.image.empty() || img.width <= 0 || img.height <= 0) return nullptr;
-        if (img.pixel_type != TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE) {
-            std::cerr << "[GlbLoader] unsupported pixel_type=" << img.pixel_type << " (expect UBYTE)\n";
-            return nullptr;
-        }
-        auto t = std::make_shared<Texture2D>();
-        t->CreateFromPixels(img.image.data(), img.width, img.height, img.component, isSRGB);
-        return t;
+    // ---- Helper: Texture2D from embedded image, shared through the per-load cache ----
+    auto makeTex = [&](int texIndex, TextureUsage usage) -> std::shared_ptr<Texture2D> {
+        return this->GetOrLoadTexture(model, texIndex, usage, gltfPath);
     };
 
-    // ---- Textures (PBR color space conventions) ----
-    if (auto t = makeTex(pmr.baseColorTexture.index,           /*sRGB*/ true )) mat->SetAlbedoMap(t);
-    if (auto t = makeTex(m.normalTexture.index,                /*sRGB*/ false)) mat->SetNormalMap(t);
-    if (auto t = makeTex(pmr.metallicRoughnessTexture.index,   /*sRGB*/ false)) mat->SetRoughnessMetalMap(t); // G: roughness, B: metallic
-    if (auto t = makeTex(m.occlusionTexture.index,             /*sRGB*/ false)) mat->SetAOMap(t);
-    if (auto t = makeTex(m.emissiveTexture.index,              /*sRGB*/ true )) mat->SetEmissiveMap(t);
+    // ---- Textures (PBR color space conventions, Color is sRGB) ----
+    if (auto t = makeTex(pmr.baseColorTexture.index,           TextureUsage::Color )) mat->SetAlbedoMap(t);
+    if (auto t = makeTex(m.normalTexture.index,                TextureUsage::Normal)) mat->SetNormalMap(t);
+    if (auto t = makeTex(pmr.metallicRoughnessTexture.index,   TextureUsage::Data  )) mat->SetRoughnessMetalMap(t); // G: roughness, B: metallic
+    if (auto t = makeTex(m.occlusionTexture.index,             TextureUsage::Mask  )) mat->SetAOMap(t);
+    if (auto t = makeTex(m.emissiveTexture.index,              TextureUsage::Color )) mat->SetEmissiveMap(t);
 
     // glTF normalTexture.scale (default 1.0)
     mat->SetNormalScale(m.normalTexture.scale > 0.0 ? (float)m.normalTexture.scale : 1.0f);
@@ -0,0 +1,269 @@
+#include "model_loader/mesh_cache.h"
+#include "config.h"
+#include "vertex_format.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+namespace fs = std::filesystem;
+
+// File layout: Header, Entry[meshCount] sorted by key, then the vertex, index,
+// compact vertex and uint16 index arrays, each starting on a BLOB_ALIGN boundary.
+// Native byte order.
+struct MeshCache::Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t vertexStride;      // sizeof(Vertex) of the writer
+    uint32_t byteOrder;         // BYTE_ORDER_TAG as the writer stored it
+    uint32_t meshCount;
+    uint64_t stamp;             // source and dependency path/size/mtime hash
+    uint64_t fileSize;
+};
+
+struct MeshCache::Entry {
+    uint64_t key;
+    uint64_t vertexOffset;
+    uint64_t indexOffset;
+    uint64_t compactOffset;     // CompactVertex[vertexCount]
+    uint64_t narrowIndexOffset; // uint16_t[indexCount], 0 when an index needs 32 bits
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    float dequantScale[3];
+    float dequantOffset[3];
+    float boundsMin[3];
+    float boundsMax[3];
+};
+
+static const char MAGIC[8] = {'P', 'B', 'R', 'M', 'E', 'S', 'H', '\0'};
+static const uint32_t BYTE_ORDER_TAG = 0x01020304u;
+static const uint64_t BLOB_ALIGN = 16;
+
+static uint64_t Fnv1a(uint64_t hash, const void* data, size_t size) {
+    const unsigned char* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+static const uint64_t FNV_OFFSET = 14695981039346656037ull;
+
+static uint64_t AlignUp(uint64_t v) {
+    return (v + BLOB_ALIGN - 1) & ~(BLOB_ALIGN - 1);
+}
+
+std::string MeshCache::GetCachePath(const std::string& sourcePath, const std::string& variant) {
+    uint64_t hash = Fnv1a(FNV_OFFSET, sourcePath.data(), sourcePath.size());
+    if (!variant.empty()) {
+        hash = Fnv1a(hash, "#", 1);
+        hash = Fnv1a(hash, variant.data(), variant.size());
+    }
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.meshcache", (unsigned long long)hash);
+    return (fs::path(MESH_CACHE_DIR) / name).string();
+}
+
+// Path, size and mtime of every file the meshes were built from. Contents are not
+// hashed, reading them is what the cache is there to avoid.
+bool MeshCache::GetStamp(const std::string& sourcePath, const std::vector<std::string>& dependencies,
+                         uint64_t& stamp) {
+    stamp = FNV_OFFSET;
+    std::error_code ec;
+    auto add = [&](const std::string& path) {
+        const uint64_t fileSize = fs::file_size(path, ec);
+        if (ec) return false;
+        const int64_t mtime = (int64_t)fs::last_write_time(path, ec).time_since_epoch().count();
+        if (ec) return false;
+        stamp = Fnv1a(stamp, path.data(), path.size());
+        stamp = Fnv1a(stamp, &fileSize, sizeof(fileSize));
+        stamp = Fnv1a(stamp, &mtime, sizeof(mtime));
+        return true;
+    };
+    if (!add(sourcePath)) return false;
+    for (const std::string& dep : dependencies) {
+        if (!add(dep)) return false;
+    }
+    return true;
+}
+
+std::shared_ptr<MeshCache> MeshCache::Open(const std::string& sourcePath,
+                                           const std::vector<std::string>& dependencies,
+                                           const std::string& variant) {
+    uint64_t stamp = 0;
+    if (!GetStamp(sourcePath, dependencies, stamp)) return nullptr;
+
+    const std::string path = GetCachePath(sourcePath, variant);
+    std::shared_ptr<MeshCache> cache(new MeshCache());
+    if (!cache->file.Open(path) || cache->file.GetSize() < sizeof(Header)) {
+        return nullptr;
+    }
+    cache->data = cache->file.GetData();
+    cache->size = cache->file.GetSize();
+    const size_t size = cache->size;
+
+    Header header;
+    std::memcpy(&header, cache->data, sizeof(Header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION ||
+        header.vertexStride != sizeof(Vertex) || header.byteOrder != BYTE_ORDER_TAG ||
+        header.fileSize != size || header.stamp != stamp ||
+        sizeof(Header) + (uint64_t)header.meshCount * sizeof(Entry) > size) {
+        return nullptr; // stale or foreign, rebuilt by the caller
+    }
+
+    cache->entries = reinterpret_cast<const Entry*>(cache->data + sizeof(Header));
+    cache->entryCount = header.meshCount;
+    for (size_t i = 0; i < cache->entryCount; ++i) {
+        const Entry& e = cache->entries[i];
+        if (e.vertexOffset + (uint64_t)e.vertexCount * sizeof(Vertex) > size ||
+            e.indexOffset + (uint64_t)e.indexCount * sizeof(unsigned int) > size ||
+            e.compactOffset + (uint64_t)e.vertexCount * sizeof(CompactVertex) > size ||
+            e.narrowIndexOffset + (uint64_t)e.indexCount * sizeof(uint16_t) > size) {
+            std::cerr << "[MeshCache] truncated cache: " << path << "\n";
+            return nullptr;
+        }
+    }
+
+    // Pages are read on first touch; tell the kernel the whole file is coming
+    cache->file.AdviseWillNeed();
+    return cache;
+}
+
+const MeshCache::Entry* MeshCache::Find(uint64_t key) const {
+    const Entry* end = this->entries + this->entryCount;
+    const Entry* it = std::lower_bound(this->entries, end, key,
+                                       [](const Entry& e, uint64_t k) { return e.key < k; });
+    return (it != end && it->key == key) ? it : nullptr;
+}
+
+bool MeshCache::Contains(uint64_t key) const {
+    return this->Find(key) != nullptr;
+}
+
+bool MeshCache::Upload(uint64_t key, Mesh& mesh) const {
+    const Entry* e = this->Find(key);
+    if (!e) return false;
+    const Vertex* vertices = reinterpret_cast<const Vertex*>(this->data + e->vertexOffset);
+    const unsigned int* indices = reinterpret_cast<const unsigned int*>(this->data + e->indexOffset);
+    MeshGPUArrays gpuArrays;
+    gpuArrays.compactVertices = reinterpret_cast<const CompactVertex*>(this->data + e->compactOffset);
+    if (e->narrowIndexOffset) {
+        gpuArrays.narrowIndices = reinterpret_cast<const uint16_t*>(this->data + e->narrowIndexOffset);
+    }
+    gpuArrays.dequantScale = glm::vec3(e->dequantScale[0], e->dequantScale[1], e->dequantScale[2]);
+    gpuArrays.dequantOffset = glm::vec3(e->dequantOffset[0], e->dequantOffset[1], e->dequantOffset[2]);
+    gpuArrays.boundsMin = glm::vec3(e->boundsMin[0], e->boundsMin[1], e->boundsMin[2]);
+    gpuArrays.boundsMax = glm::vec3(e->boundsMax[0], e->boundsMax[1], e->boundsMax[2]);
+    mesh.SetupBuffersExternal(shared_from_this(), vertices, e->vertexCount, indices, e->indexCount, &gpuArrays);
+    return true;
+}
+
+// Written to a temporary file and renamed, so a reader never maps a partial cache
+bool MeshCache::Write(const std::string& sourcePath, const std::vector<std::string>& dependencies,
+                      const std::vector<Source>& meshes, const std::string& variant) {
+    uint64_t stamp = 0;
+    if (!GetStamp(sourcePath, dependencies, stamp)) return false;
+
+    std::vector<Source> sorted(meshes);
+    std::sort(sorted.begin(), sorted.end(), [](const Source& a, const Source& b) { return a.key < b.key; });
+
+    Header header;
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.vertexStride = sizeof(Vertex);
+    header.byteOrder = BYTE_ORDER_TAG;
+    header.meshCount = (uint32_t)sorted.size();
+    header.stamp = stamp;
+
+    // Packed once here, warm uploads send the stored arrays as they are
+    std::vector<Entry> entries(sorted.size());
+    std::vector<std::vector<CompactVertex>> compact(sorted.size());
+    std::vector<std::vector<uint16_t>> narrow(sorted.size());
+    uint64_t offset = AlignUp(sizeof(Header) + entries.size() * sizeof(Entry));
+    for (size_t i = 0; i < sorted.size(); ++i) {
+        const Source& src = sorted[i];
+        Entry& e = entries[i];
+        e.key = src.key;
+        e.vertexCount = (uint32_t)src.vertexCount;
+        e.indexCount = (uint32_t)src.indexCount;
+
+        glm::vec3 scale, bias;
+        PackCompactVertices(src.vertices, src.vertexCount, compact[i], scale, bias);
+        glm::vec3 lo = src.vertexCount > 0 ? src.vertices[0].position : glm::vec3(0.0f), hi = lo;
+        for (size_t v = 1; v < src.vertexCount; ++v) {
+            lo = glm::min(lo, src.vertices[v].position);
+            hi = glm::max(hi, src.vertices[v].position);
+        }
+        const unsigned int* srcEnd = src.indices + src.indexCount;
+        if (src.indexCount > 0 && *std::max_element(src.indices, srcEnd) <= 0xFFFFu) {
+            narrow[i].assign(src.indices, srcEnd);
+        }
+        for (int c = 0; c < 3; ++c) {
+            e.dequantScale[c] = scale[c];
+            e.dequantOffset[c] = bias[c];
+            e.boundsMin[c] = lo[c];
+            e.boundsMax[c] = hi[c];
+        }
+
+        e.vertexOffset = offset;
+        offset = AlignUp(offset + src.vertexCount * sizeof(Vertex));
+        e.indexOffset = offset;
+        offset = AlignUp(offset + src.indexCount * sizeof(unsigned int));
+        e.compactOffset = offset;
+        offset = AlignUp(offset + src.vertexCount * sizeof(CompactVertex));
+        if (!narrow[i].empty()) {
+            e.narrowIndexOffset = offset;
+            offset = AlignUp(offset + narrow[i].size() * sizeof(uint16_t));
+        }
+    }
+    header.fileSize = offset;
+
+    const std::string path = GetCachePath(sourcePath, variant);
+    const std::string tmpPath = path + ".tmp";
+    std::error_code ec;
+    fs::create_directories(fs::path(path).parent_path(), ec);
+
+    std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::cerr << "[MeshCache] cannot write " << tmpPath << "\n";
+        return false;
+    }
+    static const char zeros[BLOB_ALIGN] = {};
+    uint64_t written = 0;
+    auto put = [&](const void* bytes, uint64_t count) {
+        out.write(static_cast<const char*>(bytes), (std::streamsize)count);
+        written += count;
+    };
+    auto pad = [&]() { put(zeros, AlignUp(written) - written); };
+
+    put(&header, sizeof(Header));
+    put(entries.data(), entries.size() * sizeof(Entry));
+    pad();
+    for (size_t i = 0; i < sorted.size(); ++i) {
+        const Source& s = sorted[i];
+        put(s.vertices, s.vertexCount * sizeof(Vertex));
+        pad();
+        put(s.indices, s.indexCount * sizeof(unsigned int));
+        pad();
+        put(compact[i].data(), compact[i].size() * sizeof(CompactVertex));
+        pad();
+        put(narrow[i].data(), narrow[i].size() * sizeof(uint16_t));
+        pad();
+    }
+    out.close();
+    if (!out || written != header.fileSize) {
+        std::cerr << "[MeshCache] write failed: " << tmpPath << "\n";
+        fs::remove(tmpPath, ec);
+        return false;
+    }
+
+    fs::rename(tmpPath, path, ec);
+    if (ec) {
+        std::cerr << "[MeshCache] rename failed: " << path << "\n";
+        fs::remove(tmpPath, ec);
+        return false;
+    }
+    return true;
+}
@@ -1,71 +1,48 @@
 #include "model_loader/ply_loader.h"
+#include "model_loader/ply_reader.h"
+#include "model_loader/mesh_cache.h"
 #include <iostream>
 
-// Assimp
-#include <assimp/Importer.hpp>
-#include <assimp/scene.h>
-#include <assimp/postprocess.h>
-
 //=================================PLY Loader==================================
-static inline glm::vec3 toGLM(const aiVector3D& v) { return {v.x, v.y, v.z}; }
-static inline glm::vec2 toGLM2(const aiVector3D& v) { return {v.x, v.y}; }
-
-
 bool LoadPLYToMesh(const std::string& path, Mesh& mesh, bool flipUVs)
 {
-    Assimp::Importer importer;
-    unsigned int flags =
-        aiProcess_Triangulate |
-        aiProcess_JoinIdenticalVertices |
-        aiProcess_GenSmoothNormals |   // use when PLY don't have normal data
-        aiProcess_CalcTangentSpace |   // generate tangent/bitangent for normal map
-        aiProcess_ImproveCacheLocality |
-        aiProcess_SortByPType;
-    if (flipUVs) flags |= aiProcess_FlipUVs;
-
-    const aiScene* scene = importer.ReadFile(path, flags);
-    if (!scene || !scene->mRootNode || scene->mNumMeshes == 0) {
-        std::cerr << "[PLYLoader] Failed to load: " << path
-                  << "  Error: " << importer.GetErrorString() << "\n";
-        return false;
+    // Warm start: the arrays an earlier run baked, uploaded straight from the mapped file.
+    // Flipped UVs are baked into a separate cache so both settings stay warm.
+    const uint64_t cacheKey = 0;
+    const std::string cacheVariant = flipUVs ? "flipUVs" : "";
+    if (auto cache = MeshCache::Open(path, {}, cacheVariant)) {
+        if (cache->Upload(cacheKey, mesh)) return true;
     }
 
-    const aiMesh* aimesh = scene->mMeshes[0];
-
     std::vector<Vertex> vertices;
     std::vector<unsigned int> indices;
 
-    vertices.resize(aimesh->mNumVertices);
-    for (unsigned i = 0; i < aimesh->mNumVertices; ++i) {
-        Vertex v{};
-        v.position = aimesh->HasPositions() ? toGLM(aimesh->mVertices[i]) : glm::vec3(0.0f);
-        v.normals  = aimesh->HasNormals()   ? toGLM(aimesh->mNormals[i])  : glm::vec3(0,1,0);
-
-        if (aimesh->HasTextureCoords(0)) v.texCoord = toGLM2(aimesh->mTextureCoords[0][i]);
-        else                            v.texCoord = glm::vec2(0.0f);
-
-        if (aimesh->HasTangentsAndBitangents()) {
-            v.tangent   = toGLM(aimesh->mTangents[i]);
-            v.bitangent = toGLM(aimesh->mBitangents[i]);
-        } else {
-            v.tangent = v.bitangent = glm::vec3(0.0f);
-        }
-
-        vertices[i] = v;
-    }
-
-    indices.reserve(aimesh->mNumFaces * 3);
-    for (unsigned f = 0; f < aimesh->mNumFaces; ++f) {
-        const aiFace& face = aimesh->mFaces[f];
-        for (unsigned j = 0; j < face.mNumIndices; ++j)
-            indices.push_back(face.mIndices[j]);
+    // Native reader first, Assimp for anything it rejects
+    PLYReadInfo info;
+    if (ReadPLY(path, vertices, indices, flipUVs, &info)) {
+        std::cout << "[PLYLoader] " << path << " (" << info.format << "): "
+                  << info.vertices << " vertices, " << info.triangles << " triangles\n";
+    } else {
+        std::cerr << "[PLYLoader] native reader failed, falling back to Assimp: " << path << "\n";
+        if (!ReadPLYAssimp(path, vertices, indices, flipUVs)) return false;
     }
 
-    // Upload vertices and indices to mesh data
-    mesh.LoadFromModel(vertices, indices);
+    // Upload vertices and indices to mesh data (SetupBuffers optimizes their order).
+    // The arrays stay until they are baked, then the mesh's residency applies.
+    const MeshResidency residency = mesh.GetResidency();
+    mesh.SetResidency(MeshResidency::Keep);
+    mesh.LoadFromModel(std::move(vertices), std::move(indices));
+    if (mesh.IsOptimized()) mesh.GetOptimizeStats().Print(std::cout, "PLYLoader");
+
+    // Bake the optimized arrays the mesh keeps
+    MeshCache::Source baked;
+    baked.key = cacheKey;
+    baked.vertices = mesh.GetVertices().data();
+    baked.vertexCount = mesh.GetVertices().size();
+    baked.indices = mesh.GetIndices().data();
+    baked.indexCount = mesh.GetIndices().size();
+    MeshCache::Write(path, {}, {baked}, cacheVariant);
+    mesh.SetResidency(residency);
 
     return true;
 }
-
-// ======================glTF Loader==============================
-
@@ -0,0 +1,583 @@
+#include "model_loader/ply_reader.h"
+#include "mapped_file.h"
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+//=================================PLY Reader==================================
+namespace {
+    enum class PlyType : uint8_t { Invalid, Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64 };
+    enum class PlyFormat { Ascii, BinaryLittleEndian, BinaryBigEndian };
+
+    // Vertex attributes the reader fills, index into PlyVertexLayout::offsets
+    enum VertexField { FieldX, FieldY, FieldZ, FieldNX, FieldNY, FieldNZ, FieldU, FieldV, FieldCount };
+
+    struct PlyProperty {
+        std::string name;
+        PlyType type = PlyType::Invalid;        // value type, element type of lists
+        PlyType countType = PlyType::Invalid;   // lists only
+        bool isList = false;
+    };
+
+    struct PlyElement {
+        std::string name;
+        uint64_t count = 0;
+        std::vector<PlyProperty> properties;
+        size_t stride = 0;                      // binary record size, 0 when the element has lists
+    };
+
+    struct PlyHeader {
+        PlyFormat format = PlyFormat::Ascii;
+        std::vector<PlyElement> elements;
+        size_t dataOffset = 0;
+    };
+
+    PlyType ParseType(const std::string& s) {
+        if (s == "char"   || s == "int8")    return PlyType::Int8;
+        if (s == "uchar"  || s == "uint8")   return PlyType::UInt8;
+        if (s == "short"  || s == "int16")   return PlyType::Int16;
+        if (s == "ushort" || s == "uint16")  return PlyType::UInt16;
+        if (s == "int"    || s == "int32")   return PlyType::Int32;
+        if (s == "uint"   || s == "uint32")  return PlyType::UInt32;
+        if (s == "float"  || s == "float32") return PlyType::Float32;
+        if (s == "double" || s == "float64") return PlyType::Float64;
+        return PlyType::Invalid;
+    }
+
+    size_t TypeSize(PlyType t) {
+        switch (t) {
+            case PlyType::Int8:    case PlyType::UInt8:   return 1;
+            case PlyType::Int16:   case PlyType::UInt16:  return 2;
+            case PlyType::Int32:   case PlyType::UInt32:  case PlyType::Float32: return 4;
+            case PlyType::Float64: return 8;
+            default: return 0;
+        }
+    }
+
+    int FieldOf(const std::string& name) {
+        if (name == "x") return FieldX;
+        if (name == "y") return FieldY;
+        if (name == "z") return FieldZ;
+        if (name == "nx") return FieldNX;
+        if (name == "ny") return FieldNY;
+        if (name == "nz") return FieldNZ;
+        if (name == "u" || name == "s" || name == "texture_u" || name == "texture_s") return FieldU;
+        if (name == "v" || name == "t" || name == "texture_v" || name == "texture_t") return FieldV;
+        return -1;
+    }
+
+    bool ParseHeader(const unsigned char* data, size_t size, PlyHeader& header, std::string& err) {
+        // The header is text up to and including the "end_header" line
+        static const char END[] = "end_header";
+        const char* text = reinterpret_cast<const char*>(data);
+        size_t endPos = std::string::npos;
+        for (size_t i = 0; i + sizeof(END) - 1 <= size && i < (1u << 20); ++i) {
+            if (text[i] == 'e' && std::memcmp(text + i, END, sizeof(END) - 1) == 0 &&
+                (i == 0 || text[i - 1] == '\n')) {
+                endPos = i;
+                break;
+            }
+        }
+        if (size < 4 || std::memcmp(text, "ply", 3) != 0 || (text[3] != '\n' && text[3] != '\r')) {
+            err = "not a PLY file";
+            return false;
+        }
+        if (endPos == std::string::npos) {
+            err = "missing end_header";
+            return false;
+        }
+        size_t dataOffset = endPos + sizeof(END) - 1;
+        while (dataOffset < size && text[dataOffset] != '\n') ++dataOffset;
+        header.dataOffset = dataOffset + 1;
+
+        std::istringstream lines(std::string(text, endPos));
+        std::string line;
+        bool hasFormat = false;
+        while (std::getline(lines, line)) {
+            std::istringstream words(line);
+            std::string keyword;
+            words >> keyword;
+            if (keyword == "format") {
+                std::string format;
+                words >> format;
+                if (format == "ascii") header.format = PlyFormat::Ascii;
+                else if (format == "binary_little_endian") header.format = PlyFormat::BinaryLittleEndian;
+                else if (format == "binary_big_endian") header.format = PlyFormat::BinaryBigEndian;
+                else { err = "unknown format " + format; return false; }
+                hasFormat = true;
+            } else if (keyword == "element") {
+                PlyElement element;
+                words >> element.name >> element.count;
+                header.elements.push_back(element);
+            } else if (keyword == "property") {
+                if (header.elements.empty()) { err = "property before element"; return false; }
+                PlyProperty prop;
+                std::string type;
+                words >> type;
+                if (type == "list") {
+                    std::string countType, itemType;
+                    words >> countType >> itemType;
+                    prop.isList = true;
+                    prop.countType = ParseType(countType);
+                    prop.type = ParseType(itemType);
+                    if (prop.countType == PlyType::Invalid || prop.countType == PlyType::Float32 ||
+                        prop.countType == PlyType::Float64) {
+                        err = "bad list count type " + countType;
+                        return false;
+                    }
+                } else {
+                    prop.type = ParseType(type);
+                }
+                if (prop.type == PlyType::Invalid) { err = "unknown property type in: " + line; return false; }
+                words >> prop.name;
+                header.elements.back().properties.push_back(prop);
+            }
+            // ply, comment, obj_info: nothing to do
+        }
+        if (!hasFormat) {
+            err = "missing format line";
+            return false;
+        }
+
+        for (PlyElement& element : header.elements) {
+            element.stride = 0;
+            bool hasList = false;
+            for (const PlyProperty& prop : element.properties) {
+                if (prop.isList) hasList = true;
+                else element.stride += TypeSize(prop.type);
+            }
+            if (hasList) element.stride = 0;
+        }
+        return true;
+    }
+
+    // ---------- binary values ----------
+    inline uint16_t Swap16(uint16_t v) { return (uint16_t)((v << 8) | (v >> 8)); }
+    inline uint32_t Swap32(uint32_t v) {
+        return ((v & 0xFFu) << 24) | ((v & 0xFF00u) << 8) | ((v >> 8) & 0xFF00u) | (v >> 24);
+    }
+    inline uint64_t Swap64(uint64_t v) {
+        return ((uint64_t)Swap32((uint32_t)v) << 32) | Swap32((uint32_t)(v >> 32));
+    }
+
+    template<typename T, typename U>
+    inline T LoadAs(const unsigned char* p, bool swap, U (*swapFn)(U)) {
+        U bits;
+        std::memcpy(&bits, p, sizeof(U));
+        if (swap) bits = swapFn(bits);
+        T value;
+        std::memcpy(&value, &bits, sizeof(T));
+        return value;
+    }
+
+    inline double ReadBinary(const unsigned char* p, PlyType t, bool swap) {
+        switch (t) {
+            case PlyType::Int8:    return (double)(int8_t)p[0];
+            case PlyType::UInt8:   return (double)p[0];
+            case PlyType::Int16:   return (double)LoadAs<int16_t>(p, swap, Swap16);
+            case PlyType::UInt16:  return (double)LoadAs<uint16_t>(p, swap, Swap16);
+            case PlyType::Int32:   return (double)LoadAs<int32_t>(p, swap, Swap32);
+            case PlyType::UInt32:  return (double)LoadAs<uint32_t>(p, swap, Swap32);
+            case PlyType::Float32: return (double)LoadAs<float>(p, swap, Swap32);
+            case PlyType::Float64: return LoadAs<double>(p, swap, Swap64);
+            default: return 0.0;
+        }
+    }
+
+    // Float properties in native order are the common case, read them without the double round trip
+    inline float ReadBinaryFloat(const unsigned char* p, PlyType t, bool swap) {
+        if (t == PlyType::Float32 && !swap) {
+            float f;
+            std::memcpy(&f, p, sizeof(float));
+            return f;
+        }
+        return (float)ReadBinary(p, t, swap);
+    }
+
+    inline int64_t ReadBinaryInt(const unsigned char* p, PlyType t, bool swap) {
+        switch (t) {
+            case PlyType::Int8:    return (int8_t)p[0];
+            case PlyType::UInt8:   return p[0];
+            case PlyType::Int16:   return LoadAs<int16_t>(p, swap, Swap16);
+            case PlyType::UInt16:  return LoadAs<uint16_t>(p, swap, Swap16);
+            case PlyType::Int32:   return LoadAs<int32_t>(p, swap, Swap32);
+            case PlyType::UInt32:  return LoadAs<uint32_t>(p, swap, Swap32);
+            default:               return (int64_t)ReadBinary(p, t, swap);
+        }
+    }
+
+    // ---------- ASCII values ----------
+    struct AsciiCursor {
+        const char* p;
+        const char* end;
+
+        bool Next(const char*& s, const char*& e) {
+            while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) ++p;
+            if (p >= end) return false;
+            s = p;
+            while (p < end && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n') ++p;
+            e = p;
+            return true;
+        }
+    };
+
+    // Decimal and exponent notation without strtod (the mapping is not null terminated)
+    double ParseNumber(const char* s, const char* e, bool& ok) {
+        const char* p = s;
+        bool negative = false;
+        if (p < e && (*p == '-' || *p == '+')) negative = (*p++ == '-');
+
+        uint64_t mantissa = 0;
+        int digits = 0, exponent = 0;
+        bool any = false;
+        for (; p < e && *p >= '0' && *p <= '9'; ++p) {
+            any = true;
+            if (digits < 19) { mantissa = mantissa * 10 + (uint64_t)(*p - '0'); if (mantissa) ++digits; }
+            else ++exponent;
+        }
+        if (p < e && *p == '.') {
+            for (++p; p < e && *p >= '0' && *p <= '9'; ++p) {
+                any = true;
+                if (digits < 19) { mantissa = mantissa * 10 + (uint64_t)(*p - '0'); if (mantissa) ++digits; --exponent; }
+            }
+        }
+        if (any && p < e && (*p == 'e' || *p == 'E')) {
+            ++p;
+            bool expNegative = false;
+            if (p < e && (*p == '-' || *p == '+')) expNegative = (*p++ == '-');
+            int value = 0;
+            for (; p < e && *p >= '0' && *p <= '9'; ++p) {
+                if (value < 10000) value = value * 10 + (*p - '0');
+            }
+            exponent += expNegative ? -value : value;
+        }
+
+        if (!any || p != e) {
+            // nan, inf or something odd: let strtod decide on a terminated copy
+            std::string token(s, e);
+            char* stop = nullptr;
+            double v = std::strtod(token.c_str(), &stop);
+            ok = stop && *stop == '\0' && !token.empty();
+            return v;
+        }
+        ok = true;
+        double v = (double)mantissa;
+        if (exponent != 0) v *= std::pow(10.0, exponent);
+        return negative ? -v : v;
+    }
+
+    // ---------- normals and tangents ----------
+    void ComputeNormals(std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices) {
+        for (Vertex& v : vertices) v.normals = glm::vec3(0.0f);
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            Vertex& a = vertices[indices[i]];
+            Vertex& b = vertices[indices[i + 1]];
+            Vertex& c = vertices[indices[i + 2]];
+            // Unnormalized cross product: larger faces weigh more
+            const glm::vec3 n = glm::cross(b.position - a.position, c.position - a.position);
+            a.normals += n;
+            b.normals += n;
+            c.normals += n;
+        }
+        for (Vertex& v : vertices) {
+            const float len2 = glm::dot(v.normals, v.normals);
+            v.normals = len2 > 0.0f ? v.normals / std::sqrt(len2) : glm::vec3(0.0f, 1.0f, 0.0f);
+        }
+    }
+
+    void ComputeTangents(std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices) {
+        for (Vertex& v : vertices) {
+            v.tangent = glm::vec3(0.0f);
+            v.bitangent = glm::vec3(0.0f);
+        }
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            Vertex& a = vertices[indices[i]];
+            Vertex& b = vertices[indices[i + 1]];
+            Vertex& c = vertices[indices[i + 2]];
+            const glm::vec3 e1 = b.position - a.position, e2 = c.position - a.position;
+            const glm::vec2 d1 = b.texCoord - a.texCoord, d2 = c.texCoord - a.texCoord;
+            const float det = d1.x * d2.y - d2.x * d1.y;
+            if (std::fabs(det) < 1e-20f) continue;
+            const float r = 1.0f / det;
+            const glm::vec3 t = (e1 * d2.y - e2 * d1.y) * r;
+            const glm::vec3 bt = (e2 * d1.x - e1 * d2.x) * r;
+            a.tangent += t;  b.tangent += t;  c.tangent += t;
+            a.bitangent += bt; b.bitangent += bt; c.bitangent += bt;
+        }
+        // Gram-Schmidt against the normal, bitangent keeps the handedness of the UVs
+        for (Vertex& v : vertices) {
+            glm::vec3 t = v.tangent - v.normals * glm::dot(v.normals, v.tangent);
+            const float len2 = glm::dot(t, t);
+            if (len2 <= 0.0f) {
+                v.tangent = v.bitangent = glm::vec3(0.0f);
+                continue;
+            }
+            t /= std::sqrt(len2);
+            const glm::vec3 b = glm::cross(v.normals, t);
+            v.tangent = t;
+            v.bitangent = glm::dot(b, v.bitangent) < 0.0f ? -b : b;
+        }
+    }
+
+    // Fan triangulation of one face, faces referencing missing vertices are dropped
+    inline void EmitFace(const unsigned int* corners, size_t count, size_t vertexCount,
+                         std::vector<unsigned int>& indices, PLYReadInfo& info) {
+        if (count < 3) { info.facesDropped++; return; }
+        for (size_t k = 0; k < count; ++k) {
+            if (corners[k] >= vertexCount) { info.facesDropped++; return; }
+        }
+        for (size_t k = 1; k + 1 < count; ++k) {
+            indices.push_back(corners[0]);
+            indices.push_back(corners[k]);
+            indices.push_back(corners[k + 1]);
+        }
+    }
+
+    bool IsFaceList(const PlyProperty& prop) {
+        return prop.isList && (prop.name == "vertex_indices" || prop.name == "vertex_index");
+    }
+
+    // ---------- binary elements ----------
+    bool ReadBinaryVertices(const PlyElement& element, bool swap, const unsigned char*& p, const unsigned char* end,
+                            std::vector<Vertex>& vertices, PLYReadInfo& info) {
+        if (element.stride == 0) {
+            std::cerr << "[PLYReader] list properties in the vertex element are not supported\n";
+            return false;
+        }
+        if ((uint64_t)(end - p) / element.stride < element.count) {
+            std::cerr << "[PLYReader] truncated vertex data\n";
+            return false;
+        }
+
+        int offsets[FieldCount];
+        PlyType types[FieldCount];
+        for (int f = 0; f < FieldCount; ++f) { offsets[f] = -1; types[f] = PlyType::Invalid; }
+        size_t offset = 0;
+        for (const PlyProperty& prop : element.properties) {
+            int field = FieldOf(prop.name);
+            if (field >= 0) { offsets[field] = (int)offset; types[field] = prop.type; }
+            offset += TypeSize(prop.type);
+        }
+        info.hadNormals = offsets[FieldNX] >= 0 && offsets[FieldNY] >= 0 && offsets[FieldNZ] >= 0;
+        info.hadTexCoords = offsets[FieldU] >= 0 && offsets[FieldV] >= 0;
+
+        vertices.assign(element.count, Vertex{});
+        auto read = [&](const unsigned char* record, int field) {
+            return offsets[field] >= 0 ? ReadBinaryFloat(record + offsets[field], types[field], swap) : 0.0f;
+        };
+        const unsigned char* record = p;
+        for (uint64_t i = 0; i < element.count; ++i, record += element.stride) {
+            Vertex& v = vertices[i];
+            v.position = glm::vec3(read(record, FieldX), read(record, FieldY), read(record, FieldZ));
+            if (info.hadNormals) v.normals = glm::vec3(read(record, FieldNX), read(record, FieldNY), read(record, FieldNZ));
+            if (info.hadTexCoords) v.texCoord = glm::vec2(read(record, FieldU), read(record, FieldV));
+        }
+        p = record;
+        return true;
+    }
+
+    bool ReadBinaryFaces(const PlyElement& element, bool swap, const unsigned char*& p, const unsigned char* end,
+                         size_t vertexCount, std::vector<unsigned int>& indices, PLYReadInfo& info) {
+        indices.reserve(indices.size() + element.count * 3);
+        std::vector<unsigned int> corners;
+
+        // Triangle with 32-bit indices in native order: copy the three indices as they are
+        const bool nativeTriangles = !swap && element.properties.size() == 1 && IsFaceList(element.properties[0]) &&
+                                     TypeSize(element.properties[0].countType) == 1 &&
+                                     (element.properties[0].type == PlyType::Int32 ||
+                                      element.properties[0].type == PlyType::UInt32);
+
+        for (uint64_t i = 0; i < element.count; ++i) {
+            if (nativeTriangles && end - p >= 13 && p[0] == 3) {
+                unsigned int tri[3];
+                std::memcpy(tri, p + 1, sizeof(tri));
+                p += 13;
+                if (tri[0] < vertexCount && tri[1] < vertexCount && tri[2] < vertexCount) {
+                    indices.insert(indices.end(), tri, tri + 3);
+                } else {
+                    info.facesDropped++;
+                }
+                continue;
+            }
+            for (const PlyProperty& prop : element.properties) {
+                if (!prop.isList) {
+                    p += TypeSize(prop.type);
+                    continue;
+                }
+                const size_t countSize = TypeSize(prop.countType), itemSize = TypeSize(prop.type);
+                if (end - p < (ptrdiff_t)countSize) { std::cerr << "[PLYReader] truncated face data\n"; return false; }
+                const int64_t count = ReadBinaryInt(p, prop.countType, swap);
+                p += countSize;
+                if (count < 0 || (uint64_t)(end - p) < (uint64_t)count * itemSize) {
+                    std::cerr << "[PLYReader] truncated face data\n";
+                    return false;
+                }
+                if (IsFaceList(prop)) {
+                    corners.resize((size_t)count);
+                    for (int64_t k = 0; k < count; ++k) {
+                        const int64_t index = ReadBinaryInt(p + k * itemSize, prop.type, swap);
+                        corners[k] = index < 0 ? ~0u : (unsigned int)index;
+                    }
+                    EmitFace(corners.data(), corners.size(), vertexCount, indices, info);
+                }
+                p += count * itemSize;
+            }
+            if (p > end) { std::cerr << "[PLYReader] truncated face data\n"; return false; }
+        }
+        return true;
+    }
+
+    bool SkipBinaryElement(const PlyElement& element, bool swap, const unsigned char*& p, const unsigned char* end) {
+        if (element.stride > 0) {
+            if ((uint64_t)(end - p) / element.stride < element.count) return false;
+            p += element.count * element.stride;
+            return true;
+        }
+        for (uint64_t i = 0; i < element.count; ++i) {
+            for (const PlyProperty& prop : element.properties) {
+                if (!prop.isList) { p += TypeSize(prop.type); continue; }
+                if (end - p < (ptrdiff_t)TypeSize(prop.countType)) return false;
+                const int64_t count = ReadBinaryInt(p, prop.countType, swap);
+                p += TypeSize(prop.countType) + (count > 0 ? count : 0) * TypeSize(prop.type);
+            }
+            if (p > end) return false;
+        }
+        return true;
+    }
+
+    // ---------- ASCII elements ----------
+    bool ReadAsciiElement(const PlyElement& element, bool isVertex, bool isFace, AsciiCursor& cursor,
+                          std::vector<Vertex>& vertices, std::vector<unsigned int>& indices, PLYReadInfo& info) {
+        int fields[64];
+        const size_t propCount = element.properties.size();
+        if (isVertex) {
+            if (propCount > 64) { std::cerr << "[PLYReader] too many vertex properties\n"; return false; }
+            bool has[FieldCount] = {};
+            for (size_t k = 0; k < propCount; ++k) {
+                fields[k] = element.properties[k].isList ? -1 : FieldOf(element.properties[k].name);
+                if (fields[k] >= 0) has[fields[k]] = true;
+            }
+            info.hadNormals = has[FieldNX] && has[FieldNY] && has[FieldNZ];
+            info.hadTexCoords = has[FieldU] && has[FieldV];
+            vertices.assign(element.count, Vertex{});
+        }
+        if (isFace) indices.reserve(indices.size() + element.count * 3);
+
+        std::vector<unsigned int> corners;
+        const char* s;
+        const char* e;
+        bool ok = true;
+        for (uint64_t i = 0; i < element.count; ++i) {
+            float values[FieldCount] = {};
+            for (size_t k = 0; k < propCount; ++k) {
+                const PlyProperty& prop = element.properties[k];
+                if (!cursor.Next(s, e)) { std::cerr << "[PLYReader] unexpected end of file\n"; return false; }
+                const double first = ParseNumber(s, e, ok);
+                if (!ok) { std::cerr << "[PLYReader] bad number '" << std::string(s, e) << "'\n"; return false; }
+                if (!prop.isList) {
+                    if (isVertex && fields[k] >= 0) values[fields[k]] = (float)first;
+                    continue;
+                }
+                const int64_t count = (int64_t)first;
+                const bool keep = isFace && IsFaceList(prop);
+                if (keep) corners.assign(count > 0 ? (size_t)count : 0, 0);
+                for (int64_t c = 0; c < count; ++c) {
+                    if (!cursor.Next(s, e)) { std::cerr << "[PLYReader] unexpected end of file\n"; return false; }
+                    if (!keep) continue;
+                    const double index = ParseNumber(s, e, ok);
+                    corners[c] = (ok && index >= 0.0) ? (unsigned int)index : ~0u;
+                }
+                if (keep) EmitFace(corners.data(), corners.size(), vertices.size(), indices, info);
+            }
+            if (isVertex) {
+                Vertex& v = vertices[i];
+                v.position = glm::vec3(values[FieldX], values[FieldY], values[FieldZ]);
+                v.normals = glm::vec3(values[FieldNX], values[FieldNY], values[FieldNZ]);
+                v.texCoord = glm::vec2(values[FieldU], values[FieldV]);
+            }
+        }
+        return true;
+    }
+}
+
+bool ReadPLY(const std::string& path, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices,
+             bool flipUVs, PLYReadInfo* infoOut) {
+    vertices.clear();
+    indices.clear();
+
+    MappedFile file;
+    if (!file.Open(path)) {
+        std::cerr << "[PLYReader] cannot open " << path << "\n";
+        return false;
+    }
+    file.AdviseSequential();
+
+    PlyHeader header;
+    std::string err;
+    if (!ParseHeader(file.GetData(), file.GetSize(), header, err)) {
+        std::cerr << "[PLYReader] " << path << ": " << err << "\n";
+        return false;
+    }
+
+    PLYReadInfo info;
+    const unsigned char* p = file.GetData() + header.dataOffset;
+    const unsigned char* end = file.GetData() + file.GetSize();
+    bool sawVertices = false;
+
+    if (header.format == PlyFormat::Ascii) {
+        info.format = "ascii";
+        AsciiCursor cursor{reinterpret_cast<const char*>(p), reinterpret_cast<const char*>(end)};
+        for (const PlyElement& element : header.elements) {
+            const bool isVertex = element.name == "vertex" && !sawVertices;
+            const bool isFace = element.name == "face";
+            if (!ReadAsciiElement(element, isVertex, isFace, cursor, vertices, indices, info)) return false;
+            sawVertices = sawVertices || isVertex;
+        }
+    } else {
+        // Byte order of this machine vs the file
+        const uint16_t probe = 1;
+        const bool littleEndianHost = *reinterpret_cast<const unsigned char*>(&probe) == 1;
+        const bool fileLittle = header.format == PlyFormat::BinaryLittleEndian;
+        const bool swap = littleEndianHost != fileLittle;
+        info.format = fileLittle ? "binary_little_endian" : "binary_big_endian";
+
+        for (const PlyElement& element : header.elements) {
+            bool ok;
+            if (element.name == "vertex" && !sawVertices) {
+                ok = ReadBinaryVertices(element, swap, p, end, vertices, info);
+                sawVertices = true;
+            } else if (element.name == "face") {
+                ok = ReadBinaryFaces(element, swap, p, end, vertices.size(), indices, info);
+            } else {
+                ok = SkipBinaryElement(element, swap, p, end);
+                if (!ok) std::cerr << "[PLYReader] truncated element " << element.name << "\n";
+            }
+            if (!ok) return false;
+        }
+    }
+
+    if (!sawVertices) {
+        std::cerr << "[PLYReader] " << path << ": no vertex element\n";
+        return false;
+    }
+    if (info.facesDropped > 0) {
+        std::cerr << "[PLYReader] " << path << ": dropped " << info.facesDropped << " invalid faces\n";
+    }
+
+    if (flipUVs && info.hadTexCoords) {
+        for (Vertex& v : vertices) v.texCoord.y = 1.0f - v.texCoord.y;
+    }
+    if (!info.hadNormals) {
+        ComputeNormals(vertices, indices);
+    }
+    if (info.hadTexCoords) {
+        ComputeTangents(vertices, indices);
+    }
+
+    info.vertices = vertices.size();
+    info.triangles = indices.size() / 3;
+    if (infoOut) *infoOut = info;
+    return true;
+}
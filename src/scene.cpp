@@ -1,78 +1,82 @@
 #include "scene.h"
+#include <algorithm>
+#include <unordered_set>
 
 SceneNode::SceneNode(const std::shared_ptr<Mesh>& mesh, const std::shared_ptr<PBRMaterial>& material): 
+    transform(TransformStore::Get().Create(this)),
     mesh(mesh), 
     material(material),      
-    localTransform(glm::mat4(1.0f)), 
-    worldTransform(glm::mat4(1.0f)),
     position(0.0f), 
     rotation(0.0f), 
-    scale(1.0f), 
-    parent(nullptr) {
-        // Initialize local aabb and world aabb
+    scale(1.0f) {
+        // Initialize world aabb from the mesh bounds
         if(this->mesh) {
-            this->localAABB = std::make_shared<AABB>(mesh);
-            this->worldAABB = std::make_shared<AABB>(mesh);
-        } else {
-            this->localAABB = nullptr;
-            this->worldAABB = nullptr;
+            this->worldAABB = AABB(mesh);
         }
 }
 
+SceneNode::SceneNode(): SceneNode(nullptr, nullptr) {
+}
+
+SceneNode::~SceneNode() {
+    TransformStore::Get().Release(this->transform);
+}
+
 // Update the local transformation matrix
 void SceneNode::UpdateLocalTransform() {
-    this->localTransform = glm::mat4(1.0f);  // Initialize as unit matrix
+    glm::mat4 localTransform = glm::mat4(1.0f);  // Initialize as unit matrix
 
     // Translate
-    this->localTransform = glm::translate(this->localTransform, this->position);
+    localTransform = glm::translate(localTransform, this->position);
 
     // Rotation (XYZ order)
-    this->localTransform = glm::rotate(this->localTransform, this->rotation.x, glm::vec3(1.0f, 0.0f, 0.0f));
-    this->localTransform = glm::rotate(this->localTransform, this->rotation.y, glm::vec3(0.0f, 1.0f, 0.0f));
-    this->localTransform = glm::rotate(this->localTransform, this->rotation.z, glm::vec3(0.0f, 0.0f, 1.0f));
+    localTransform = glm::rotate(localTransform, this->rotation.x, glm::vec3(1.0f, 0.0f, 0.0f));
+    localTransform = glm::rotate(localTransform, this->rotation.y, glm::vec3(0.0f, 1.0f, 0.0f));
+    localTransform = glm::rotate(localTransform, this->rotation.z, glm::vec3(0.0f, 0.0f, 1.0f));
 
     // Scale
-    this->localTransform = glm::scale(this->localTransform, this->scale);
+    localTransform = glm::scale(localTransform, this->scale);
+    TransformStore::Get().SetLocal(this->transform, localTransform);
 }
 
-// Update the world transformation matrix
+// Update the world transformation matrix of this node and all descendants right away,
+// a linear pass over the node's contiguous range in the transform store.
+// Setters only mark the node dirty, Scene::UpdateTransforms catches up once per frame.
 void SceneNode::UpdateWorldTransform() {
-    if (this->parent) {
-        // If there is a parent, combine the parent's world transform with this node's local transform
-        this->worldTransform = parent->worldTransform * this->localTransform;
-    } else {
-        // If no parent, the world transform is equal to the local transform
-        this->worldTransform = this->localTransform;
-    }
-
-    // Apply transform to world aabb
-    if(this->worldAABB) {
-        this->worldAABB->UpdateBox(this->worldTransform);
-    }
-
-    // Recursively update the world transformation matrix of child nodes
-    for (auto& child : children) {
-        child->UpdateWorldTransform();
-    }
+    TransformStore::Get().UpdateSubtree(this->transform);
 }
 
 // Add a child node to the current node
 void SceneNode::AddChild(const std::shared_ptr<SceneNode>& child) {
+    // Set the parent of the child node
+    if (!TransformStore::Get().SetParent(child->transform, this->transform)) {
+        return;
+    }
     this->children.push_back(child);
-    child->parent = shared_from_this();  // Set the parent of the child node
-    child->UpdateWorldTransform();      // Update the child's world transform
+    TransformStore::Get().MarkDirty(child->transform); // child's world transform follows this node
 }
 
 // Upload material and transformation matrices to the shader
 void SceneNode::UploadToShader(const std::shared_ptr<Shader>& shader) {
     shader->Use();
-    shader->SetUniform("model", this->worldTransform); // set model first
+    this->UploadTransform(shader); // set model first
 
     if (this->material) {
-        this->material->UploadToShader(shader);
+        this->material->UploadToBoundShader(shader);
     }
 }
 
+// Upload the model matrix only, used by the sorted submitter which binds materials itself
+void SceneNode::UploadTransform(const std::shared_ptr<Shader>& shader) {
+    static GLuint modelProgram = 0;
+    static UniformId modelId;
+    if (modelProgram != shader->GetProgramID()) {
+        modelProgram = shader->GetProgramID();
+        modelId = shader->GetUniformId("model");
+    }
+    shader->SetUniform(modelId, TransformStore::Get().GetWorld(this->transform));
+}
+
 
 // Draw this node and all its children recursively
 void SceneNode::Draw(const std::shared_ptr<Shader>& shader) {
@@ -89,81 +93,62 @@ void SceneNode::Draw(const std::shared_ptr<Shader>& shader) {
 }
 
 void SceneNode::SetLocalTransformMatrix(const glm::mat4& m) {
-    this->localTransform = m;
-    this->UpdateWorldTransform();
+    TransformStore::Get().SetLocal(this->transform, m); // marks the subtree dirty
 }
 
 // Transform getter and setters
 void SceneNode::SetPosition(const glm::vec3& p) {
     this->position = p;
-    this->UpdateLocalTransform();
-    this->UpdateWorldTransform(); // propagate transform effect to child
+    this->UpdateLocalTransform(); // marks the subtree dirty, children follow on next update
 }
 
 void SceneNode::SetRotation(const glm::vec3& r) {
     this->rotation = r;
     this->UpdateLocalTransform();
-    this->UpdateWorldTransform();
 }
 
 void SceneNode::SetScale(const glm::vec3& s) {
     this->scale = s;
     this->UpdateLocalTransform();
-    this->UpdateWorldTransform();
 }
 
 void SceneNode::SetMesh(const std::shared_ptr<Mesh>& mesh) {
     this->mesh = mesh;
-    if (mesh) {
-        localAABB = std::make_shared<AABB>(mesh);
-        worldAABB = std::make_shared<AABB>(mesh);
-        if (parent) {
-            worldAABB->UpdateBox(worldTransform);
-        }
-    } else {
-        localAABB.reset();
-        worldAABB.reset();
-    }
+    this->worldAABB = mesh ? AABB(mesh) : AABB();
+    TransformStore::Get().MarkDirty(this->transform); // Move the new box to world space on next update
+    TransformStore::Get().MarkStructureChanged();     // mesh set changed, scene BVH needs a rebuild
 }
 
 //==================Scene========================
 void Scene::AddNode(const std::shared_ptr<SceneNode>& node) {
     this->rootNodes.push_back(node);
+    this->bvhBuilt = false;
 }
 
-// Rendering all objects in the scene
-void Scene::Render(const std::shared_ptr<Shader>& shader, glm::vec3 camPos) {
-    // Clear queues
-    this->queueOpaque.clear();
-    this->queueMasked.clear();
-    this->queueTransparent.clear();
-
-    // Sort all the node to transparent, mask and opaque node
-    for (auto& root : this->rootNodes) {
-        this->CollectQueue(root);
-    }
+// Recompute world transforms and bounds of every node edited since the last call
+void Scene::UpdateTransforms() {
+    TransformStore::Get().UpdateDirty();
+}
 
-     // Opaque first (no blending, write depth)
-    if (!queueOpaque.empty()) {
-        for (auto& n : queueOpaque) {
-            DrawNodeWithState(n, shader, /*blending=*/false, /*depthWrite=*/true);
-        }
-    }
+// Rendering all objects in the scene
+void Scene::Render(const std::shared_ptr<Shader>& shader, glm::vec3 camPos, const glm::mat4& viewProj) {
+    this->renderStats = RenderStats{};
+    this->frustum.Update(viewProj);
 
-    // Masked next, opaque part will be discarded
-    if (!queueMasked.empty()) {
-        for (auto& n : queueMasked) {
-            DrawNodeWithState(n, shader, /*blending=*/false, /*depthWrite=*/true);
-        }
-    }
+    // Clear queue and per-frame ids
+    this->drawItems.clear();
+    this->materialIds.clear();
+    this->meshIds.clear();
+    this->textureSetIds.clear();
 
-    // Transparent last: sort back-to-front, enable blending, disable depth write
-    if (!queueTransparent.empty()) {
-        SortTransparent(camPos);
-        for (auto& n : queueTransparent) {
-            DrawNodeWithState(n, shader, /*blending=*/true, /*depthWrite=*/false);
-        }
+    // Collect every drawable node, then order them by sort key
+    for (auto& root : this->rootNodes) {
+        this->CollectQueue(root.get(), camPos);
     }
+    this->BuildSortKeys(shader);
+    this->renderStats.stateChangesUnsorted = this->CountStateChanges();
+    this->SortDrawItems();
+    this->SubmitDrawItems(shader);
 
     // Reset default state
     glDisable(GL_BLEND);
@@ -172,75 +157,300 @@ void Scene::Render(const std::shared_ptr<Shader>& shader, glm::vec3 camPos) {
     glCullFace(GL_BACK);
 }
 
-// Sort all the transparent objects using their squared distance
-void Scene::SortTransparent(const glm::vec3& camPos) {
-    // squared distance helper
-    auto dist2 = [&](const std::shared_ptr<SceneNode>& node) -> float {
-        glm::vec4 p4 = node->GetWorldTransform() * glm::vec4(0, 0, 0, 1); // world-space origin
-        glm::vec3 p  = glm::vec3(p4);
-        glm::vec3 w  = p - camPos;
-        return glm::dot(w, w);
-    };
+// Collect all the visible drawable node with their squared distance to the camera.
+// Walks the node's contiguous range in the transform store; a culled subtree is
+// skipped by jumping over its range, a fully visible one is not tested further.
+void Scene::CollectQueue(SceneNode* node, const glm::vec3& camPos) {
+    if(!node) {
+        return;
+    }
 
-    // Compare distance
-    auto compare = [&](const std::shared_ptr<SceneNode>& a,
-                       const std::shared_ptr<SceneNode>& b) {
-        return dist2(a) > dist2(b);
-    };
+    const TransformStore& store = TransformStore::Get();
+    const uint32_t begin = store.IndexOf(node->GetTransformHandle());
+    const uint32_t end = begin + store.SubtreeSizeAt(begin);
+    uint32_t insideEnd = begin; // entries below this index are inside the frustum
+
+    for (uint32_t k = begin; k < end;) {
+        bool fullyInside = k < insideEnd;
+
+        // Hierarchical early-out: skip the whole subtree if its combined bounds are outside
+        if (!fullyInside) {
+            if (!store.HasSubtreeBoundsAt(k)) {
+                k += store.SubtreeSizeAt(k); // no mesh below
+                continue;
+            }
+            Frustum::Result r = this->frustum.TestAABB(store.SubtreeMinAt(k), store.SubtreeMaxAt(k));
+            if (r == Frustum::Result::Outside) {
+                this->renderStats.subtreesCulled++;
+                this->renderStats.nodesCulled += store.SubtreeMeshCountAt(k);
+                k += store.SubtreeSizeAt(k);
+                continue;
+            }
+            if (r == Frustum::Result::Inside) {
+                insideEnd = k + store.SubtreeSizeAt(k);
+                fullyInside = true;
+            }
+        }
 
-    // sort back-to-front for blending
-    std::sort(queueTransparent.begin(), queueTransparent.end(), compare);
+        SceneNode* n = store.OwnerAt(k);
+        if (n && n->GetMesh() && n->GetMaterial()) {
+            auto box = n->GetWorldAABB();
+            if (!fullyInside && box && box->IsValid() && !this->frustum.IsVisible(box->GetMin(), box->GetMax())) {
+                this->renderStats.nodesCulled++;
+            } else {
+                // Use world aabb center, fall back to world-space origin
+                glm::vec3 p;
+                if (box) {
+                    p = 0.5f * (box->GetMin() + box->GetMax());
+                } else {
+                    p = glm::vec3(store.WorldAt(k)[3]);
+                }
+                glm::vec3 w = p - camPos;
+                this->drawItems.push_back({0, glm::dot(w, w), n});
+                this->renderStats.nodesVisible++;
+            }
+        }
+        ++k;
+    }
 }
 
-// collect and sort opaque, masked and transparent object
-void Scene::CollectQueue(const std::shared_ptr<SceneNode>& node) {
-    if(!node) {
-        return;
-    }
+uint32_t Scene::GetDenseId(std::unordered_map<const void*, uint32_t>& ids, const void* ptr) {
+    auto it = ids.emplace(ptr, static_cast<uint32_t>(ids.size())).first;
+    return it->second;
+}
 
-    if (auto mat = node->GetMaterial()) {
-        switch (mat->GetAlphaMode()) {
-            case PBRMaterial::AlphaMode::Opaque:
-                queueOpaque.push_back(node);
+uint32_t Scene::GetTextureSetId(const PBRMaterial& material) {
+    uint64_t hash = material.GetTextureSetHash();
+    auto it = this->textureSetIds.emplace(hash, static_cast<uint32_t>(this->textureSetIds.size())).first;
+    return it->second;
+}
+
+// Build the 64-bit key of every draw item, see DrawItem for the bit layout
+void Scene::BuildSortKeys(const std::shared_ptr<Shader>& shader) {
+    float maxDepth = 0.0f;
+    for (const auto& item : this->drawItems) maxDepth = std::max(maxDepth, item.depth);
+    const float invMaxDepth = maxDepth > 0.0f ? 1.0f / maxDepth : 0.0f;
+
+    const uint64_t shaderId = shader->GetProgramID() & 0xFFu;
+
+    for (auto& item : this->drawItems) {
+        const PBRMaterial& mat = *item.node->GetMaterial();
+        const uint64_t materialId   = GetDenseId(this->materialIds, &mat) & 0xFFFu;
+        const uint64_t textureSetId = GetTextureSetId(mat) & 0xFFFu;
+        const uint64_t meshId       = GetDenseId(this->meshIds, item.node->GetMesh().get());
+        const uint64_t cull         = mat.IsDoubleSided() ? 1u : 0u;
+        const float depth01         = glm::clamp(item.depth * invMaxDepth, 0.0f, 1.0f);
+
+        switch (mat.GetAlphaMode()) {
+            case PBRMaterial::AlphaMode::Blend: {
+                // Far objects first for blending
+                const uint64_t depth = static_cast<uint64_t>((1.0f - depth01) * 0xFFFFFFu);
+                item.key = (static_cast<uint64_t>(RenderPass::Transparent) << 62) |
+                           (depth << 38) | (cull << 37) | (shaderId << 29) |
+                           (materialId << 17) | (textureSetId << 5) | (meshId & 0x1Fu);
                 break;
+            }
             case PBRMaterial::AlphaMode::Mask:
-                queueMasked.push_back(node);
-                break;
-            case PBRMaterial::AlphaMode::Blend:
-                queueTransparent.push_back(node);
-                break;
-            default:
-                queueOpaque.push_back(node);
+            case PBRMaterial::AlphaMode::Opaque:
+            default: {
+                // State first, near objects first inside the same state for early-z
+                const uint64_t pass  = mat.GetAlphaMode() == PBRMaterial::AlphaMode::Mask ?
+                                       static_cast<uint64_t>(RenderPass::Masked) : static_cast<uint64_t>(RenderPass::Opaque);
+                const uint64_t depth = static_cast<uint64_t>(depth01 * 0xFFFFu);
+                item.key = (pass << 62) | (cull << 61) | (shaderId << 53) |
+                           (materialId << 41) | (textureSetId << 29) | ((meshId & 0x1FFFu) << 16) | depth;
                 break;
+            }
         }
     }
+}
 
-    // Recurse collection
-    for (auto& c : node->GetChildren()) this->CollectQueue(c);
+// LSD radix sort, 8 bits per pass; passes where every key shares the byte are skipped
+void Scene::SortDrawItems() {
+    const size_t n = this->drawItems.size();
+    if (n < 2) return;
+    this->sortScratch.resize(n);
+
+    DrawItem* src = this->drawItems.data();
+    DrawItem* dst = this->sortScratch.data();
+    for (int shift = 0; shift < 64; shift += 8) {
+        size_t count[256] = {};
+        for (size_t i = 0; i < n; ++i) count[(src[i].key >> shift) & 0xFFu]++;
+        if (count[(src[0].key >> shift) & 0xFFu] == n) continue;
+
+        size_t offset = 0;
+        for (size_t b = 0; b < 256; ++b) {
+            size_t c = count[b];
+            count[b] = offset;
+            offset += c;
+        }
+        for (size_t i = 0; i < n; ++i) dst[count[(src[i].key >> shift) & 0xFFu]++] = src[i];
+        std::swap(src, dst);
+    }
+    if (src != this->drawItems.data()) {
+        std::copy(src, src + n, this->drawItems.data());
+    }
 }
 
-// Draw a node with GL state derived from blending/depthWrite and material doubleSided
-void Scene::DrawNodeWithState(const std::shared_ptr<SceneNode>& node, const std::shared_ptr<Shader>& shader, bool blending, bool depthWrite) {
-    // Blending & depth write
-    if (blending) {
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    } else {
-        glDisable(GL_BLEND);
+// Walk the sorted queue and only touch GL state, program and material when they change
+// Same state tracking as SubmitDrawItems, without touching GL
+uint64_t Scene::CountStateChanges() const {
+    int blending = -1, cullFace = -1;
+    const PBRMaterial* boundMaterial = nullptr;
+    uint64_t changes = this->drawItems.empty() ? 0 : 1; // shader bind
+    for (const auto& item : this->drawItems) {
+        const PBRMaterial* mat = item.node->GetMaterial().get();
+        const int transparent = (item.key >> 62) == static_cast<uint64_t>(RenderPass::Transparent) ? 1 : 0;
+        if (blending != transparent) {
+            blending = transparent;
+            changes += 2; // blend and depth write switch together
+        }
+        const int wantCull = mat->IsDoubleSided() ? 0 : 1;
+        if (cullFace != wantCull) {
+            cullFace = wantCull;
+            changes++;
+        }
+        if (mat != boundMaterial) {
+            boundMaterial = mat;
+            changes++;
+        }
     }
-    glDepthMask(depthWrite ? GL_TRUE : GL_FALSE);
+    return changes;
+}
+
+void Scene::SubmitDrawItems(const std::shared_ptr<Shader>& shader) {
+    int blending = -1, depthWrite = -1, cullFace = -1; // -1: unknown
+    bool shaderBound = false;
+    const PBRMaterial* boundMaterial = nullptr;
+
+    for (const auto& item : this->drawItems) {
+        SceneNode* node = item.node;
+        const PBRMaterial* mat = node->GetMaterial().get();
+        const bool transparent = (item.key >> 62) == static_cast<uint64_t>(RenderPass::Transparent);
+
+        // Blending & depth write
+        if (blending != (transparent ? 1 : 0)) {
+            blending = transparent ? 1 : 0;
+            if (blending) {
+                glEnable(GL_BLEND);
+                glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            } else {
+                glDisable(GL_BLEND);
+            }
+            this->renderStats.blendChanges++;
+        }
+        if (depthWrite != (transparent ? 0 : 1)) {
+            depthWrite = transparent ? 0 : 1;
+            glDepthMask(depthWrite ? GL_TRUE : GL_FALSE);
+            this->renderStats.depthWriteChanges++;
+        }
+
+        // Face culling from material, disabled if the material is doublesided
+        const int wantCull = mat->IsDoubleSided() ? 0 : 1;
+        if (cullFace != wantCull) {
+            cullFace = wantCull;
+            if (cullFace) {
+                glEnable(GL_CULL_FACE);
+                glCullFace(GL_BACK);
+            } else {
+                glDisable(GL_CULL_FACE);
+            }
+            this->renderStats.cullChanges++;
+        }
 
-    // Face culling from material
-    bool doubleSided = false;
-    if (auto mat = node->GetMaterial()) doubleSided = mat->IsDoubleSided();
+        if (!shaderBound) {
+            shader->Use();
+            shaderBound = true;
+            this->renderStats.shaderBinds++;
+        }
+        if (mat != boundMaterial) {
+            mat->UploadToBoundShader(shader);
+            boundMaterial = mat;
+            this->renderStats.materialBinds++;
+        }
 
-    if (doubleSided) {
-        glDisable(GL_CULL_FACE); // Disable the face culling if the material is doublesided
-    } else {
-        glEnable(GL_CULL_FACE);
-        glCullFace(GL_BACK);
+        // Draw
+        node->UploadTransform(shader);
+        node->GetMesh()->Draw();
+        this->renderStats.draws++;
     }
+}
+
+// Bring the BVH up to date: rebuild if nodes were added, removed, reparented or
+// got a different mesh, refit if only boxes moved, nothing if the scene is unchanged
+void Scene::SyncBVH() {
+    TransformStore& store = TransformStore::Get();
+    store.UpdateDirty();
+
+    if (this->bvhBuilt && this->bvhStructureVersion == store.GetStructureVersion()) {
+        if (this->bvhBoundsVersion == store.GetBoundsVersion()) {
+            return;
+        }
+        this->bvhBoundsVersion = store.GetBoundsVersion();
+        if (this->bvh.Refit()) {
+            return;
+        }
+        // Refit made the tree too loose, fall through to a rebuild
+    }
+
+    // Gather mesh nodes of every root subtree from its contiguous store range
+    this->bvhNodes.clear();
+    for (const auto& root : this->rootNodes) {
+        if (!root) continue;
+        const uint32_t begin = store.IndexOf(root->GetTransformHandle());
+        const uint32_t end = begin + store.SubtreeSizeAt(begin);
+        for (uint32_t k = begin; k < end; ++k) {
+            SceneNode* n = store.OwnerAt(k);
+            if (n && n->GetMesh()) {
+                this->bvhNodes.push_back(n);
+            }
+        }
+    }
+    this->bvh.Build(this->bvhNodes);
+    this->bvhBuilt = true;
+    this->bvhStructureVersion = store.GetStructureVersion();
+    this->bvhBoundsVersion = store.GetBoundsVersion();
+}
 
-    // Draw
-    node->Draw(shader);
-}
\ No newline at end of file
+// Closest mesh node hit by the ray, PickMode::Triangle also fills triangle id and barycentrics
+bool Scene::Pick(const Ray& ray, BVHHit& hit, PickMode mode) {
+    this->SyncBVH();
+    return this->bvh.Raycast(ray, hit, mode);
+}
+
+void Scene::QueryFrustum(const glm::mat4& viewProj, std::vector<SceneNode*>& out) {
+    this->SyncBVH();
+    this->bvh.QueryFrustum(Frustum(viewProj), out);
+}
+
+void Scene::QueryOverlap(const glm::vec3& min, const glm::vec3& max, std::vector<SceneNode*>& out) {
+    this->SyncBVH();
+    this->bvh.QueryOverlap(min, max, out);
+}
+
+SceneMemoryStats Scene::GetMemoryStats() const {
+    SceneMemoryStats stats;
+    TransformStore& store = TransformStore::Get();
+    std::unordered_set<const Mesh*> seen;
+    for (const auto& root : this->rootNodes) {
+        if (!root) continue;
+        const uint32_t begin = store.IndexOf(root->GetTransformHandle());
+        const uint32_t end = begin + store.SubtreeSizeAt(begin);
+        for (uint32_t k = begin; k < end; ++k) {
+            SceneNode* n = store.OwnerAt(k);
+            if (!n) continue;
+            stats.nodes++;
+            stats.nodeBytes += sizeof(SceneNode) + n->GetChildren().capacity() * sizeof(std::shared_ptr<SceneNode>);
+            const Mesh* mesh = n->GetMesh().get();
+            if (!mesh || !seen.insert(mesh).second) continue;
+            stats.meshes++;
+            stats.vertexBytes += mesh->GetCPUVertexBytes();
+            stats.positionBytes += mesh->GetCPUPositionBytes();
+            stats.indexBytes += mesh->GetCPUIndexBytes();
+            stats.mappedBytes += mesh->GetMappedBytes();
+            stats.meshBVHBytes += mesh->GetBVHBytes();
+            stats.gpuBytes += mesh->GetGPUBytes();
+        }
+    }
+    return stats;
+}
@@ -6,6 +6,7 @@
 #include <GLFW/glfw3.h>
 #include <filesystem>
 #include <stdexcept>
+#include <algorithm>
 
 
 Shader::Shader(const std::string& vertexPath, const std::string& fragmentPath): vertexPath(vertexPath), fragmentPath(fragmentPath) {
@@ -31,6 +32,78 @@ Shader::Shader(const std::string& vertexPath, const std::string& fragmentPath):
     // Clean up compiled shader objects (no longer needed after linking)
     glDeleteShader(vertexShader);
     glDeleteShader(fragmentShader);
+
+    // Build name -> location table once, SetUniform never queries the driver afterwards
+    this->ReflectUniforms();
+}
+
+// Query every active uniform of the linked program
+void Shader::ReflectUniforms() {
+    this->uniformTable.clear();
+    this->uniformSlots.clear();
+
+    GLint count = 0, maxNameLength = 0;
+    glGetProgramiv(this->shaderProgram, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(this->shaderProgram, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+
+    std::vector<char> nameBuffer(static_cast<size_t>(std::max(maxNameLength, 1)));
+    for (GLint i = 0; i < count; ++i) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(this->shaderProgram, static_cast<GLuint>(i), static_cast<GLsizei>(nameBuffer.size()),
+                           &length, &size, &type, nameBuffer.data());
+        std::string name(nameBuffer.data(), static_cast<size_t>(length));
+
+        // Uniform block members have no location, they are fed through buffers
+        GLint location = glGetUniformLocation(this->shaderProgram, name.c_str());
+        if (location == -1) {
+            continue;
+        }
+
+        UniformSlot slot;
+        slot.location = location;
+        this->uniformSlots.push_back(slot);
+        int index = static_cast<int>(this->uniformSlots.size()) - 1;
+        this->uniformTable[name] = index;
+
+        // Arrays are reported once as "name[0]": register the plain name for element 0
+        // and every other element with its own location and cached value
+        size_t bracket = name.find("[0]");
+        if (bracket != std::string::npos && bracket + 3 == name.size()) {
+            const std::string base = name.substr(0, bracket);
+            this->uniformTable[base] = index;
+            for (GLint element = 1; element < size; ++element) {
+                const std::string elementName = base + "[" + std::to_string(element) + "]";
+                GLint elementLocation = glGetUniformLocation(this->shaderProgram, elementName.c_str());
+                if (elementLocation == -1) {
+                    continue;
+                }
+                UniformSlot elementSlot;
+                elementSlot.location = elementLocation;
+                this->uniformSlots.push_back(elementSlot);
+                this->uniformTable[elementName] = static_cast<int>(this->uniformSlots.size()) - 1;
+            }
+        }
+    }
+}
+
+UniformId Shader::GetUniformId(const std::string& name) const {
+    auto it = this->uniformTable.find(name);
+    if (it == this->uniformTable.end()) {
+        return UniformId{};
+    }
+    return UniformId{it->second};
+}
+
+bool Shader::BindUniformBlock(const std::string& blockName, GLuint binding) const {
+    GLuint blockIndex = glGetUniformBlockIndex(this->shaderProgram, blockName.c_str());
+    if (blockIndex == GL_INVALID_INDEX) {
+        std::cerr << "WARNING: uniform block '" << blockName << "' not found in shader.\n";
+        return false;
+    }
+    glUniformBlockBinding(this->shaderProgram, blockIndex, binding);
+    return true;
 }
 
 std::string Shader::ProcessIncludes(const std::string& shaderCode, const std::string& parentPath) {
@@ -0,0 +1,111 @@
+#include "texture/hdr_format.h"
+#include <glm/glm.hpp>
+#include <glm/gtc/packing.hpp>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+    // glm's packF2x11_1x10 truncates the mantissa, round it to mantissaBits first (halves
+    // the error) and clamp to the largest finite value of the small float
+    float RoundToMantissa(float value, int mantissaBits, float maxValue) {
+        value = glm::clamp(value, 0.0f, maxValue);
+        uint32_t bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        bits += 1u << (22 - mantissaBits);
+        bits &= ~((1u << (23 - mantissaBits)) - 1u);
+        std::memcpy(&value, &bits, sizeof(bits));
+        return glm::min(value, maxValue);
+    }
+
+    // Largest finite half float, anything above packs to +Inf (a sun in an HDR sky easily
+    // exceeds it) and Inf turns into NaN in the tonemapper
+    constexpr float HALF_MAX = 65504.0f;
+}
+
+bool GetHDRFormatInfo(GLenum internalFormat, HDRFormatInfo& info) {
+    info.internalFormat = internalFormat;
+    switch (internalFormat) {
+        case GL_RGBA32F:        info.format = GL_RGBA; info.type = GL_FLOAT;      info.channels = 4; info.bytesPerPixel = 16; return true;
+        case GL_RGB32F:         info.format = GL_RGB;  info.type = GL_FLOAT;      info.channels = 3; info.bytesPerPixel = 12; return true;
+        case GL_RG32F:          info.format = GL_RG;   info.type = GL_FLOAT;      info.channels = 2; info.bytesPerPixel = 8;  return true;
+        case GL_RGBA16F:        info.format = GL_RGBA; info.type = GL_HALF_FLOAT; info.channels = 4; info.bytesPerPixel = 8;  return true;
+        case GL_RGB16F:         info.format = GL_RGB;  info.type = GL_HALF_FLOAT; info.channels = 3; info.bytesPerPixel = 6;  return true;
+        case GL_RG16F:          info.format = GL_RG;   info.type = GL_HALF_FLOAT; info.channels = 2; info.bytesPerPixel = 4;  return true;
+        case GL_R11F_G11F_B10F: info.format = GL_RGB;  info.type = GL_UNSIGNED_INT_10F_11F_11F_REV;
+                                info.channels = 3; info.bytesPerPixel = 4; return true;
+        default:
+            info = HDRFormatInfo{};
+            return false;
+    }
+}
+
+const char* GetHDRFormatName(GLenum internalFormat) {
+    switch (internalFormat) {
+        case GL_RGBA32F:        return "rgba32f";
+        case GL_RGB32F:         return "rgb32f";
+        case GL_RG32F:          return "rg32f";
+        case GL_RGBA16F:        return "rgba16f";
+        case GL_RGB16F:         return "rgb16f";
+        case GL_RG16F:          return "rg16f";
+        case GL_R11F_G11F_B10F: return "r11g11b10f";
+        default:                return "unknown";
+    }
+}
+
+std::vector<unsigned char> PackHDRPixels(const float* src, int srcChannels, size_t count, GLenum internalFormat) {
+    HDRFormatInfo info;
+    if (!GetHDRFormatInfo(internalFormat, info)) {
+        return {};
+    }
+    std::vector<unsigned char> dst(count * info.bytesPerPixel);
+    float texel[4];
+    for (size_t i = 0; i < count; ++i) {
+        for (int c = 0; c < 4; ++c) {
+            texel[c] = c < srcChannels ? src[i * srcChannels + c] : 0.0f;
+        }
+        unsigned char* out = &dst[i * info.bytesPerPixel];
+        if (info.type == GL_FLOAT) {
+            std::memcpy(out, texel, info.bytesPerPixel);
+        } else if (info.type == GL_HALF_FLOAT) {
+            uint16_t half[4];
+            for (int c = 0; c < info.channels; ++c) {
+                half[c] = glm::packHalf1x16(glm::clamp(texel[c], -HALF_MAX, HALF_MAX));
+            }
+            std::memcpy(out, half, info.bytesPerPixel);
+        } else {
+            const glm::vec3 rounded(RoundToMantissa(texel[0], 6, 65024.0f),
+                                    RoundToMantissa(texel[1], 6, 65024.0f),
+                                    RoundToMantissa(texel[2], 5, 64512.0f));
+            const uint32_t packed = glm::packF2x11_1x10(rounded);
+            std::memcpy(out, &packed, sizeof(packed));
+        }
+    }
+    return dst;
+}
+
+std::vector<float> UnpackHDRPixels(const void* src, size_t count, GLenum internalFormat) {
+    HDRFormatInfo info;
+    if (!GetHDRFormatInfo(internalFormat, info)) {
+        return {};
+    }
+    std::vector<float> dst(count * info.channels);
+    const unsigned char* in = static_cast<const unsigned char*>(src);
+    for (size_t i = 0; i < count; ++i, in += info.bytesPerPixel) {
+        float* out = &dst[i * info.channels];
+        if (info.type == GL_FLOAT) {
+            std::memcpy(out, in, info.bytesPerPixel);
+        } else if (info.type == GL_HALF_FLOAT) {
+            uint16_t half[4];
+            std::memcpy(half, in, info.bytesPerPixel);
+            for (int c = 0; c < info.channels; ++c) {
+                out[c] = glm::unpackHalf1x16(half[c]);
+            }
+        } else {
+            uint32_t packed;
+            std::memcpy(&packed, in, sizeof(packed));
+            const glm::vec3 v = glm::unpackF2x11_1x10(packed);
+            out[0] = v.x; out[1] = v.y; out[2] = v.z;
+        }
+    }
+    return dst;
+}
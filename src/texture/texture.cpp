@@ -1,4 +1,5 @@
 #include "texture/texture.h"
+#include "texture/hdr_format.h"
 #include "stb_image.h"
 #include "stb_image_write.h"
 #include <cmath> 
@@ -6,6 +7,14 @@
 #include <GLFW/glfw3.h>
 #include <gli/gli.hpp>
 #include <gli/load_ktx.hpp>
+#include <algorithm>
+#include <chrono>
+#include "config.h"
+
+bool Texture2D::cookTextures = COOK_TEXTURES;
+
+// glad is generated without EXT_texture_compression_s3tc
+constexpr GLenum COMPRESSED_RGB_S3TC_DXT1 = 0x83F0;
 
 
 Texture2D::Texture2D(unsigned int width, unsigned int height, GLenum internalFormat, GLenum format, GLenum type):
@@ -95,13 +104,13 @@ void Texture2D::LoadHDRToTexture(const std::string& path, bool flipY) {
 
 
 // Load texture from ktx file to texture2d
-void Texture2D::LoadKTXToTexture(const std::string& path) {
+bool Texture2D::LoadKTXToTexture(const std::string& path, GLenum storageFormat) {
     gli::texture tex = gli::load_ktx(path.c_str());
 
     // Check if ktx loaded successfully 
     if (tex.empty()) {
         std::cerr << "[Texture2D] Failed to load KTX file: " << path << "\n";
-        return;
+        return false;
     }
 
     // Get the width and height from the texture
@@ -111,36 +120,101 @@ void Texture2D::LoadKTXToTexture(const std::string& path) {
 
     glBindTexture(GL_TEXTURE_2D, this->texture2d);
 
+    // Block compressed (cooked material textures): every level as stored
+    if (gli::is_compressed(tex.format())) {
+        gli::gl translator(gli::gl::PROFILE_GL33);
+        const gli::gl::format glFormat = translator.translate(tex.format(), tex.swizzles());
+        this->internalFormat = static_cast<GLenum>(glFormat.Internal);
+        this->gpuBytes = 0;
+        for (size_t level = 0; level < tex.levels(); ++level) {
+            const auto e = tex.extent(level);
+            glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(level), this->internalFormat, e.x, e.y, 0,
+                                   static_cast<GLsizei>(tex.size(level)), tex.data(0, 0, level));
+            this->gpuBytes += tex.size(level);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(tex.levels()) - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, tex.levels() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        if (glGetError() != GL_NO_ERROR) {
+            std::cerr << "[Texture2D] Error occurred during compressed texture upload: " << path << "\n";
+            return false;
+        }
+        return true;
+    }
+
     // Set internalFormat and format based on ktx texture format
     switch (tex.format()) {
         case gli::FORMAT_RGB32_SFLOAT_PACK32:
             this->internalFormat = GL_RGB32F;
             this->format = GL_RGB;
+            this->type = GL_FLOAT;
             break;
         case gli::FORMAT_RGBA32_SFLOAT_PACK32:
             this->internalFormat = GL_RGBA32F;
             this->format = GL_RGBA;
+            this->type = GL_FLOAT;
             break;
         case gli::FORMAT_RG32_SFLOAT_PACK32: // BRDF LUT
             this->internalFormat = GL_RG32F;
             this->format = GL_RG;
+            this->type = GL_FLOAT;
+            break;
+        case gli::FORMAT_RGB16_SFLOAT_PACK16:
+            this->internalFormat = GL_RGB16F;
+            this->format = GL_RGB;
+            this->type = GL_HALF_FLOAT;
+            break;
+        case gli::FORMAT_RGBA16_SFLOAT_PACK16:
+            this->internalFormat = GL_RGBA16F;
+            this->format = GL_RGBA;
+            this->type = GL_HALF_FLOAT;
+            break;
+        case gli::FORMAT_RG16_SFLOAT_PACK16: // BRDF LUT baked as half float
+            this->internalFormat = GL_RG16F;
+            this->format = GL_RG;
+            this->type = GL_HALF_FLOAT;
+            break;
+        case gli::FORMAT_RG11B10_UFLOAT_PACK32:
+            this->internalFormat = GL_R11F_G11F_B10F;
+            this->format = GL_RGB;
+            this->type = GL_UNSIGNED_INT_10F_11F_11F_REV;
             break;
         case gli::FORMAT_RGB8_UNORM_PACK8:
             this->internalFormat = GL_RGB8;
             this->format = GL_RGB;
+            this->type = GL_UNSIGNED_BYTE;
             break;
         case gli::FORMAT_RGBA8_UNORM_PACK8:
             this->internalFormat = GL_RGBA8;
             this->format = GL_RGBA;
+            this->type = GL_UNSIGNED_BYTE;
             break;
         default:
             std::cerr << "[Texture2D] Unsupported KTX format, using default\n";
             break;
     }
 
+    // Convert float data to the requested storage format, e.g. an RG32F LUT to RG16F
+    const void* pixels = tex.data(0, 0, 0);
+    std::vector<unsigned char> converted;
+    HDRFormatInfo sourceInfo, targetInfo;
+    if (storageFormat != 0 && storageFormat != this->internalFormat &&
+        GetHDRFormatInfo(this->internalFormat, sourceInfo) && GetHDRFormatInfo(storageFormat, targetInfo)) {
+        const size_t count = static_cast<size_t>(texSize.x) * texSize.y;
+        const std::vector<float> texels = UnpackHDRPixels(pixels, count, sourceInfo.internalFormat);
+        converted = PackHDRPixels(texels.data(), sourceInfo.channels, count, storageFormat);
+        pixels = converted.data();
+        this->internalFormat = targetInfo.internalFormat;
+        this->format = targetInfo.format;
+        this->type = targetInfo.type;
+    }
 
     // Load texture
-    glTexImage2D(GL_TEXTURE_2D, 0, this->internalFormat, texSize.x, texSize.y, 0, this->format, GL_FLOAT, tex.data(0, 0, 0));
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, this->internalFormat, texSize.x, texSize.y, 0, this->format, this->type, pixels);
+    this->gpuBytes = converted.empty() ? tex.size(0) : converted.size();
 
     // Set up texture parameters
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
@@ -151,9 +225,15 @@ void Texture2D::LoadKTXToTexture(const std::string& path) {
     // Check if texture is uploaded successfully
     if (glGetError() != GL_NO_ERROR) {
         std::cerr << "[Texture2D] Error occurred during texture upload\n";
+        return false;
     } else {
-        std::cout << "[Texture2D] successfully loaded KTX texture : " << path << "\n";
+        std::cout << "[Texture2D] successfully loaded KTX texture : " << path;
+        if (!converted.empty()) {
+            std::cout << " (" << GetHDRFormatName(sourceInfo.internalFormat) << " -> " << GetHDRFormatName(storageFormat) << ")";
+        }
+        std::cout << "\n";
     }
+    return true;
 }
 
 // Load LDR (jpg, png...) to texture 2d, support sRGB format for PBR texture
@@ -196,6 +276,8 @@ void Texture2D::LoadLDRToTexture(const std::string& path, bool isSRGB, bool flip
 
     // Upload the texture data with the correct format
     glTexImage2D(GL_TEXTURE_2D, 0, this->internalFormat, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+    // RGB is padded to 4 bytes, mips add a third
+    this->gpuBytes = static_cast<size_t>(width) * height * (nrChannels == 3 ? 4 : nrChannels) * 4 / 3;
 
     glGenerateMipmap(GL_TEXTURE_2D);
 
@@ -210,6 +292,84 @@ void Texture2D::LoadLDRToTexture(const std::string& path, bool isSRGB, bool flip
 }
 
 
+// Material textures through the cooked texture cache
+void Texture2D::LoadCookedTexture(const std::string& path, TextureUsage usage, bool flipY) {
+    const bool isSRGB = usage == TextureUsage::Color;
+    if (!Texture2D::cookTextures || !Texture2D::SupportsCookedFormat(usage)) {
+        this->LoadLDRToTexture(path, isSRGB, flipY);
+        return;
+    }
+
+    const std::string cachePath = TextureCooker::GetCachePath(path, "", usage, flipY);
+    if (!TextureCooker::IsFresh(cachePath, path)) {
+        auto start = std::chrono::high_resolution_clock::now();
+        TextureCookStats stats;
+        if (!TextureCooker::CookFile(path, usage, flipY, cachePath, &stats)) {
+            this->LoadLDRToTexture(path, isSRGB, flipY);
+            return;
+        }
+        std::cout << "[Texture2D] Cooked " << path << " (" << TextureCooker::GetUsageName(usage) << ", "
+                  << stats.width << "x" << stats.height << ", " << stats.uncompressedBytes / 1024 << " -> "
+                  << stats.cookedBytes / 1024 << " KB) in "
+                  << std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count()
+                  << " ms\n";
+    }
+    if (!this->LoadCookedKTX(cachePath)) {
+        this->LoadLDRToTexture(path, isSRGB, flipY);
+    }
+}
+
+void Texture2D::CreateFromPixelsCooked(const unsigned char* pixels, int w, int h, int comp, TextureUsage usage,
+                                       const std::string& sourcePath, const std::string& subKey) {
+    const bool isSRGB = usage == TextureUsage::Color;
+    if (!Texture2D::cookTextures || !Texture2D::SupportsCookedFormat(usage)) {
+        this->CreateFromPixels(pixels, w, h, comp, isSRGB);
+        return;
+    }
+
+    const std::string cachePath = TextureCooker::GetCachePath(sourcePath, subKey, usage, false);
+    if (!TextureCooker::IsFresh(cachePath, sourcePath) &&
+        !TextureCooker::Cook(pixels, w, h, comp, usage, cachePath)) {
+        this->CreateFromPixels(pixels, w, h, comp, isSRGB);
+        return;
+    }
+    if (!this->LoadCookedKTX(cachePath)) {
+        this->CreateFromPixels(pixels, w, h, comp, isSRGB);
+    }
+}
+
+bool Texture2D::LoadCookedKTX(const std::string& cachePath) {
+    if (!this->LoadKTXToTexture(cachePath)) {
+        return false;
+    }
+    glBindTexture(GL_TEXTURE_2D, this->texture2d);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    return true;
+}
+
+bool Texture2D::SupportsCookedFormat(TextureUsage usage) {
+    if (usage == TextureUsage::Mask || usage == TextureUsage::Normal) {
+        return true;
+    }
+    static int s3tc = -1;
+    if (s3tc < 0) {
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_COMPRESSED_TEXTURE_FORMATS, &count);
+        std::vector<GLint> formats(std::max(count, 0));
+        if (count > 0) {
+            glGetIntegerv(GL_COMPRESSED_TEXTURE_FORMATS, formats.data());
+        }
+        s3tc = std::find(formats.begin(), formats.end(), static_cast<GLint>(COMPRESSED_RGB_S3TC_DXT1)) != formats.end();
+        if (!s3tc) {
+            std::cerr << "[Texture2D] S3TC not supported, color textures stay uncompressed\n";
+        }
+    }
+    return s3tc == 1;
+}
+
+
 // Create empty 2d texture
 void Texture2D::CreateStorage() {
     glBindTexture(GL_TEXTURE_2D, this->texture2d);
@@ -336,6 +496,7 @@ void Texture2D::CreateFromPixels(const unsigned char* pixels, int w, int h, int
     }
 
     glTexImage2D(GL_TEXTURE_2D, 0, internal, w, h, 0, fmt, GL_UNSIGNED_BYTE, pixels);
+    this->gpuBytes = static_cast<size_t>(w) * h * (comp == 3 ? 4 : comp) * 4 / 3;
 
     if (comp==1) { GLint swz[4]={GL_RED,GL_RED,GL_RED,GL_ONE};
                    glTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_RGBA, swz); }
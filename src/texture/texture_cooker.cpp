@@ -0,0 +1,511 @@
+#include "texture/texture_cooker.h"
+#include "thread_pool.h"
+#include "config.h"
+#include "stb_image.h"
+#include <gli/gli.hpp>
+#include <gli/save_ktx.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace {
+    double MsSince(std::chrono::high_resolution_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    }
+
+    uint64_t Fnv1a(uint64_t hash, const void* data, size_t size) {
+        const unsigned char* bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
+
+    float SRGBToLinear(float c) {
+        return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+
+    float LinearToSRGB(float c) {
+        return c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+    }
+
+    unsigned char ToByte(float v) {
+        return static_cast<unsigned char>(std::min(std::max(v, 0.0f), 1.0f) * 255.0f + 0.5f);
+    }
+
+    // Row loops run on the pool, or inline when the cook itself is a pool task
+    // (ParallelFor must not be nested)
+    void ForEachRow(size_t rows, bool parallel, const std::function<void(size_t)>& fn) {
+        if (parallel) {
+            ThreadPool::Get().ParallelFor(rows, fn);
+        } else {
+            for (size_t y = 0; y < rows; ++y) fn(y);
+        }
+    }
+
+    // RGBA float texels of one mip level: linear colors for Color, [-1, 1] vectors
+    // for Normal, [0, 1] otherwise
+    struct FloatImage {
+        int width = 0;
+        int height = 0;
+        std::vector<float> rgba;
+    };
+
+    FloatImage ToFloat(const std::vector<unsigned char>& bytes, int width, int height, TextureUsage usage, bool parallel) {
+        float decode[256], decodeAlpha[256];
+        for (int i = 0; i < 256; ++i) {
+            decodeAlpha[i] = i / 255.0f;
+            decode[i] = usage == TextureUsage::Color ? SRGBToLinear(decodeAlpha[i]) :
+                        usage == TextureUsage::Normal ? decodeAlpha[i] * 2.0f - 1.0f : decodeAlpha[i];
+        }
+        FloatImage image;
+        image.width = width;
+        image.height = height;
+        image.rgba.resize(bytes.size());
+        ForEachRow(height, parallel, [&](size_t y) {
+            for (size_t i = y * width * 4; i < (y + 1) * width * 4; i += 4) {
+                image.rgba[i + 0] = decode[bytes[i + 0]];
+                image.rgba[i + 1] = decode[bytes[i + 1]];
+                image.rgba[i + 2] = decode[bytes[i + 2]];
+                image.rgba[i + 3] = decodeAlpha[bytes[i + 3]];
+            }
+        });
+        return image;
+    }
+
+    std::vector<unsigned char> ToBytes(const FloatImage& image, TextureUsage usage, bool parallel) {
+        std::vector<unsigned char> bytes(image.rgba.size());
+        ForEachRow(image.height, parallel, [&](size_t y) {
+            for (size_t i = y * image.width * 4; i < (y + 1) * image.width * 4; ++i) {
+                const bool color = (i & 3) != 3;
+                float v = image.rgba[i];
+                if (usage == TextureUsage::Color && color) v = LinearToSRGB(v);
+                if (usage == TextureUsage::Normal && color) v = v * 0.5f + 0.5f;
+                bytes[i] = ToByte(v);
+            }
+        });
+        return bytes;
+    }
+
+    // Area filter of one axis: destination texel i covers source [i * scale, (i + 1) * scale),
+    // so odd sizes blend three source texels instead of dropping the last one
+    struct AreaTap {
+        int first = 0;
+        std::vector<float> weights;
+    };
+
+    std::vector<AreaTap> GetAreaTaps(int srcSize, int dstSize) {
+        std::vector<AreaTap> taps(dstSize);
+        const double scale = static_cast<double>(srcSize) / dstSize;
+        for (int i = 0; i < dstSize; ++i) {
+            const double lo = i * scale;
+            const double hi = (i + 1) * scale;
+            taps[i].first = static_cast<int>(std::floor(lo));
+            const int last = std::min(srcSize - 1, static_cast<int>(std::ceil(hi)) - 1);
+            for (int j = taps[i].first; j <= last; ++j) {
+                const double overlap = std::min(hi, j + 1.0) - std::max(lo, static_cast<double>(j));
+                taps[i].weights.push_back(static_cast<float>(overlap / scale));
+            }
+        }
+        return taps;
+    }
+
+    FloatImage Downsample(const FloatImage& src, bool renormalize, bool parallel) {
+        FloatImage dst;
+        dst.width = std::max(1, src.width / 2);
+        dst.height = std::max(1, src.height / 2);
+        dst.rgba.assign(static_cast<size_t>(dst.width) * dst.height * 4, 0.0f);
+        const std::vector<AreaTap> xTaps = GetAreaTaps(src.width, dst.width);
+        const std::vector<AreaTap> yTaps = GetAreaTaps(src.height, dst.height);
+
+        // Horizontal pass into a dst.width x src.height image, then vertical
+        std::vector<float> rows(static_cast<size_t>(dst.width) * src.height * 4, 0.0f);
+        ForEachRow(src.height, parallel, [&](size_t y) {
+            const float* in = &src.rgba[y * src.width * 4];
+            float* out = &rows[y * dst.width * 4];
+            for (int x = 0; x < dst.width; ++x) {
+                const AreaTap& tap = xTaps[x];
+                for (size_t k = 0; k < tap.weights.size(); ++k) {
+                    const float* texel = in + (tap.first + k) * 4;
+                    for (int c = 0; c < 4; ++c) {
+                        out[x * 4 + c] += texel[c] * tap.weights[k];
+                    }
+                }
+            }
+        });
+        ForEachRow(dst.height, parallel, [&](size_t y) {
+            const AreaTap& tap = yTaps[y];
+            float* out = &dst.rgba[y * dst.width * 4];
+            for (size_t k = 0; k < tap.weights.size(); ++k) {
+                const float* in = &rows[(tap.first + k) * dst.width * 4];
+                for (int i = 0; i < dst.width * 4; ++i) {
+                    out[i] += in[i] * tap.weights[k];
+                }
+            }
+            if (renormalize) {
+                for (int x = 0; x < dst.width; ++x) {
+                    float* n = out + x * 4;
+                    const float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+                    if (length > 1e-6f) {
+                        n[0] /= length; n[1] /= length; n[2] /= length;
+                    } else {
+                        n[0] = 0.0f; n[1] = 0.0f; n[2] = 1.0f;
+                    }
+                }
+            }
+        });
+        return dst;
+    }
+
+    // ----------BC1 color block----------
+    uint16_t PackRGB565(const float color[3]) {
+        const int r = std::min(std::max(static_cast<int>(color[0] * 31.0f / 255.0f + 0.5f), 0), 31);
+        const int g = std::min(std::max(static_cast<int>(color[1] * 63.0f / 255.0f + 0.5f), 0), 63);
+        const int b = std::min(std::max(static_cast<int>(color[2] * 31.0f / 255.0f + 0.5f), 0), 31);
+        return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+    }
+
+    void UnpackRGB565(uint16_t packed, int color[3]) {
+        const int r = (packed >> 11) & 31;
+        const int g = (packed >> 5) & 63;
+        const int b = packed & 31;
+        color[0] = (r << 3) | (r >> 2);
+        color[1] = (g << 2) | (g >> 4);
+        color[2] = (b << 3) | (b >> 2);
+    }
+
+    // Order the endpoints for the 4 color mode (c0 > c1) and pick the nearest palette
+    // entry per texel, returns the squared error of the block
+    int SolveColorIndices(const unsigned char* rgba, uint16_t& c0, uint16_t& c1, uint32_t& indices) {
+        if (c0 < c1) std::swap(c0, c1);
+        int palette[4][3];
+        UnpackRGB565(c0, palette[0]);
+        UnpackRGB565(c1, palette[1]);
+        for (int c = 0; c < 3; ++c) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        }
+        // Equal endpoints decode in the 3 color mode, index 0 is still c0
+        const int paletteSize = c0 == c1 ? 1 : 4;
+        int error = 0;
+        indices = 0;
+        for (int i = 0; i < 16; ++i) {
+            int best = 0, bestDistance = 1 << 30;
+            for (int p = 0; p < paletteSize; ++p) {
+                int distance = 0;
+                for (int c = 0; c < 3; ++c) {
+                    const int d = rgba[i * 4 + c] - palette[p][c];
+                    distance += d * d;
+                }
+                if (distance < bestDistance) {
+                    bestDistance = distance;
+                    best = p;
+                }
+            }
+            indices |= static_cast<uint32_t>(best) << (2 * i);
+            error += bestDistance;
+        }
+        return error;
+    }
+
+    // Endpoints along the principal axis of the block colors (slightly inset, as the
+    // extremes are rarely hit exactly), then one least squares refit for the chosen indices
+    void EncodeColorBlock(const unsigned char* rgba, unsigned char* out) {
+        float mean[3] = { 0.0f, 0.0f, 0.0f };
+        float lo[3] = { 255.0f, 255.0f, 255.0f };
+        float hi[3] = { 0.0f, 0.0f, 0.0f };
+        for (int i = 0; i < 16; ++i) {
+            for (int c = 0; c < 3; ++c) {
+                const float v = rgba[i * 4 + c];
+                mean[c] += v;
+                lo[c] = std::min(lo[c], v);
+                hi[c] = std::max(hi[c], v);
+            }
+        }
+        for (int c = 0; c < 3; ++c) mean[c] /= 16.0f;
+
+        float cov[3][3] = {};
+        for (int i = 0; i < 16; ++i) {
+            float d[3];
+            for (int c = 0; c < 3; ++c) d[c] = rgba[i * 4 + c] - mean[c];
+            for (int a = 0; a < 3; ++a) {
+                for (int b = 0; b < 3; ++b) cov[a][b] += d[a] * d[b];
+            }
+        }
+        float axis[3] = { hi[0] - lo[0], hi[1] - lo[1], hi[2] - lo[2] };
+        for (int iteration = 0; iteration < 6; ++iteration) {
+            float next[3];
+            for (int a = 0; a < 3; ++a) {
+                next[a] = cov[a][0] * axis[0] + cov[a][1] * axis[1] + cov[a][2] * axis[2];
+            }
+            const float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+            if (length < 1e-6f) break;
+            for (int a = 0; a < 3; ++a) axis[a] = next[a] / length;
+        }
+        const float axisLength = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+
+        uint16_t c0, c1;
+        if (axisLength < 1e-6f) {
+            c0 = c1 = PackRGB565(mean);     // solid block
+        } else {
+            for (int c = 0; c < 3; ++c) axis[c] /= axisLength;
+            float tMin = 1e30f, tMax = -1e30f;
+            for (int i = 0; i < 16; ++i) {
+                float t = 0.0f;
+                for (int c = 0; c < 3; ++c) t += (rgba[i * 4 + c] - mean[c]) * axis[c];
+                tMin = std::min(tMin, t);
+                tMax = std::max(tMax, t);
+            }
+            const float inset = (tMax - tMin) / 16.0f;
+            tMin += inset;
+            tMax -= inset;
+            float e0[3], e1[3];
+            for (int c = 0; c < 3; ++c) {
+                e0[c] = mean[c] + axis[c] * tMax;
+                e1[c] = mean[c] + axis[c] * tMin;
+            }
+            c0 = PackRGB565(e0);
+            c1 = PackRGB565(e1);
+        }
+        uint32_t indices;
+        int error = SolveColorIndices(rgba, c0, c1, indices);
+
+        // Least squares endpoints for these indices: texel = w * c0 + (1 - w) * c1
+        if (error > 0 && c0 != c1) {
+            static const float weight[4] = { 1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f };
+            float aa = 0.0f, bb = 0.0f, ab = 0.0f, ax[3] = {}, bx[3] = {};
+            for (int i = 0; i < 16; ++i) {
+                const float a = weight[(indices >> (2 * i)) & 3];
+                const float b = 1.0f - a;
+                aa += a * a; bb += b * b; ab += a * b;
+                for (int c = 0; c < 3; ++c) {
+                    ax[c] += a * rgba[i * 4 + c];
+                    bx[c] += b * rgba[i * 4 + c];
+                }
+            }
+            const float det = aa * bb - ab * ab;
+            if (std::fabs(det) > 1e-6f) {
+                float e0[3], e1[3];
+                for (int c = 0; c < 3; ++c) {
+                    e0[c] = (ax[c] * bb - bx[c] * ab) / det;
+                    e1[c] = (bx[c] * aa - ax[c] * ab) / det;
+                }
+                uint16_t r0 = PackRGB565(e0), r1 = PackRGB565(e1);
+                uint32_t refined;
+                const int refinedError = SolveColorIndices(rgba, r0, r1, refined);
+                if (refinedError < error) {
+                    c0 = r0; c1 = r1; indices = refined; error = refinedError;
+                }
+            }
+        }
+
+        out[0] = c0 & 0xFF; out[1] = c0 >> 8;
+        out[2] = c1 & 0xFF; out[3] = c1 >> 8;
+        for (int k = 0; k < 4; ++k) out[4 + k] = (indices >> (8 * k)) & 0xFF;
+    }
+
+    gli::format GetCookedFormat(TextureUsage usage, bool hasAlpha) {
+        switch (usage) {
+            case TextureUsage::Color:  return hasAlpha ? gli::FORMAT_RGBA_DXT5_SRGB_BLOCK16 : gli::FORMAT_RGB_DXT1_SRGB_BLOCK8;
+            case TextureUsage::Data:   return gli::FORMAT_RGB_DXT1_UNORM_BLOCK8;
+            case TextureUsage::Mask:   return gli::FORMAT_R_ATI1N_UNORM_BLOCK8;
+            case TextureUsage::Normal: return gli::FORMAT_RG_ATI2N_UNORM_BLOCK16;
+        }
+        return gli::FORMAT_UNDEFINED;
+    }
+
+    // Compress one RGBA8 level into dst, edge blocks repeat the last row / column
+    void EncodeLevel(const std::vector<unsigned char>& rgba, int width, int height, gli::format format,
+                     unsigned char* dst, bool parallel) {
+        const int blocksX = (width + 3) / 4;
+        const int blocksY = (height + 3) / 4;
+        const size_t blockBytes = gli::block_size(format);
+        ForEachRow(blocksY, parallel, [&](size_t by) {
+            unsigned char block[64];
+            for (int bx = 0; bx < blocksX; ++bx) {
+                for (int y = 0; y < 4; ++y) {
+                    const int sy = std::min(static_cast<int>(by) * 4 + y, height - 1);
+                    for (int x = 0; x < 4; ++x) {
+                        const int sx = std::min(bx * 4 + x, width - 1);
+                        std::memcpy(&block[(y * 4 + x) * 4], &rgba[(static_cast<size_t>(sy) * width + sx) * 4], 4);
+                    }
+                }
+                unsigned char* out = dst + (by * blocksX + bx) * blockBytes;
+                switch (format) {
+                    case gli::FORMAT_RGBA_DXT5_SRGB_BLOCK16: TextureCooker::EncodeBC3(block, out); break;
+                    case gli::FORMAT_R_ATI1N_UNORM_BLOCK8:   TextureCooker::EncodeBC4(block, 0, out); break;
+                    case gli::FORMAT_RG_ATI2N_UNORM_BLOCK16: TextureCooker::EncodeBC5(block, out); break;
+                    default:                                 TextureCooker::EncodeBC1(block, out); break;
+                }
+            }
+        });
+    }
+}
+
+void TextureCooker::EncodeBC1(const unsigned char* rgba, unsigned char* out) {
+    EncodeColorBlock(rgba, out);
+}
+
+// Alpha block (BC4 of the alpha channel) followed by a BC1 color block
+void TextureCooker::EncodeBC3(const unsigned char* rgba, unsigned char* out) {
+    EncodeBC4(rgba, 3, out);
+    EncodeColorBlock(rgba, out + 8);
+}
+
+// Endpoints are the block min / max in the 8 value mode, each texel takes the nearest
+// of the interpolated values (3-bit indices, 0 = max, 1 = min, 2..7 in between)
+void TextureCooker::EncodeBC4(const unsigned char* rgba, int channel, unsigned char* out) {
+    int lo = 255, hi = 0;
+    for (int i = 0; i < 16; ++i) {
+        lo = std::min(lo, static_cast<int>(rgba[i * 4 + channel]));
+        hi = std::max(hi, static_cast<int>(rgba[i * 4 + channel]));
+    }
+    out[0] = static_cast<unsigned char>(hi);
+    out[1] = static_cast<unsigned char>(lo);
+    uint64_t bits = 0;
+    if (hi > lo) {
+        const int range = hi - lo;
+        for (int i = 0; i < 16; ++i) {
+            const int step = ((hi - rgba[i * 4 + channel]) * 7 + range / 2) / range;
+            const uint64_t index = step == 0 ? 0 : step == 7 ? 1 : step + 1;
+            bits |= index << (3 * i);
+        }
+    }
+    for (int k = 0; k < 6; ++k) {
+        out[2 + k] = static_cast<unsigned char>((bits >> (8 * k)) & 0xFF);
+    }
+}
+
+void TextureCooker::EncodeBC5(const unsigned char* rgba, unsigned char* out) {
+    EncodeBC4(rgba, 0, out);
+    EncodeBC4(rgba, 1, out + 8);
+}
+
+const char* TextureCooker::GetUsageName(TextureUsage usage) {
+    switch (usage) {
+        case TextureUsage::Color:  return "color";
+        case TextureUsage::Data:   return "data";
+        case TextureUsage::Mask:   return "mask";
+        case TextureUsage::Normal: return "normal";
+    }
+    return "unknown";
+}
+
+std::string TextureCooker::GetCachePath(const std::string& sourcePath, const std::string& subKey,
+                                        TextureUsage usage, bool flipY) {
+    uint64_t hash = Fnv1a(14695981039346656037ull, &TextureCooker::VERSION, sizeof(TextureCooker::VERSION));
+    hash = Fnv1a(hash, sourcePath.data(), sourcePath.size());
+    hash = Fnv1a(hash, subKey.data(), subKey.size());
+    const int flags = static_cast<int>(usage) * 2 + (flipY ? 1 : 0);
+    hash = Fnv1a(hash, &flags, sizeof(flags));
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), "-%016llx.ktx", (unsigned long long)hash);
+    return (fs::path(TEXTURE_CACHE_DIR) / (fs::path(sourcePath).stem().string() + suffix)).string();
+}
+
+bool TextureCooker::IsFresh(const std::string& cachePath, const std::string& sourcePath) {
+    std::error_code ec;
+    if (!fs::exists(cachePath, ec)) return false;
+    const auto cacheTime = fs::last_write_time(cachePath, ec);
+    if (ec) return false;
+    const auto sourceTime = fs::last_write_time(sourcePath, ec);
+    return !ec && cacheTime >= sourceTime;
+}
+
+bool TextureCooker::Cook(const unsigned char* pixels, int width, int height, int channels,
+                         TextureUsage usage, const std::string& ktxPath, TextureCookStats* stats,
+                         bool parallel) {
+    if (!pixels || width <= 0 || height <= 0 || channels < 1 || channels > 4) {
+        return false;
+    }
+    TextureCookStats local;
+    TextureCookStats& s = stats ? *stats : local;
+    s.width = width;
+    s.height = height;
+
+    // Expand to RGBA8, stb_image order: grey, grey + alpha, RGB, RGBA
+    const size_t texels = static_cast<size_t>(width) * height;
+    std::vector<unsigned char> rgba(texels * 4);
+    bool hasAlpha = false;
+    for (size_t i = 0; i < texels; ++i) {
+        const unsigned char* in = pixels + i * channels;
+        unsigned char* out = &rgba[i * 4];
+        if (channels <= 2) {
+            out[0] = out[1] = out[2] = in[0];
+        } else {
+            out[0] = in[0]; out[1] = in[1]; out[2] = in[2];
+        }
+        out[3] = (channels == 2 || channels == 4) ? in[channels - 1] : 255;
+        hasAlpha = hasAlpha || out[3] != 255;
+    }
+    const gli::format format = GetCookedFormat(usage, hasAlpha);
+
+    const int levels = static_cast<int>(std::floor(std::log2(std::max(width, height)))) + 1;
+    gli::texture2d texture(format, gli::texture2d::extent_type(width, height), levels);
+    s.levels = levels;
+    s.uncompressedBytes = 0;
+    s.cookedBytes = texture.size();
+
+    // Level 0 is encoded from the source bytes, later levels from the filtered floats
+    FloatImage current;
+    for (int level = 0; level < levels; ++level) {
+        auto mipStart = std::chrono::high_resolution_clock::now();
+        int w = width, h = height;
+        if (level == 1) {
+            current = Downsample(ToFloat(rgba, width, height, usage, parallel), usage == TextureUsage::Normal, parallel);
+        } else if (level > 1) {
+            current = Downsample(current, usage == TextureUsage::Normal, parallel);
+        }
+        if (level > 0) {
+            w = current.width;
+            h = current.height;
+            rgba = ToBytes(current, usage, parallel);
+        }
+        s.mipMs += MsSince(mipStart);
+        // GPUs pad 3 channel texels to 4 bytes
+        s.uncompressedBytes += static_cast<size_t>(w) * h * (channels == 3 ? 4 : channels);
+
+        auto encodeStart = std::chrono::high_resolution_clock::now();
+        EncodeLevel(rgba, w, h, format, static_cast<unsigned char*>(texture[level].data()), parallel);
+        s.encodeMs += MsSince(encodeStart);
+    }
+
+    auto writeStart = std::chrono::high_resolution_clock::now();
+    std::error_code ec;
+    fs::create_directories(fs::path(ktxPath).parent_path(), ec);
+    if (!gli::save_ktx(texture, ktxPath)) {
+        std::cerr << "[TextureCooker] Failed to write " << ktxPath << "\n";
+        return false;
+    }
+    s.writeMs = MsSince(writeStart);
+    return true;
+}
+
+bool TextureCooker::CookFile(const std::string& imagePath, TextureUsage usage, bool flipY,
+                             const std::string& ktxPath, TextureCookStats* stats) {
+    TextureCookStats local;
+    TextureCookStats& s = stats ? *stats : local;
+    auto start = std::chrono::high_resolution_clock::now();
+    stbi_set_flip_vertically_on_load(flipY);
+    int width, height, channels;
+    unsigned char* pixels = stbi_load(imagePath.c_str(), &width, &height, &channels, 0);
+    stbi_set_flip_vertically_on_load(false);
+    if (!pixels) {
+        std::cerr << "[TextureCooker] Failed to load " << imagePath << ": " << stbi_failure_reason() << "\n";
+        return false;
+    }
+    s.decodeMs = MsSince(start);
+    const bool ok = Cook(pixels, width, height, channels, usage, ktxPath, &s);
+    stbi_image_free(pixels);
+    return ok;
+}
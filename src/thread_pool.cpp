@@ -0,0 +1,82 @@
+#include "thread_pool.h"
+#include <algorithm>
+#include <memory>
+
+ThreadPool& ThreadPool::Get() {
+    static ThreadPool pool;
+    return pool;
+}
+
+// One worker per hardware thread, minus the thread that calls ParallelFor
+ThreadPool::ThreadPool() {
+    unsigned hw = std::thread::hardware_concurrency();
+    unsigned count = hw > 1 ? hw - 1 : 1;
+    for (unsigned i = 0; i < count; ++i) {
+        this->workers.emplace_back([this]() { this->WorkerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+    }
+    this->wake.notify_all();
+    for (auto& worker : this->workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::WorkerLoop() {
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->wake.wait(lock, [this]() { return this->stopping || !this->tasks.empty(); });
+            if (this->stopping && this->tasks.empty()) return;
+            task = std::move(this->tasks.front());
+            this->tasks.pop_front();
+        }
+        task();
+    }
+}
+
+std::future<void> ThreadPool::Submit(std::function<void()> task) {
+    auto packaged = std::make_shared<std::packaged_task<void()>>(std::move(task));
+    std::future<void> result = packaged->get_future();
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->tasks.emplace_back([packaged]() { (*packaged)(); });
+    }
+    this->wake.notify_one();
+    return result;
+}
+
+// Every participant pulls the next index from a shared counter, so uneven work
+// (one large mesh among many small ones) balances itself. The caller works too
+// and then waits for the helpers it queued.
+void ThreadPool::ParallelFor(size_t count, const std::function<void(size_t)>& fn) {
+    if (count == 0) return;
+    if (count == 1 || this->workers.empty()) {
+        for (size_t i = 0; i < count; ++i) fn(i);
+        return;
+    }
+
+    auto next = std::make_shared<std::atomic<size_t>>(0);
+    auto run = [next, count, &fn]() {
+        for (size_t i = (*next)++; i < count; i = (*next)++) {
+            fn(i);
+        }
+    };
+
+    const size_t helpers = std::min(count - 1, this->workers.size());
+    std::vector<std::future<void>> pending;
+    pending.reserve(helpers);
+    for (size_t h = 0; h < helpers; ++h) {
+        pending.push_back(this->Submit(run));
+    }
+    run();
+    for (auto& f : pending) {
+        f.get();
+    }
+}
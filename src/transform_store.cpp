@@ -0,0 +1,266 @@
+#include "transform_store.h"
+#include "scene.h"
+#include <iostream>
+#include <limits>
+
+static const glm::vec3 EMPTY_MIN = glm::vec3(std::numeric_limits<float>::max());
+static const glm::vec3 EMPTY_MAX = glm::vec3(std::numeric_limits<float>::lowest());
+
+TransformStore& TransformStore::Get() {
+    static TransformStore instance;
+    return instance;
+}
+
+// Append a new root entry at the end of the arrays
+TransformStore::Handle TransformStore::Create(SceneNode* owner) {
+    Handle handle;
+    if (!this->freeHandles.empty()) {
+        handle = this->freeHandles.back();
+        this->freeHandles.pop_back();
+    } else {
+        handle = static_cast<Handle>(this->handleToIndex.size());
+        this->handleToIndex.push_back(0);
+    }
+
+    uint32_t index = this->Size();
+    this->handleToIndex[handle] = index;
+    this->indexToHandle.push_back(handle);
+    this->parents.push_back(NO_PARENT);
+    this->subtreeSizes.push_back(1);
+    this->locals.push_back(glm::mat4(1.0f));
+    this->worlds.push_back(glm::mat4(1.0f));
+    this->owners.push_back(owner);
+    this->boxMins.push_back(EMPTY_MIN);
+    this->boxMaxs.push_back(EMPTY_MAX);
+    this->subtreeMins.push_back(EMPTY_MIN);
+    this->subtreeMaxs.push_back(EMPTY_MAX);
+    this->meshCounts.push_back(0);
+    this->dirtyFlags.push_back(1);
+    this->hasDirty = true;
+    this->structureVersion++;
+    return handle;
+}
+
+// Released entries stay in place (so ranges remain valid) until the next reorder
+void TransformStore::Release(Handle handle) {
+    if (handle == INVALID_HANDLE || handle >= this->handleToIndex.size()) return;
+    uint32_t index = this->handleToIndex[handle];
+    this->owners[index] = nullptr;
+    this->indexToHandle[index] = INVALID_HANDLE;
+    this->handleToIndex[handle] = INVALID_HANDLE;
+    this->freeHandles.push_back(handle);
+    this->deadCount++;
+    this->structureVersion++;
+
+    // Compact once most of the store is garbage
+    if (this->deadCount > 64 && this->deadCount * 2 > this->Size()) {
+        this->Reorder();
+    }
+}
+
+bool TransformStore::SetParent(Handle child, Handle parent) {
+    uint32_t ci = this->handleToIndex[child];
+    uint32_t pi = this->handleToIndex[parent];
+
+    if (this->parents[ci] != NO_PARENT) {
+        std::cerr << "[TransformStore] node already has a parent\n";
+        return false;
+    }
+    if (pi >= ci && pi < ci + this->subtreeSizes[ci]) {
+        std::cerr << "[TransformStore] cannot attach a node below itself\n";
+        return false;
+    }
+
+    this->parents[ci] = static_cast<int32_t>(pi);
+    this->structureVersion++;
+
+    // Fast path: the child subtree directly follows the parent range (nodes built
+    // parent-first, as the loaders do), so only the ancestor sizes grow
+    if (ci == pi + this->subtreeSizes[pi]) {
+        for (int32_t a = static_cast<int32_t>(pi); a != NO_PARENT; a = this->parents[a]) {
+            this->subtreeSizes[a] += this->subtreeSizes[ci];
+        }
+        return true;
+    }
+
+    // Otherwise move the subtree into place
+    this->Reorder();
+    return true;
+}
+
+void TransformStore::SetLocal(Handle handle, const glm::mat4& local) {
+    uint32_t index = this->handleToIndex[handle];
+    this->locals[index] = local;
+    this->dirtyFlags[index] = 1;
+    this->hasDirty = true;
+}
+
+void TransformStore::MarkDirty(Handle handle) {
+    this->dirtyFlags[this->handleToIndex[handle]] = 1;
+    this->hasDirty = true;
+}
+
+SceneNode* TransformStore::GetParentNode(Handle handle) const {
+    int32_t p = this->parents[this->handleToIndex[handle]];
+    return p == NO_PARENT ? nullptr : this->owners[p];
+}
+
+void TransformStore::UpdateSubtree(Handle handle) {
+    uint32_t index = this->handleToIndex[handle];
+    this->UpdateRange(index, index + this->subtreeSizes[index]);
+    this->RefreshAncestors(index);
+}
+
+// Linear scan for dirty entries; a dirty entry recomputes its whole range and the
+// scan continues after it, so nested dirty entries are not visited twice
+void TransformStore::UpdateDirty() {
+    if (!this->hasDirty) return;
+
+    const uint32_t n = this->Size();
+    for (uint32_t k = 0; k < n;) {
+        if (this->dirtyFlags[k]) {
+            uint32_t end = k + this->subtreeSizes[k];
+            this->UpdateRange(k, end);
+            this->RefreshAncestors(k);
+            this->stats.dirtySubtrees++;
+            k = end;
+        } else {
+            ++k;
+        }
+    }
+    this->hasDirty = false;
+}
+
+// Forward pass: world matrices and own boxes (parents are always computed first).
+// Backward pass: fold every subtree into its parent (children come after parents).
+void TransformStore::UpdateRange(uint32_t begin, uint32_t end) {
+    this->boundsVersion++;
+    for (uint32_t k = begin; k < end; ++k) {
+        int32_t p = this->parents[k];
+        this->worlds[k] = (p == NO_PARENT) ? this->locals[k] : this->worlds[p] * this->locals[k];
+        this->dirtyFlags[k] = 0;
+
+        this->boxMins[k] = EMPTY_MIN;
+        this->boxMaxs[k] = EMPTY_MAX;
+        this->meshCounts[k] = 0;
+        if (SceneNode* owner = this->owners[k]) {
+            if (owner->mesh) {
+                owner->worldAABB.UpdateBox(this->worlds[k]);
+                if (owner->worldAABB.IsValid()) {
+                    this->boxMins[k] = owner->worldAABB.GetMin();
+                    this->boxMaxs[k] = owner->worldAABB.GetMax();
+                }
+            }
+            this->meshCounts[k] = owner->mesh ? 1 : 0;
+        }
+        this->subtreeMins[k] = this->boxMins[k];
+        this->subtreeMaxs[k] = this->boxMaxs[k];
+    }
+
+    this->stats.matricesRecomputed += end - begin;
+
+    for (uint32_t k = end; k-- > begin + 1;) {
+        int32_t p = this->parents[k];
+        this->subtreeMins[p] = glm::min(this->subtreeMins[p], this->subtreeMins[k]);
+        this->subtreeMaxs[p] = glm::max(this->subtreeMaxs[p], this->subtreeMaxs[k]);
+        this->meshCounts[p] += this->meshCounts[k];
+    }
+}
+
+void TransformStore::RefreshBoundsAt(uint32_t index) {
+    SceneNode* owner = this->owners[index];
+    this->subtreeMins[index] = this->boxMins[index];
+    this->subtreeMaxs[index] = this->boxMaxs[index];
+    this->meshCounts[index] = (owner && owner->mesh) ? 1 : 0;
+
+    // Direct children: jump over each child's subtree range
+    uint32_t end = index + this->subtreeSizes[index];
+    for (uint32_t c = index + 1; c < end; c += this->subtreeSizes[c]) {
+        this->subtreeMins[index] = glm::min(this->subtreeMins[index], this->subtreeMins[c]);
+        this->subtreeMaxs[index] = glm::max(this->subtreeMaxs[index], this->subtreeMaxs[c]);
+        this->meshCounts[index] += this->meshCounts[c];
+    }
+}
+
+void TransformStore::RefreshAncestors(uint32_t index) {
+    for (int32_t a = this->parents[index]; a != NO_PARENT; a = this->parents[a]) {
+        this->RefreshBoundsAt(static_cast<uint32_t>(a));
+    }
+}
+
+template<typename T>
+void TransformStore::Permute(std::vector<T>& values, const std::vector<uint32_t>& order) {
+    std::vector<T> result;
+    result.reserve(order.size());
+    for (uint32_t old : order) result.push_back(values[old]);
+    values.swap(result);
+}
+
+// Rebuild depth-first pre-order from the parent indices. Released entries are
+// dropped, their live children become roots.
+void TransformStore::Reorder() {
+    const uint32_t n = this->Size();
+    auto alive = [&](int32_t i) { return i != NO_PARENT && this->indexToHandle[i] != INVALID_HANDLE; };
+
+    // Children lists in compressed form, siblings keep their relative order
+    std::vector<uint32_t> childStart(n + 1, 0), childList;
+    for (uint32_t i = 0; i < n; ++i) {
+        if (alive(static_cast<int32_t>(i)) && alive(this->parents[i])) childStart[this->parents[i] + 1]++;
+    }
+    for (uint32_t i = 0; i < n; ++i) childStart[i + 1] += childStart[i];
+    childList.resize(childStart[n]);
+    std::vector<uint32_t> fill(childStart.begin(), childStart.end() - 1);
+    for (uint32_t i = 0; i < n; ++i) {
+        if (alive(static_cast<int32_t>(i)) && alive(this->parents[i])) childList[fill[this->parents[i]]++] = i;
+    }
+
+    // Iterative DFS from every live root
+    std::vector<uint32_t> order;
+    order.reserve(n - this->deadCount);
+    std::vector<uint32_t> stack;
+    for (uint32_t root = 0; root < n; ++root) {
+        if (!alive(static_cast<int32_t>(root)) || alive(this->parents[root])) continue;
+        stack.push_back(root);
+        while (!stack.empty()) {
+            uint32_t i = stack.back();
+            stack.pop_back();
+            order.push_back(i);
+            for (uint32_t c = childStart[i + 1]; c-- > childStart[i];) stack.push_back(childList[c]);
+        }
+    }
+
+    std::vector<int32_t> oldToNew(n, NO_PARENT);
+    for (uint32_t i = 0; i < order.size(); ++i) oldToNew[order[i]] = static_cast<int32_t>(i);
+
+    std::vector<int32_t> newParents(order.size());
+    for (uint32_t i = 0; i < order.size(); ++i) {
+        int32_t p = this->parents[order[i]];
+        newParents[i] = alive(p) ? oldToNew[p] : NO_PARENT;
+    }
+    for (uint32_t i = 0; i < order.size(); ++i) {
+        if (newParents[i] == NO_PARENT && this->parents[order[i]] != NO_PARENT) {
+            this->dirtyFlags[order[i]] = 1; // parent was released, world is now its local
+            this->hasDirty = true;
+        }
+    }
+    this->parents.swap(newParents);
+
+    Permute(this->indexToHandle, order);
+    Permute(this->locals, order);
+    Permute(this->worlds, order);
+    Permute(this->owners, order);
+    Permute(this->boxMins, order);
+    Permute(this->boxMaxs, order);
+    Permute(this->subtreeMins, order);
+    Permute(this->subtreeMaxs, order);
+    Permute(this->meshCounts, order);
+    Permute(this->dirtyFlags, order);
+
+    // Sizes from the new parent links, children always follow their parent
+    this->subtreeSizes.assign(order.size(), 1);
+    for (uint32_t i = static_cast<uint32_t>(order.size()); i-- > 0;) {
+        if (this->parents[i] != NO_PARENT) this->subtreeSizes[this->parents[i]] += this->subtreeSizes[i];
+    }
+    for (uint32_t i = 0; i < order.size(); ++i) this->handleToIndex[this->indexToHandle[i]] = i;
+    this->deadCount = 0;
+}
@@ -0,0 +1,92 @@
+#include "vertex_format.h"
+#include "geometry.h"
+#include <algorithm>
+#include <cmath>
+#include <glm/gtc/packing.hpp>
+
+//=================================Compact vertex==================================
+namespace {
+    inline int16_t QuantizeSnorm(float v) {
+        return (int16_t)std::lround(std::max(-1.0f, std::min(1.0f, v)) * COMPACT_SNORM_MAX);
+    }
+
+    inline float SignNotZero(float v) { return v >= 0.0f ? 1.0f : -1.0f; }
+
+    // Any unit vector perpendicular to n, for vertices without a usable tangent
+    glm::vec3 Perpendicular(const glm::vec3& n) {
+        const glm::vec3 axis = std::fabs(n.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+        return glm::normalize(glm::cross(n, axis));
+    }
+
+    void PackUnit(const glm::vec3& v, int16_t out[2]) {
+        const glm::vec2 e = OctEncode(v);
+        out[0] = QuantizeSnorm(e.x);
+        out[1] = QuantizeSnorm(e.y);
+    }
+}
+
+glm::vec2 OctEncode(const glm::vec3& n) {
+    const float l1 = std::fabs(n.x) + std::fabs(n.y) + std::fabs(n.z);
+    if (l1 <= 0.0f) return glm::vec2(0.0f);
+    glm::vec2 e(n.x / l1, n.y / l1);
+    if (n.z < 0.0f) {
+        e = glm::vec2((1.0f - std::fabs(e.y)) * SignNotZero(e.x), (1.0f - std::fabs(e.x)) * SignNotZero(e.y));
+    }
+    return e;
+}
+
+glm::vec3 OctDecode(const glm::vec2& e) {
+    glm::vec3 n(e.x, e.y, 1.0f - std::fabs(e.x) - std::fabs(e.y));
+    if (n.z < 0.0f) {
+        n.x = (1.0f - std::fabs(e.y)) * SignNotZero(e.x);
+        n.y = (1.0f - std::fabs(e.x)) * SignNotZero(e.y);
+    }
+    return glm::normalize(n);
+}
+
+void PackCompactVertices(const Vertex* vertices, size_t count, std::vector<CompactVertex>& out,
+                         glm::vec3& dequantScale, glm::vec3& dequantOffset) {
+    out.resize(count);
+    glm::vec3 lo(0.0f), hi(0.0f);
+    if (count > 0) lo = hi = vertices[0].position;
+    for (size_t i = 1; i < count; ++i) {
+        lo = glm::min(lo, vertices[i].position);
+        hi = glm::max(hi, vertices[i].position);
+    }
+
+    // Center and half extent of the AABB, flat axes keep a unit scale
+    dequantOffset = (lo + hi) * 0.5f;
+    glm::vec3 halfExtent = (hi - lo) * 0.5f;
+    for (int a = 0; a < 3; ++a) {
+        if (halfExtent[a] <= 0.0f) halfExtent[a] = 1.0f;
+    }
+    dequantScale = halfExtent / COMPACT_SNORM_MAX;
+    const glm::vec3 toUnit = 1.0f / halfExtent;
+
+    for (size_t i = 0; i < count; ++i) {
+        const Vertex& v = vertices[i];
+        CompactVertex& c = out[i];
+
+        const glm::vec3 p = (v.position - dequantOffset) * toUnit;
+        c.position[0] = QuantizeSnorm(p.x);
+        c.position[1] = QuantizeSnorm(p.y);
+        c.position[2] = QuantizeSnorm(p.z);
+
+        glm::vec3 n = v.normals;
+        const float nLen2 = glm::dot(n, n);
+        n = nLen2 > 0.0f ? n / std::sqrt(nLen2) : glm::vec3(0.0f, 1.0f, 0.0f);
+
+        // Tangent orthogonal to the normal, the bitangent is rebuilt as cross(N, T) * sign
+        glm::vec3 t = v.tangent - n * glm::dot(n, v.tangent);
+        const float tLen2 = glm::dot(t, t);
+        t = tLen2 > 1e-12f ? t / std::sqrt(tLen2) : Perpendicular(n);
+        c.position[3] = glm::dot(glm::cross(n, t), v.bitangent) < 0.0f ? -1 : 1;
+
+        PackUnit(n, c.normal);
+        PackUnit(t, c.tangent);
+
+        const uint32_t uv = glm::packHalf2x16(v.texCoord);
+        c.texCoord[0] = (uint16_t)(uv & 0xFFFFu);
+        c.texCoord[1] = (uint16_t)(uv >> 16);
+    }
+}
@@ -0,0 +1,72 @@
+// Batch IBL baker: equirectangular HDRs in, irradiance/prefilter KTX out, no GPU needed.
+// Build with the "ibl bake" task (-O2), run
+//   ./ibl_bake [-o outDir] [--no-lut] [--fp32] env1.hdr [env2.hdr ...]
+// A single environment goes to outDir/{irradiance,prefilter}.ktx, the files main.cpp
+// loads with -o debug. Several go to outDir/<name>/{irradiance,prefilter}.ktx. The
+// BRDF LUT does not depend on the environment and is written once to outDir/brdfLUT.ktx.
+// Maps are stored in the IBLBakeSettings formats (RGB16F, R11F_G11F_B10F, RG16F),
+// --fp32 writes RGB32F / RG32F like the files under debug/.
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#include "cubemap/ibl_baker.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+int main(int argc, char** argv) {
+    std::string outDir = "debug";
+    bool writeLUT = true;
+    IBLBakeSettings settings;
+    std::vector<std::string> inputs;
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "-o") && i + 1 < argc) {
+            outDir = argv[++i];
+        } else if (!strcmp(argv[i], "--no-lut")) {
+            writeLUT = false;
+        } else if (!strcmp(argv[i], "--fp32")) {
+            settings.irradianceFormat = GL_RGB32F;
+            settings.prefilterFormat = GL_RGB32F;
+            settings.brdfLUTFormat = GL_RG32F;
+        } else {
+            inputs.push_back(argv[i]);
+        }
+    }
+    if (inputs.empty()) {
+        fprintf(stderr, "usage: %s [-o outDir] [--no-lut] [--fp32] env.hdr [...]\n", argv[0]);
+        return 1;
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    IBLBaker baker(settings);
+    int failed = 0;
+    for (const std::string& input : inputs) {
+        const std::string dir = inputs.size() == 1 ? outDir : (fs::path(outDir) / fs::path(input).stem()).string();
+        if (!baker.Bake(input, dir, false)) {
+            fprintf(stderr, "failed: %s\n", input.c_str());
+            ++failed;
+            continue;
+        }
+        printf("%s -> %s\n", input.c_str(), dir.c_str());
+        baker.PrintStats();
+    }
+
+    if (writeLUT) {
+        fs::create_directories(outDir);
+        const std::vector<float> lut = baker.BakeBRDFLUT();
+        if (!IBLBaker::SaveBRDFLUTKTX(lut, IBL_BRDF_LUT_SIZE, (fs::path(outDir) / "brdfLUT.ktx").string(),
+                                      settings.brdfLUTFormat)) {
+            ++failed;
+        } else {
+            printf("brdfLUT -> %s (%.1f ms)\n", outDir.c_str(), baker.GetStats().brdfLUTMs);
+        }
+    }
+
+    const double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    printf("%zu environments in %.1f ms, %d failed\n", inputs.size(), ms, failed);
+    return failed ? 1 : 0;
+}